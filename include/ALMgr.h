@@ -2,11 +2,16 @@
 #define ALMGR_H
 
 #include <string>
+#include <vector>
+#include <ctime>
+#include <stdint.h>
 
 /********************************************************************************
- * ALMgr - Access List manager, basically reads from a text document to find the
- *         IP address given. If it's a whitelist, then returns true for allowed
- *         if found and opposite for blacklists
+ * ALMgr - Access List manager. Reads a text file of IP addresses and CIDR blocks
+ *         (one per line, # for comments) into a binary prefix tree so checks are
+ *         a walk of at most 32 nodes. If it's a whitelist, then returns true for
+ *         allowed if found and opposite for blacklists. The file is reloaded when
+ *         it changes on disk.
  ********************************************************************************/
 
 class ALMgr {
@@ -14,13 +19,35 @@ class ALMgr {
       ALMgr(const char *al_file, bool is_whitelist = true);
       ~ALMgr();
 
+      // (Re)reads the file into the tree. Returns the number of entries loaded
+      unsigned int loadList();
+
+      // Reloads the list if the file changed, looking at most once every check_secs
+      bool checkReload(time_t check_secs = 1);
+
       bool isAllowed(const char *ipaddr);
       bool isAllowed(unsigned long ipaddr);
 
+      // True if the address (network byte order) falls in any listed block
+      bool isListed(unsigned long ipaddr) const;
+
    private:
+      // Children are indexes into _nodes, 0 for none (the root is never a child)
+      struct al_node {
+         uint32_t child[2];
+         bool listed;
+      };
+
+      void addBlock(uint32_t addr, unsigned int prefix_len);
+
       std::string _al_file;
 
       bool _is_whitelist;
+
+      std::vector<al_node> _nodes;
+
+      time_t _file_mtime = 0;
+      time_t _last_check = 0;
 };
 
 #endif // ALMGR_H
@@ -89,6 +89,9 @@ public:
 	// Copies the alias list into a new vector
 	std::vector<std::string> getAliases() { return _alias; };
 
+	// How many command tokens this action uses up, for rate limiting players
+	float getCost() const { return _cost; };
+
 	const char *getPreTrig() const { return _pretrig.c_str(); };
 	const char *getPostTrig() const { return _posttrig.c_str(); };
 
@@ -137,6 +140,9 @@ private:
 	std::string _pretrig;
 	std::string _posttrig;
 
+	// Relative weight of this action against a player's command rate (optional cost attribute)
+	float _cost = 1.0;
+
 	// Target pointers for action execution
 	std::shared_ptr<Physical> _target1;
 
@@ -4,17 +4,20 @@
 #include <map>
 #include <memory>
 #include <thread>
+#include <chrono>
 #include <libconfig.h++>
 #include <set>
 #include "Action.h"
+#include "Metrics.h"
 
 class Player;
 class Script;
 
+// Orders the action queue soonest first. Actions due at the same time run in the order queued
 struct compare_msa {
 	bool operator()(const std::shared_ptr<Action> &lhs,
 						 const std::shared_ptr<Action> &rhs) const {
-		return lhs->getExecTime() > rhs->getExecTime();
+		return lhs->getExecTime() < rhs->getExecTime();
 	}
 };
 
@@ -37,8 +40,11 @@ public:
 	// Load the different groups of actions
 	unsigned int loadActions(const char *actiondir);
 
-	// Go through the action queue, executing those whose timer is < now()
-	void handleActions();
+	// Adds the action queue figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+	// Go through the action queue, executing those whose timer is < now() until the deadline
+	void handleActions(std::chrono::system_clock::time_point deadline);
 
 	Action *preAction(const char *cmd, std::string &errmsg, 
 														std::shared_ptr<Organism> actor);
@@ -50,6 +56,13 @@ public:
 	// Adds a script to the queue to be executed	
 	bool addScript(std::shared_ptr<Script> new_script);
 
+	// Adds a job, like a zone reset, that has its execute time set and keeps itself in the
+	// queue by returning 2
+	void addJob(std::shared_ptr<Action> job) { _action_queue.insert(job); };
+
+	// Called once the script worker thread has executed a script
+	void finishScript(std::shared_ptr<Script> sptr, int results);
+
 private:
 	int handleSpecials(Action *action, const char *trigger);
 
@@ -64,6 +77,8 @@ private:
 
 	std::multiset<std::shared_ptr<Action>, compare_msa> _action_queue;
 
+	MetricGauge _queue_metric;
+	MetricCounter _executed_metric;
 };
 
 
@@ -39,6 +39,9 @@ private:
 // analyzes the string and generates an appropriate Attribute type based on what it sees
 Attribute *genAttrFromStr(const char *str);
 
+// new attribute with the same type and value as attr
+Attribute *copyAttribute(Attribute &attr);
+
 
 
 class IntAttribute : public Attribute {
@@ -0,0 +1,90 @@
+#ifndef AUTHPOOL_H
+#define AUTHPOOL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "Metrics.h"
+
+/***************************************************************************************
+ * AuthPool - worker threads that do the Argon2 password hashing for logins so a login
+ *				  doesn't stall the heartbeat. Each hash holds Player::passwd_mem_kb of memory
+ *				  while it runs, so the number of workers is capped by a memory budget. Results
+ *				  are handed back to the game thread, which runs the completions each heartbeat.
+ *
+ ***************************************************************************************/
+class AuthPool
+{
+public:
+	AuthPool();
+	AuthPool(const AuthPool &copy_from);
+
+	~AuthPool();
+
+	// Called on the game thread with the results. success is whether the password matched
+	// (checks) or was hashed (creates), and passwd_hash holds the new salt+hash for creates
+	typedef std::function<void(bool success, const std::vector<unsigned char> &passwd_hash)> auth_callback;
+
+	// Starts up to num_threads workers, fewer if they won't all fit in memory_mb
+	void start(unsigned int num_threads, unsigned int memory_mb);
+	void stop();
+
+	bool isRunning() const { return (_workers.size() > 0); };
+	unsigned int getNumWorkers() const { return (unsigned int) _workers.size(); };
+
+	// Most hashes that may be queued or running at once, 0 for no limit
+	void setMaxPending(unsigned int max_pending) { _max_pending = max_pending; };
+
+	// Queue a password to be compared against a stored salt+hash, or hashed for a new account.
+	// With no workers running, these hash right away and call the callback before returning.
+	// Return false without queueing (or calling back) if max_pending hashes are in flight
+	bool checkPassword(const std::string &cleartext, const std::vector<unsigned char> &passwd_hash,
+																						auth_callback callback);
+	bool createPassword(const std::string &cleartext, auth_callback callback);
+
+	// Runs the callbacks for finished jobs. Called by the game thread each heartbeat
+	unsigned int handleCompletions();
+
+	// Adds the auth queue figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+private:
+	enum job_type { Check, Create };
+
+	struct auth_job {
+		job_type type;
+		std::string cleartext;
+		std::vector<unsigned char> passwd_hash;
+		auth_callback callback;
+		bool success;
+	};
+
+	bool queueJob(std::unique_ptr<auth_job> job);
+	static void runJob(auth_job &job);
+	void runWorker();
+
+	std::vector<std::thread> _workers;
+	bool _exit_workers = false;
+
+	std::mutex _queue_mutex;
+	std::condition_variable _queue_cond;
+	std::deque<std::unique_ptr<auth_job>> _job_queue;
+
+	// Jobs queued or being hashed
+	unsigned int _in_flight = 0;
+	unsigned int _max_pending = 0;
+
+	std::mutex _done_mutex;
+	std::vector<std::unique_ptr<auth_job>> _done_jobs;
+
+	MetricGauge _queue_metric;
+	MetricSummary _hash_metric;
+	MetricCounter _refused_metric;
+};
+
+#endif
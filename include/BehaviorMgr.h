@@ -0,0 +1,85 @@
+#ifndef BEHAVIORMGR_H
+#define BEHAVIORMGR_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <libconfig.h++>
+#include "Metrics.h"
+
+class NPC;
+class Location;
+class Physical;
+class EntityDB;
+class UserMgr;
+class ActionMgr;
+
+/***************************************************************************************
+ * BehaviorMgr - gives NPCs something to do. Every npc_turn_secs each NPC takes a turn:
+ *				     a "behave" special on the NPC runs first and, if it doesn't end the turn,
+ *				     the NPC may attack a player in the room (aggression > 0, out of 100), flee
+ *				     from one (aggression < 0) or wander off through an exit in its zone (speed,
+ *				     out of 100). What it decides is queued as an Action, the same as a player's
+ *				     command.
+ *
+ *				     NPCs are grouped by the zone in their ID. Only zones with a player in them
+ *				     are awake, so the cost of a heartbeat follows the occupied zones rather than
+ *				     the number of NPCs in the MUD.
+ *
+ ***************************************************************************************/
+class BehaviorMgr
+{
+public:
+	BehaviorMgr();
+	BehaviorMgr(const BehaviorMgr &copy_from);
+
+	~BehaviorMgr();
+
+	// Reads the settings and groups the loaded NPCs by zone
+	void initialize(libconfig::Config &cfg_info, EntityDB &edb);
+
+	// Adds an NPC made after loading, such as one spawned from a prototype
+	void addNPC(std::shared_ptr<NPC> npc);
+
+	// Called each heartbeat. Gives the NPCs in zones with players a turn when theirs is due
+	void handleBehaviors(UserMgr &users, ActionMgr &actions);
+
+	// Adds the NPC figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+private:
+	struct zone_npcs {
+		std::vector<std::shared_ptr<NPC>> npcs;
+		bool awake = false;
+		std::chrono::steady_clock::time_point next_turn;
+	};
+
+	void takeTurns(zone_npcs &zone, ActionMgr &actions);
+	void behave(std::shared_ptr<NPC> npc, ActionMgr &actions);
+	bool wander(std::shared_ptr<NPC> npc, std::shared_ptr<Location> loc, ActionMgr &actions);
+	bool queueAction(ActionMgr &actions, const char *cmd, std::shared_ptr<NPC> npc,
+															std::shared_ptr<Physical> target, const char *token = NULL);
+
+	// Out of 100
+	unsigned int roll();
+
+	std::map<std::string, std::shared_ptr<zone_npcs>> _zones;
+
+	// The zones that were awake last heartbeat, so those that empty out can be put to sleep
+	std::set<std::string> _awake;
+
+	// 0 turns NPC behaviors off
+	float _turn_secs = 4.0;
+
+	std::mt19937 _rng;
+
+	MetricGauge _awake_metric;
+	MetricCounter _turns_metric;
+	MetricCounter _actions_metric;
+};
+
+#endif
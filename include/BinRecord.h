@@ -0,0 +1,81 @@
+#ifndef BINRECORD_H
+#define BINRECORD_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <stdint.h>
+
+/***************************************************************************************
+ * RecordWriter - builds a compact binary record (used for player saves). Integers are
+ *					   varints (zigzag for signed), floats are 4 bytes little endian and strings
+ *					   are a varint length then the bytes. Keys (attribute names, trait IDs) are
+ *					   interned: each is stored once in a table at the front of the record and
+ *					   referred to by its index after that.
+ *
+ *					   Layout: magic (4 bytes), version (varint), key count, keys, body
+ *
+ ***************************************************************************************/
+class RecordWriter
+{
+public:
+	RecordWriter();
+
+	void putVarint(uint64_t value);
+	void putSigned(int64_t value);
+	void putFloat(float value);
+	void putString(const std::string &value);
+	void putBytes(const std::vector<unsigned char> &value);
+	void putKey(const std::string &key);
+
+	// Assembles the header, key table and body into out
+	void finish(const char *magic, unsigned int version, std::string &out) const;
+
+private:
+	static void appendVarint(std::string &buf, uint64_t value);
+
+	std::string _body;
+
+	std::vector<std::string> _keys;
+	std::unordered_map<std::string, uint64_t> _key_idx;
+};
+
+/***************************************************************************************
+ * RecordReader - reads back a record built by RecordWriter. Running off the end of the
+ *					   data or a bad key index throws a record_error.
+ *
+ ***************************************************************************************/
+class RecordReader
+{
+public:
+	RecordReader(const std::string &data);
+
+	// Checks the magic and reads the key table. Returns the record's version
+	unsigned int open(const char *magic);
+
+	uint64_t getVarint();
+	int64_t getSigned();
+	float getFloat();
+	void getString(std::string &value);
+	void getBytes(std::vector<unsigned char> &value);
+	const std::string &getKey();
+
+	bool atEnd() const { return (_pos == _data.size()); };
+
+private:
+	void need(size_t bytes) const;
+
+	const std::string &_data;
+	size_t _pos = 0;
+
+	std::vector<std::string> _keys;
+};
+
+class record_error : public std::runtime_error
+{
+public:
+	record_error(const std::string &what_arg):std::runtime_error(what_arg) {};
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <string>
+#include <memory>
+#include <vector>
+
+/***************************************************************************************
+ * Broadcast - a single message going out to many players. The message is formatted once
+ *				   per output profile (color on/off, wrap width) and the formatted buffer is
+ *				   shared by reference between each recipient's connection.
+ *
+ ***************************************************************************************/
+class Broadcast
+{
+public:
+	Broadcast(const char *msg);
+	Broadcast(const std::string &msg);
+	Broadcast(const Broadcast &copy_from);
+
+	~Broadcast();
+
+	std::string &getMsg() { return _msg; };
+
+	// Gets the formatted version of this message for the given profile, formatting it if needed
+	std::shared_ptr<std::string> getFormatted(bool use_color, unsigned int wrap_width,
+																			unsigned int &end_wrap);
+
+private:
+
+	struct fmtprofile {
+		bool use_color;
+		unsigned int wrap_width;
+		unsigned int end_wrap;
+		std::shared_ptr<std::string> formatted;
+	};
+
+	std::string _msg;
+
+	// Usually only one or two profiles are in use, so a vector is faster than a map
+	std::vector<fmtprofile> _formatted;
+};
+
+#endif
@@ -50,6 +50,9 @@ public:
 
 protected:
 
+	// Doors show up in two rooms, so both are told
+	virtual void renderChanged();
+
    virtual void saveData(pugi::xml_node &entnode) const;
    virtual int loadData(pugi::xml_node &entnode);
 
@@ -8,6 +8,8 @@
 #include "../external/pugixml.hpp"
 
 class Physical;
+class RecordWriter;
+class RecordReader;
 
 /***************************************************************************************
  * Entity - the most abstract class of interactable MUD objects. This is a generic class
@@ -52,6 +54,10 @@ protected:
 	virtual void saveData(pugi::xml_node &entnode) const;
 	virtual int loadData(pugi::xml_node &entnode);
 
+	// Binary versions of saveData/loadData, used for player saves
+	virtual void saveRecord(RecordWriter &rec) const;
+	virtual int loadRecord(RecordReader &rec);
+
 	virtual bool setFlagInternal(const char *flagname, bool newval);
 	virtual bool isFlagSetInternal(const char *flagname, bool &results);
 
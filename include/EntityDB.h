@@ -3,16 +3,24 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 #include "Physical.h"
 
 class Trait;
 class Script;
+class ZoneReset;
+class ActionMgr;
 
 /***************************************************************************************
  * EntityDB - class that stores and manages the game entities. Entities are stored based
  *				  on a key of zone@id which means that all zone entities will be grouped
  *				  together for purposes of iteration.
  *
+ *				  Statics, getables, equipment and NPCs marked prototype="true" in the zone
+ *				  files are kept apart as templates and never placed in the world. spawn makes
+ *				  entities from them that share the prototype's descriptions, specials and
+ *				  attributes, each getting its own copy of what it changes.
+ *
  ***************************************************************************************/
 class EntityDB 
 {
@@ -25,17 +33,47 @@ public:
 	int loadTraits(libconfig::Config &mud_cfg);
 
 	std::shared_ptr<Physical> getPhysical(const char *id);
+	std::shared_ptr<Physical> getPrototype(const char *id);
+
+	// Makes a new entity from a prototype, placed in loc or, if null, the prototype's startloc
+	std::shared_ptr<Physical> spawn(const char *proto_id, std::shared_ptr<Physical> loc = nullptr);
 	std::shared_ptr<Script> getScript(const char *id);
 
+	// Queues the zone resets read from the zone files. Call once the world is set up
+	unsigned int scheduleResets(ActionMgr &actions);
+
 	std::shared_ptr<Trait> getTrait(const char *id);
 
 	// Removes all references to this item from the database objects`
 	size_t purgePhysical(std::shared_ptr<Physical> item);
+
+	// Every physical in the database, in zone@id order
+	void listPhysicals(std::vector<std::shared_ptr<Physical>> &list);
+
+	// Entities whose checkpointed state has changed, queued by the entities themselves and
+	// taken by the world checkpoint
+	void markDirty(std::shared_ptr<Physical> item) { _dirty.push_back(item); };
+	void takeDirty(std::vector<std::shared_ptr<Physical>> &dirty);
+	size_t getNumDirty() const { return _dirty.size(); };
  
 private:
+	// Adds a loaded entity to the database and zone members, or to the prototypes if it's
+	// marked as one
+	void insertLoaded(pugi::xml_node &xnode, std::shared_ptr<Physical> newptr,
+															std::vector<std::shared_ptr<Physical>> &members);
+
 	std::map<std::string, std::shared_ptr<Entity>> _db;
 
+	std::map<std::string, std::shared_ptr<Physical>> _prototypes;
+
+	// Spawned entities are given the prototype's ID with this number after it
+	unsigned int _spawn_count = 0;
+
 	std::map<std::string, std::shared_ptr<Trait>> _traits;
+
+	std::vector<std::shared_ptr<ZoneReset>> _resets;
+
+	std::vector<std::shared_ptr<Physical>> _dirty;
 };
 
 
@@ -30,9 +30,9 @@ public:
    // Adds shared_ptr links between this object and others in the EntityDB. Polymorphic
    virtual void addLinks(EntityDB &edb, std::shared_ptr<Physical> self);
 
-	size_t getEquipListSize() const { return _equip_list.size(); };
-	const char *getEquipListName(size_t index) const { return _equip_list[index].first.c_str(); };
-	const char *getEquipListGroup(size_t index) const { return _equip_list[index].second.c_str(); };
+	size_t getEquipListSize() const { return _equip_list->size(); };
+	const char *getEquipListName(size_t index) const { return (*_equip_list)[index].first.c_str(); };
+	const char *getEquipListGroup(size_t index) const { return (*_equip_list)[index].second.c_str(); };
 
 protected:
 
@@ -44,8 +44,8 @@ protected:
 
 private:
 
-	// Stores target info for linking to body parts
-	std::vector<std::pair<std::string, std::string>> _equip_list;
+	// Stores target info for linking to body parts. Shared by every entity spawned from this one
+	std::shared_ptr<std::vector<std::pair<std::string, std::string>>> _equip_list;
 
 	std::bitset<32> _equipflags;
 
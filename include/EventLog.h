@@ -0,0 +1,96 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+
+/***************************************************************************************
+ * EventLog - a structured stream of engine events (connections, logins, commands, errors)
+ *				  written as compact binary records for offline querying (see aimeevents). Records
+ *				  are encoded into a buffer under a mutex and written out in batches.
+ *
+ *				  File layout: the 8-byte header "AIMEEV" + version + 0, then records of:
+ *						u32 length (of what follows), u8 type, u64 timestamp (usecs since epoch),
+ *						varint value, varint length + subject, varint length + detail
+ *				  All integers are little-endian. What subject, detail and value hold for each
+ *				  type is listed with event_types.
+ *
+ ***************************************************************************************/
+class EventLog
+{
+public:
+	EventLog();
+	EventLog(const EventLog &copy_from);
+
+	~EventLog();
+
+	//								 subject			detail			 value
+	enum event_types { NoEvent,
+							 Connect,		// IP address		-					 -
+							 Disconnect,	// player ID		-					 -
+							 Login,			// player ID		-					 -
+							 Command,		// actor ID		action ID		 execute usecs
+							 ScriptError,	// script ID		error message	 -
+							 LoadFailure,	// file/entity		error message	 -
+							 NumEventTypes };
+
+	// A decoded record, for readers
+	struct event {
+		event_types type;
+		uint64_t timestamp;
+		uint64_t value;
+		std::string subject;
+		std::string detail;
+	};
+
+	static const unsigned char version = 1;
+
+	// Starts writing events to filename (appending), flushing when flush_bytes build up
+	void open(const char *filename, size_t flush_bytes);
+	void close();
+
+	bool isOpen() const { return _enabled; };
+
+	// Records an event. Does nothing if the log is not open
+	void writeEvent(event_types type, const char *subject, const char *detail = "", uint64_t value = 0);
+	void writeEvent(event_types type, const std::string &subject, const std::string &detail,
+																							uint64_t value = 0) {
+		writeEvent(type, subject.c_str(), detail.c_str(), value);
+	};
+
+	// Writes anything buffered to the file
+	void flush();
+
+	// Writes out the buffer if it has been flush_ms since the last write
+	void checkFlush(std::chrono::milliseconds flush_ms);
+
+	// For readers--the header check and one record at a time
+	static bool readHeader(FILE *fptr);
+	static bool readEvent(FILE *fptr, event &ev);
+
+	static const char *getTypeName(event_types type);
+	static event_types getTypeByName(const char *name);
+
+private:
+
+	static void appendVarint(std::string &buf, uint64_t value);
+	static bool getVarint(const unsigned char *&pos, const unsigned char *end, uint64_t &value);
+
+	void writeBuffer();
+
+	std::mutex _event_mutex;
+
+	FILE *_efptr = NULL;
+	std::atomic<bool> _enabled;
+
+	std::string _buffer;
+	size_t _flush_bytes = 0;
+
+	std::chrono::steady_clock::time_point _last_flush;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FILESTORE_H
+#define FILESTORE_H
+
+#include "PlayerStore.h"
+
+/***************************************************************************************
+ * FileStore - the original player store: one file per player in the user directory,
+ *				   <name>.plr, with old <name>.xml saves still read. Each file is replaced
+ *				   safely on its own, but a batch is not atomic as a whole.
+ *
+ ***************************************************************************************/
+class FileStore : public PlayerStore
+{
+public:
+	FileStore(const char *userdir);
+	virtual ~FileStore();
+
+	virtual bool open();
+	virtual int load(const std::string &name, std::string &record);
+	virtual bool exists(const std::string &name);
+	virtual bool saveBatch(const std::vector<store_record> &records);
+	virtual void listNames(std::vector<std::string> &names);
+	virtual time_t lastSaved(const std::string &name);
+
+	virtual const char *getTypeName() const { return "file"; };
+
+	// Replaces filename with the data: temp file, fsync, rename
+	static bool writeFile(const std::string &filename, const std::string &data);
+
+	// Flushes a directory so renames and new files in it survive a crash
+	static void syncDir(const std::string &dir);
+
+private:
+	void getUserFile(const std::string &name, std::string &filename, bool legacy = false) const;
+
+	std::string _userdir;
+};
+
+#endif
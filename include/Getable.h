@@ -43,6 +43,9 @@ public:
 
 protected:
 
+   virtual void saveState(RecordWriter &rec) const;
+   virtual void loadState(RecordReader &rec, EntityDB &edb);
+
    virtual void saveData(pugi::xml_node &entnode) const;
    virtual int loadData(pugi::xml_node &entnode);
 
@@ -51,7 +54,8 @@ protected:
 
 private:
 
-	std::vector<std::pair<std::string, std::string> > _roomdesc;
+	// Set when loaded and shared by every entity spawned from this one
+	std::shared_ptr<std::vector<std::pair<std::string, std::string>>> _roomdesc;
 
 	std::bitset<32> _getflags;
 
@@ -0,0 +1,48 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+
+/***************************************************************************************
+ * Histogram - records counts of values (usually microseconds) in log-linear buckets, in
+ *				   the style of HDR histograms. Each power of two is split into 32 sub-buckets,
+ *				   so percentiles come out within about 3% of the true value at any scale
+ *				   while recording stays a couple of shifts and an increment.
+ *
+ ***************************************************************************************/
+class Histogram
+{
+public:
+	Histogram();
+	Histogram(const Histogram &copy_from);
+
+	~Histogram();
+
+	Histogram &operator = (const Histogram &copy_from);
+
+	void record(uint64_t value);
+	void merge(const Histogram &other);
+	void reset();
+
+	uint64_t getCount() const { return _count; };
+	uint64_t getTotal() const { return _total; };
+	uint64_t getMax() const { return _max; };
+	uint64_t getMean() const { return (_count == 0) ? 0 : _total / _count; };
+
+	// Gets the value at the given percentile (0-100), accurate to the bucket size
+	uint64_t getPercentile(double pct) const;
+
+private:
+
+	static unsigned int getBucket(uint64_t value);
+	static uint64_t getBucketValue(unsigned int bucket);
+
+	std::vector<uint32_t> _buckets;
+
+	uint64_t _count = 0;
+	uint64_t _total = 0;
+	uint64_t _max = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef IPTHROTTLE_H
+#define IPTHROTTLE_H
+
+#include <unordered_map>
+#include <mutex>
+#include <ctime>
+#include "TokenBucket.h"
+
+/***************************************************************************************
+ * IPThrottle - a TokenBucket per IP address, for limiting how fast any one address can
+ *					 do something (connect, try passwords). Addresses that have been quiet long
+ *					 enough for their bucket to refill are forgotten, and the table is capped so
+ *					 a flood from many addresses can't grow it without bound. Thread-safe.
+ *
+ ***************************************************************************************/
+class IPThrottle
+{
+public:
+	IPThrottle();
+	IPThrottle(const IPThrottle &copy_from);
+
+	~IPThrottle();
+
+	// Tokens per second for each address (0 for no limit) and how many can be saved up
+	void configure(float rate, float burst, size_t max_addrs = 65536);
+
+	// Spends cost from the address's bucket if it has tokens, returns false if it doesn't
+	bool allow(unsigned long ipaddr, float cost = 1.0);
+
+	size_t getNumAddrs();
+
+private:
+	struct ip_entry {
+		TokenBucket bucket;
+		time_t last_seen;
+	};
+
+	void prune(time_t now);
+
+	std::mutex _throttle_mutex;
+
+	float _rate = 0.0;
+	float _burst = 0.0;
+	size_t _max_addrs = 65536;
+
+	std::unordered_map<unsigned long, ip_entry> _addrs;
+	time_t _last_prune = 0;
+};
+
+#endif
@@ -3,11 +3,17 @@
 
 #include <bitset>
 #include <vector>
+#include <memory>
 #include "Physical.h"
+#include "Broadcast.h"
 
 class EntityDB;
 class Location;
 class Player;
+class NPC;
+class Getable;
+class Static;
+class Organism;
 
 struct locexit;
 
@@ -31,6 +37,7 @@ public:
 	enum exitflags {Hidden, Special};
 	enum exitdirs {North, South, East, West, Up, Down, Northeast, Northwest, Southeast, Southwest, 
 					   Custom};
+	enum renderblocks {RenderHeader = 1, RenderExits = 2, RenderContents = 4, RenderAll = 7};
 
 	void setDesc(const char *newdesc);
    void setTitle(const char *newtitle);
@@ -54,12 +61,38 @@ public:
 	// Assembles a formatted list of the visible exits
 	const char *getExitsStr(std::string &buf);
 
+	// The exits an NPC may wander through and where they lead
+	void getMobileExits(std::vector<std::pair<std::string, std::shared_ptr<Location>>> &exits);
+
    // Send a message to this entity or its contents - class-specific behavior
    virtual void sendMsg(const char *msg, std::shared_ptr<Physical> exclude=nullptr, std::shared_ptr<Physical> exclude2=nullptr); 
    virtual void sendMsg(std::string &msg, std::shared_ptr<Physical> exclude=nullptr, std::shared_ptr<Physical> exclude2=nullptr); 
+	void sendBroadcast(Broadcast &bcast, std::shared_ptr<Physical> exclude, std::shared_ptr<Physical> exclude2=nullptr);
 
 	static exitdirs getOppositeDir(exitdirs dir);
 
+   // Keeps the typed indexes below in step with _contained
+   virtual bool addPhysical(std::shared_ptr<Physical> new_phys);
+   virtual bool removePhysical(std::shared_ptr<Physical> phys_ptr);
+	virtual size_t purgePhysical(std::shared_ptr<Physical> item);
+
+	// Finds a player or NPC in this location without scanning objects
+	std::shared_ptr<Organism> getOrganismByName(const char *name, bool allow_abbrev = true);
+
+	const std::vector<std::shared_ptr<Player>> &getPlayers() const { return _players; };
+	const std::vector<std::shared_ptr<NPC>> &getNPCs() const { return _npcs; };
+
+	// Cached room description blocks, shared by everyone who looks until something changes
+	Broadcast &getHeaderRender();
+	Broadcast &getExitsRender();
+	Broadcast &getContentsRender();
+
+	// Lists the visible players apart from exclude (the per-viewer part of the contents)
+	const char *listPlayers(std::string &buf, const Physical *exclude = NULL) const;
+
+	// Drops the cached blocks (renderblocks mask) so they are rebuilt on the next look
+	void invalidateRender(unsigned int blocks = RenderAll);
+
 protected:
 
    virtual void saveData(pugi::xml_node &entnode) const;
@@ -76,6 +109,26 @@ private:
 	std::bitset<32> _locflags;
 
 	std::vector<locexit> _exits;
+
+	// Typed views of _contained so room events only visit the kind of entity they care about
+	std::vector<std::shared_ptr<Player>> _players;
+	std::vector<std::shared_ptr<NPC>> _npcs;
+	std::vector<std::shared_ptr<Getable>> _getables;
+	std::vector<std::shared_ptr<Static>> _statics;	// Non-getable statics, including doors
+
+	// Assembles the doors, getables and NPCs part of the contents list
+	const char *listObjects(std::string &buf) const;
+
+	// Render cache - a null pointer means the block is dirty
+	std::unique_ptr<Broadcast> _header_render;
+	std::unique_ptr<Broadcast> _exits_render;
+	std::unique_ptr<Broadcast> _contents_render;
+
+	// The exits list shows the titles of the rooms it leads to. Any location's title changing
+	// bumps _title_gen, and an exits cache built before that is rebuilt. Titles rarely change
+	// once the world is loaded, so this costs next to nothing
+	static unsigned int _title_gen;
+	unsigned int _exits_title_gen = 0;
 };
 
 
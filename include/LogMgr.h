@@ -2,11 +2,18 @@
 #define LOGMGR_H
 
 #include <string>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <chrono>
 
 /********************************************************************************
  * LogMgr - Log file manager. Includes setting log levels and a function to write
- *          a log entry if it is below a specified log level. Opens for each write
- *          in append mode to help with thread conflicts (but no mutexing)
+ *          a log entry if it is below a specified log level. Once the writer is
+ *          started, entries are formatted by the logging thread, pushed onto a
+ *          lock-free ring and written to disk in batches by a background thread.
+ *          Before that (and after it stops) entries are written directly.
  ********************************************************************************/
 
 class LogMgr {
@@ -31,11 +38,52 @@ class LogMgr {
 
       void changeFilename(const char *filename);
 
+		// Starts/stops the background writer. Records are buffered until flush_bytes have
+		// built up or flush_ms have passed
+		void startWriter(size_t ring_size, unsigned int flush_ms, size_t flush_bytes);
+		void stopWriter();
+
+		// Records lost because the ring was full
+		unsigned long getTotalDropped() const { return _total_dropped; };
+
    private:
+		// One entry in the ring. seq tells producers and the writer whose turn the slot is
+		struct logslot {
+			std::atomic<size_t> seq;
+			std::string record;
+		};
+
+		static void appendTimestamp(std::string &buf);
+
+		bool pushRecord(std::string &record);
+		bool popRecord(std::string &batch);
+
+		void writeSync(const std::string &record);
+		void openLog();
+		void runWriter();
+
       std::string _log_file;  // Path/name of the log to write to
       unsigned int _log_lvl;  // The verbosity level
    
       FILE *_lfptr = NULL;
+		std::mutex _sync_mutex;	// Guards _lfptr for direct writes
+
+		// The ring buffer--many threads write, only the writer thread reads
+		std::unique_ptr<logslot[]> _ring;
+		size_t _ring_mask = 0;
+		std::atomic<size_t> _head;
+		size_t _tail = 0;
+
+		std::atomic<bool> _async;
+		std::atomic<unsigned int> _pushing;	// Producers between checking _async and publishing
+		std::atomic<unsigned long> _dropped;
+		unsigned long _total_dropped = 0;
+
+		std::unique_ptr<std::thread> _writer_thread;
+		std::atomic<bool> _exit_writer;
+
+		std::chrono::milliseconds _flush_interval;
+		size_t _flush_bytes = 0;
 };
 
 #endif // ALMGR_H
@@ -0,0 +1,97 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include "PlayerStore.h"
+
+/***************************************************************************************
+ * LogStore - an embedded key-value player store in a single append-only file. Every save
+ *				  appends the batch's records followed by a commit marker and syncs once, so the
+ *				  file is its own write-ahead log: on open it is replayed and anything after
+ *				  the last commit (a batch cut off by a crash) is dropped. Damage with a later
+ *				  batch after it is not a torn write, and the store refuses to open. An
+ *				  in-memory index maps each name to its newest record. When superseded records
+ *				  take up most of the file, the live ones are copied to a new file that
+ *				  replaces it. Saving an empty record deletes the name. Also used for the world
+ *				  checkpoint.
+ *
+ *				  Entry layout (little endian): crc32 (4, covers the rest of the entry),
+ *				  type (1), name length (4), data length (4), save time (8), name, data
+ *
+ ***************************************************************************************/
+class LogStore : public PlayerStore
+{
+public:
+	// Players not found in the log are looked for in the fallback (if any), so a MUD can move
+	// over from another store one player at a time as they're saved
+	LogStore(const char *dbfile, PlayerStore *fallback = nullptr);
+	virtual ~LogStore();
+
+	virtual bool open();
+	void close();
+
+	virtual int load(const std::string &name, std::string &record);
+	virtual bool exists(const std::string &name);
+	virtual bool saveBatch(const std::vector<store_record> &records);
+	virtual void listNames(std::vector<std::string> &names);
+	virtual time_t lastSaved(const std::string &name);
+
+	virtual const char *getTypeName() const { return "log"; };
+
+	// What the store holds, for the log ("player store" unless set)
+	void setDescription(const char *what) { _what = what; };
+
+	// Compacts once the file is at least min_bytes and more than max_dead percent superseded
+	void setCompaction(uint64_t min_bytes, unsigned int max_dead) { _compact_min = min_bytes;
+																						 _compact_dead = max_dead; };
+
+	virtual void registerMetrics(MetricsRegistry &metrics);
+
+private:
+	enum entry_type { Put = 1, Commit = 2 };
+
+	struct index_entry {
+		uint64_t offset;		// Where the entry starts
+		uint32_t data_len;
+		time_t saved;
+	};
+
+	static const size_t header_len = 21;
+
+	static void encodeEntry(std::string &buf, entry_type type, const std::string &name,
+																				const std::string &data, time_t saved);
+	static uint64_t entryLen(const std::string &name, uint32_t data_len) {
+																	return header_len + name.size() + data_len; };
+
+	static bool validEntry(const std::string &contents, uint64_t pos, uint64_t &len);
+	bool replay();
+	void indexRecord(const std::string &name, const index_entry &entry);
+	bool readAt(uint64_t offset, size_t len, std::string &buf) const;
+	static bool writeAt(int fd, const std::string &buf, uint64_t offset);
+	bool compact();
+
+	std::string _dbfile;
+	std::string _what = "player store";
+	int _fd = -1;
+
+	std::unique_ptr<PlayerStore> _fallback;
+
+	// Sorted, so it doubles as the name listing
+	std::map<std::string, index_entry> _index;
+
+	uint64_t _file_size = 0;
+	uint64_t _live_bytes = 0;
+
+	uint64_t _compact_min = 1 << 20;
+	unsigned int _compact_dead = 50;
+
+	std::mutex _store_mutex;
+
+	MetricGauge _size_metric;
+	MetricGauge _live_metric;
+	MetricCounter _compact_metric;
+};
+
+#endif
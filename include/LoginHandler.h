@@ -10,7 +10,7 @@ class LoginHandler : public Handler
 {
 public:
    enum login_state {AskUser, AskPasswd, AskCreate, CreatePasswd1, CreatePasswd2, GetGender, GetRace, GetClass,
-                     LoginMenu };
+                     LoginMenu, Authenticating };
 
 	LoginHandler(std::shared_ptr<Player> plr, libconfig::Config &mud_cfg, login_state start_state=AskUser);
 	LoginHandler(const LoginHandler &copy_from);
@@ -30,12 +30,20 @@ private:
 
 	void addTrait(std::shared_ptr<Player> plr, const char *trait, bool mask = false);
 
+	// Called on the game thread when the auth workers are done with the password
+	void finishCheck(bool matched);
+	void finishCreate(const std::vector<unsigned char> &passwd_hash);
+
 	libconfig::Config &_mud_cfg;
 	
 	std::string _username;
 	std::string _new_passwd;
 
 	login_state _cur_state;
+
+	// Auth completions reach this handler through here, and find it gone if the handler
+	// was destroyed while the hash was running
+	std::shared_ptr<LoginHandler *> _handle;
 };
 
 
@@ -7,6 +7,12 @@
 #include "LogMgr.h"
 #include "ActionMgr.h"
 #include "ScriptEngine.h"
+#include "TickProfiler.h"
+#include "EventLog.h"
+#include "Metrics.h"
+#include "AuthPool.h"
+#include "WorldCheckpoint.h"
+#include "BehaviorMgr.h"
 
 /***************************************************************************************
  * MUD - class that manages the mud as a whole. Each instance of a MUD class will be its
@@ -37,6 +43,12 @@ public:
 	UserMgr *getUserMgr() { return &_users; };
 	EntityDB *getEntityDB() { return &_entity_db; };
 	ScriptEngine *getScriptEngine() { return &_scripts; };
+	TickProfiler *getProfiler() { return &_profiler; };
+	EventLog *getEventLog() { return &_events; };
+	MetricsRegistry *getMetrics() { return &_metrics; };
+	AuthPool *getAuthPool() { return &_auth; };
+	WorldCheckpoint *getWorldCheckpoint() { return &_world; };
+	BehaviorMgr *getBehaviorMgr() { return &_behaviors; };
 
 private:
    // Publicly-accessible attributes
@@ -47,17 +59,41 @@ private:
 	// Stores all the non-player entities in the game
 	EntityDB _entity_db;
 
+	// Saves the changing state of the zones so a restart doesn't reset them
+	WorldCheckpoint _world;
+
 	ActionMgr _actions;
 
+	// Drives the NPCs in zones that have players in them
+	BehaviorMgr _behaviors;
+
 	// Stores and manages the players connected to the game
 	UserMgr _users;
 
 	// Initialized and prepped to execute python scripts
 	ScriptEngine _scripts;
 
+	// Hashes passwords for logins off the game thread
+	AuthPool _auth;
+
+	// Timings of the game loop for finding what lags it
+	TickProfiler _profiler;
+
+	// Live figures for the metrics endpoint. Declared after the subsystems whose metrics it lists
+	MetricsRegistry _metrics;
+	MetricSummary _tick_metric;
+	MetricCounter _overrun_metric;
+
+	// Structured events for offline querying, and how often the buffer is written out
+	EventLog _events;
+	std::chrono::milliseconds _event_flush;
+
 	bool _shutdown_mud = false;
 
 	long _time_between_heartbeat;
+
+	// Microseconds of each heartbeat the game loop may spend before deferring work
+	long _tick_budget;
 };
 
 
@@ -0,0 +1,138 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+#include "Histogram.h"
+#include "FileDesc.h"
+
+/***************************************************************************************
+ * MetricCounter/MetricGauge/MetricSummary - live engine figures. Counters only go up,
+ *					gauges are set to the current value and summaries track a distribution
+ *					(count, sum and percentiles). Updating counters and gauges is a relaxed
+ *					atomic, so they can be left in hot paths.
+ *
+ ***************************************************************************************/
+class MetricCounter
+{
+public:
+	MetricCounter():_value(0) {};
+
+	void add(uint64_t amount = 1) { _value.fetch_add(amount, std::memory_order_relaxed); };
+	uint64_t get() const { return _value.load(std::memory_order_relaxed); };
+
+private:
+	std::atomic<uint64_t> _value;
+};
+
+class MetricGauge
+{
+public:
+	MetricGauge():_value(0) {};
+
+	void set(int64_t value) { _value.store(value, std::memory_order_relaxed); };
+	void add(int64_t amount) { _value.fetch_add(amount, std::memory_order_relaxed); };
+	int64_t get() const { return _value.load(std::memory_order_relaxed); };
+
+private:
+	std::atomic<int64_t> _value;
+};
+
+class MetricSummary
+{
+public:
+	MetricSummary():_hist() {};
+
+	void record(uint64_t value);
+
+	// Copies the histogram so it can be read without holding up recorders
+	Histogram getSnapshot();
+
+private:
+	std::mutex _summary_mutex;
+	Histogram _hist;
+};
+
+/***************************************************************************************
+ * MetricsRegistry - the list of the engine's metrics. Subsystems own their metrics and
+ *						   register them once at startup, and formatText renders all of them in the
+ *						   Prometheus text exposition format when scraped.
+ *
+ ***************************************************************************************/
+class MetricsRegistry
+{
+public:
+	MetricsRegistry();
+	MetricsRegistry(const MetricsRegistry &copy_from);
+
+	~MetricsRegistry();
+
+	// Adds a metric to the list. The caller keeps ownership and must keep it around as long
+	// as the registry
+	void addCounter(const char *name, const char *help, MetricCounter &counter);
+	void addGauge(const char *name, const char *help, MetricGauge &gauge);
+	void addSummary(const char *name, const char *help, MetricSummary &summary);
+
+	void formatText(std::string &buf);
+
+private:
+	enum metric_type { Counter, Gauge, Summary };
+
+	struct metric {
+		std::string name;
+		std::string help;
+		metric_type type;
+		MetricCounter *counter;
+		MetricGauge *gauge;
+		MetricSummary *summary;
+	};
+
+	void addMetric(const metric &new_metric);
+
+	std::mutex _reg_mutex;
+
+	std::vector<metric> _metrics;
+};
+
+/***************************************************************************************
+ * MetricsServer - a minimal HTTP listener that answers GET /metrics with the registry's
+ *					    text. Polled from the network thread, and costs a select() on an idle
+ *					    socket when nobody is scraping.
+ *
+ ***************************************************************************************/
+class MetricsServer
+{
+public:
+	MetricsServer(MetricsRegistry &registry);
+	~MetricsServer();
+
+	void bindSvr(const char *ip_addr, unsigned short port);
+	bool isListening() const { return _listening; };
+
+	// Accepts scrapers and answers any whose request has arrived
+	void handleRequests();
+
+	void shutdown();
+
+private:
+	struct scraper {
+		std::unique_ptr<SocketFD> sock;
+		std::string request;
+		time_t started;
+	};
+
+	void sendResponse(SocketFD &sock, const std::string &request);
+
+	MetricsRegistry &_registry;
+
+	std::unique_ptr<SocketFD> _sockfd;
+	bool _listening = false;
+
+	std::vector<scraper> _scrapers;
+};
+
+#endif
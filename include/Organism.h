@@ -46,7 +46,7 @@ public:
 	virtual void sendTraits();
 
 	// Series of functions that retrieve class attribute data
-	virtual const char *getExamine() const { return _examine.c_str(); };
+	virtual const char *getExamine() const { return _desc->examine.c_str(); };
 
 	const char *getReview(review_type review);
    const char *getReview(const char *reviewstr);
@@ -56,7 +56,7 @@ public:
                                  Location::exitdirs dir=Location::Custom, const char *customdir=NULL);
 	void setReview(review_type review, const char *new_review);
 
-	const char *getTitle() const { return _title.c_str(); };
+	const char *getTitle() const { return _desc->title.c_str(); };
 
 	// Manage body parts for wearing and wielding equipment
 	void addBodyPart(const char *group, const char *name);
@@ -95,6 +95,8 @@ protected:
 
    virtual void saveData(pugi::xml_node &entnode) const;
    virtual int loadData(pugi::xml_node &entnode);
+   virtual void saveRecord(RecordWriter &rec) const;
+   virtual int loadRecord(RecordReader &rec);
 
    virtual bool setFlagInternal(const char *flagname, bool newval);
    virtual bool isFlagSetInternal(const char *flagname, bool &results);
@@ -105,10 +107,16 @@ protected:
 	StrFormatter _rformatter;
 
 private:
-	std::string _title;
-	std::string _examine;
-
-	std::vector<std::string> _reviews;
+	// Points the review formatter at this organism's name once it's loaded
+	void setupReviewFormat();
+
+	// Set when loaded and shared by every entity spawned from this one
+	struct organism_desc {
+		std::string title;
+		std::string examine;
+		std::vector<std::string> reviews;
+	};
+	std::shared_ptr<organism_desc> _desc;
 
 	std::bitset<32> _orgflags;
 
@@ -13,6 +13,7 @@
 
 class EntityDB;
 class Organism;
+class Broadcast;
 
 /***************************************************************************************
  * Physical - Tangible objects in the MUD. Only child classes are enstantiated
@@ -63,12 +64,18 @@ public:
 
 	bool hasAttribute(const char *attrib);
 
+	// The attributes as a set that shares the Attribute objects (copy-on-write), so a set taken
+	// now can be put back later, such as by a zone reset restoring a killed NPC
+	typedef std::map<std::string, std::shared_ptr<Attribute>> attr_map;
+	const attr_map &getAttributes() const { return _attributes; };
+	void resetAttributes(const attr_map &attributes) { _attributes = attributes; };
+
    // Move an physity to a new container (removes from the old)
    bool movePhysical(std::shared_ptr<Physical> new_loc, std::shared_ptr<Physical> self = nullptr);
 
    // Add or remove objects to/from the container in this physity
-   bool addPhysical(std::shared_ptr<Physical> new_phys);
-   bool removePhysical(std::shared_ptr<Physical> new_phys);
+   virtual bool addPhysical(std::shared_ptr<Physical> new_phys);
+   virtual bool removePhysical(std::shared_ptr<Physical> new_phys);
 
    // Checks if this physity contains the parameter physity
    bool containsPhysical(std::shared_ptr<Physical> phys_ptr);
@@ -78,11 +85,18 @@ public:
 	std::shared_ptr<Physical> containsFlag(const char *flagname, int recursive_lvl = INT_MAX);
 	std::shared_ptr<Physical> containsFlags(std::vector<std::string> &flaglist, int recursive_lvl = INT_MAX);
 
+	// Fast version of containsLit(0) - tracks lit Statics directly in this container
+	bool hasLitContents() const { return (_lit_count > 0); };
+	void changeLitCount(int delta) { _lit_count += delta; };
+
    // Retrieved the shared pointer matching the parameter information
    std::shared_ptr<Physical> getContainedByPtr(Physical *pptr);
 	std::shared_ptr<Physical> getContainedByID(const char *id);
 	virtual std::shared_ptr<Physical> getContainedByName(const char *name, bool allow_abbrev = true);
 
+	// Checks this physical's game name against a lowercase name
+	bool matchesGameName(const std::string &namebuf, bool allow_abbrev) const;
+
 	std::shared_ptr<Physical> getCurLoc() { return _cur_loc; };
 
 	// Adds shared_ptr links between this object and others in the PhysicalDB. Polymorphic
@@ -97,6 +111,9 @@ public:
    virtual void sendMsg(std::string &msg, std::shared_ptr<Physical> exclude=nullptr, std::shared_ptr<Physical> exclude2=nullptr) 
 																				{ (void) msg; (void) exclude; (void) exclude2; };
 
+	// Send a message that is going out to many recipients at once - defaults to sendMsg
+	virtual void sendBroadcast(Broadcast &bcast);
+
 	// Removes all references to the parameter from the Entities in the database so 
 	// it can be safely removed
 	virtual size_t purgePhysical(std::shared_ptr<Physical> item);
@@ -106,6 +123,17 @@ public:
 												std::vector<std::pair<std::string, float>> *variable_floats = NULL, 
 												std::vector<std::pair<std::string, std::string>> *variable_strs = NULL);
 
+	// World checkpointing (see WorldCheckpoint). Zone entities are tracked once loaded and tell
+	// the EntityDB when anything their saved state covers changes
+	void trackState(bool track) { _state_tracked = track; };
+	bool isStateTracked() const { return _state_tracked; };
+	void clearStateDirty() { _state_dirty = false; };
+
+	// Encodes the state a checkpoint keeps for this entity, or puts it back. restoreState
+	// returns false (logged) if the state can't be read
+	void snapshotState(std::string &state) const;
+	bool restoreState(EntityDB &edb, const std::string &state);
+
 	std::list<std::shared_ptr<Physical>>::const_iterator beginContained(){ return _contained.begin(); };
 	std::list<std::shared_ptr<Physical>>::const_iterator endContained(){ return _contained.end(); };
 
@@ -118,6 +146,23 @@ protected:
 
 	virtual void saveData(pugi::xml_node &entnode) const;
 	virtual int loadData(pugi::xml_node &entnode);
+	virtual void saveRecord(RecordWriter &rec) const;
+	virtual int loadRecord(RecordReader &rec);
+
+	// What snapshotState/restoreState cover: changes made in play to what the zone files set up
+	virtual void saveState(RecordWriter &rec) const;
+	virtual void loadState(RecordReader &rec, EntityDB &edb);
+
+	// Called when something saveState writes changes
+	void stateChanged();
+
+	// Copy-on-write for data shared with a prototype or the entities spawned from one: gives
+	// this entity its own copy of what ptr points to if anything else shares it
+	template <class T> static T &writableCopy(std::shared_ptr<T> &ptr) {
+		if (ptr.use_count() > 1)
+			ptr = std::make_shared<T>(*ptr);
+		return *ptr;
+	}
 
 	virtual bool setFlagInternal(const char *flagname, bool newval);
 	virtual bool isFlagSetInternal(const char *flagname, bool &results);
@@ -130,11 +175,23 @@ protected:
 private:
 	Physical();	// Should not be called
 
+	static bool isLitStatic(std::shared_ptr<Physical> phys_ptr);
+
 	std::shared_ptr<Physical> _cur_loc;
 	
-	std::vector<std::pair<std::string, std::string>> _specials;
+	// Scripts by trigger. Set when loaded and shared by every entity spawned from this one
+	std::shared_ptr<std::vector<std::pair<std::string, std::string>>> _specials;
 
+	// Spawned entities share the prototype's Attribute objects until they change one
 	std::map<std::string, std::shared_ptr<Attribute>> _attributes;
+
+	Attribute &writableAttribute(std::shared_ptr<Attribute> &attr);
+
+	// Number of lit Statics directly in _contained
+	int _lit_count = 0;
+
+	bool _state_tracked = false;
+	bool _state_dirty = false;
 };
 
 
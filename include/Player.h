@@ -10,6 +10,7 @@
 #include "Organism.h"
 #include "Handler.h"
 #include "TCPConn.h"
+#include "TokenBucket.h"
 
 class MUD;
 
@@ -36,6 +37,11 @@ public:
    // Send a message to this entity or its contents - class-specific behavior
    virtual void sendMsg(const char *msg, std::shared_ptr<Physical> exclude=nullptr, std::shared_ptr<Physical> exclude2=nullptr); 
    virtual void sendMsg(std::string &msg, std::shared_ptr<Physical> exclude=nullptr, std::shared_ptr<Physical> exclude2=nullptr);
+	virtual void sendBroadcast(Broadcast &bcast);
+
+	// Converts MUD-formatted text for a telnet client with the given output profile
+	static void formatForTelnet(const std::string &unformatted, std::string &formatted, bool use_color,
+											unsigned int wrap_width, unsigned int &last_wrap);
 
    // Sends the prompt of the top message handler to the player
    virtual void sendPrompt();
@@ -43,9 +49,12 @@ public:
 	// Sends the player a blank the size of the prompt to clear it from a line
 	virtual void clearPrompt();
 
-	// Update dynamic prompts and send to the connection
+	// Rebuilds the prompt and sends it to the connection if it has been marked dirty
 	void updatePrompt();
 
+	// Flags the prompt for rebuilding, such as when the handler or something it shows changes
+	void markPromptDirty() { _prompt_dirty = true; };
+
 	// Displays the current location to the user
 	virtual void sendCurLocation();
 
@@ -59,10 +68,15 @@ public:
 	// configures the connecting user for entering the MUD
 	void welcomeUser(libconfig::Config &mud_cfg, std::shared_ptr<Player> thisplr);
 
-	// Loops through the player's connection, handling data
-	void handleConnection(time_t timeout);
+	// Loops through the player's connection, handling data. Returns true if the player needs
+	// the game thread's attention
+	bool handleConnection(time_t timeout);
 
 	bool popCommand(std::string &cmd);
+	bool hasCommands();
+
+	// Limits how fast this player's commands are handled
+	TokenBucket &getCmdBucket() { return _cmd_bucket; };
 
 	// Sends the command through the current message handler on top of the stack
 	int handleCommand(std::string &cmd);
@@ -74,11 +88,14 @@ public:
    // data from the handler as appropriate
 	void popHandler(std::vector<std::string> &results);
 
-   // Functions for loading and saving user info to disk
-   int loadUser(const char *userdir, const char *username);
-   bool saveUser(const char *userdir) const;
+   // Loading and saving user info. These convert to and from the records kept by the
+   // PlayerStore--UserMgr does the reading and writing
+   int loadUser(const char *username, const std::string &record);
+   void snapshotUser(std::string &record) const;
    virtual void saveData(pugi::xml_node &entnode) const;
    virtual int loadData(pugi::xml_node &entnode);
+   virtual void saveRecord(RecordWriter &rec) const;
+   virtual int loadRecord(RecordReader &rec);
 
 	// Set up config info for the reviews, mainly for a new player
 	void setReviews(const char *username);
@@ -90,6 +107,17 @@ public:
 
 	bool checkPassword(const char *cleartext);
 
+	// The stored salt+hash, for handing to the auth workers and taking back a new one
+	const std::vector<unsigned char> &getPasswdHash() const { return _passwd_hash; };
+	void setPasswdHash(const std::vector<unsigned char> &passwd_hash) { _passwd_hash = passwd_hash; };
+
+	// Thread-safe versions that work on a salt+hash buffer instead of this player
+	static void makePasswdHash(const char *cleartext, std::vector<unsigned char> &passwd_hash);
+	static bool matchPasswdHash(const char *cleartext, const std::vector<unsigned char> &passwd_hash);
+
+	// Memory each hash uses in KiB (Argon2 m_cost), for sizing the auth workers
+	static const uint32_t passwd_mem_kb = (1<<16);
+
 	// Quit to the game menu
 	void exitMUD();
 	
@@ -97,6 +125,11 @@ public:
 	void quit();
 	
 	TCPConn::conn_status getConnStatus() { return _conn->getConnStatus(); };
+	unsigned long getIPAddr() { return _conn->getIPAddr(); };
+
+	// Fast flag access for code that checks the same Player flags against many players
+	static unsigned int lookupPFlag(const char *flagname);
+	const std::bitset<32> &getPFlags() const { return _pflags; };
 
 	virtual void kill();
 
@@ -110,8 +143,10 @@ protected:
 
 private:
 
+	int loadUserXML(const char *username, const std::string &record);
+
 	void formatForTelnet(const std::string &unformatted, std::string &formatted);
-	void generatePasswdHash(const char *cleartext, std::vector<unsigned char> &buf,
+	static void generatePasswdHash(const char *cleartext, std::vector<unsigned char> &buf,
                                                                        std::vector<unsigned char> &salt);
 	std::bitset<32> _pflags;
 
@@ -121,11 +156,17 @@ private:
 
 	std::stack<std::unique_ptr<Handler>> _handler_stack;
 
+	// The prompt last sent to the connection and whether it needs rebuilding
+	std::string _prompt;
+	bool _prompt_dirty = true;
+
 	// A queue of commands read in from the connection. Mutex controls access as the socket
    // handling thread could create race conditions and queue is not thread-safe
 	std::mutex _cmd_mutex;
 	std::queue<std::string> _commands;
 
+	TokenBucket _cmd_bucket;
+
 	// User-specific formatting variables
 	bool _use_color = true;
 	unsigned int _wrap_width = 90;
@@ -0,0 +1,54 @@
+#ifndef PLAYERSTORE_H
+#define PLAYERSTORE_H
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include "Metrics.h"
+
+/***************************************************************************************
+ * PlayerStore - where player records are kept, behind UserMgr's loadUser/saveUser. A
+ *					  record is the player's encoded save (see Player::snapshotUser), looked up
+ *					  by lowercase player name. Stores are called from both the game thread and
+ *					  the save writer, so implementations must be thread-safe.
+ *
+ ***************************************************************************************/
+class PlayerStore
+{
+public:
+	virtual ~PlayerStore();
+
+	struct store_record {
+		std::string name;
+		std::string data;
+	};
+
+	// Gets the store ready, recovering it if need be. False (logged) if it can't be used
+	virtual bool open() = 0;
+
+	// Returns 1 and fills record if found, 0 if not found, -1 on an error (logged)
+	virtual int load(const std::string &name, std::string &record) = 0;
+
+	virtual bool exists(const std::string &name) = 0;
+
+	// Writes the records as one batch. Backends that can make it atomic do--either all of the
+	// batch is there after a crash or none of it is
+	virtual bool saveBatch(const std::vector<store_record> &records) = 0;
+	bool save(const std::string &name, const std::string &record);
+
+	// Every player name in the store, sorted
+	virtual void listNames(std::vector<std::string> &names) = 0;
+
+	// When the player was last saved, 0 if they're not in the store
+	virtual time_t lastSaved(const std::string &name) = 0;
+
+	virtual const char *getTypeName() const = 0;
+
+	// Adds any figures the backend keeps to the registry
+	virtual void registerMetrics(MetricsRegistry &metrics) { (void) metrics; };
+
+protected:
+	PlayerStore();
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <list>
+#include <vector>
 
 class Physical;
 class Organism;
@@ -96,30 +97,9 @@ public:
 	friend class IScript;
 	friend class IMUD;
 
-	class iterator : public std::iterator<
-                           std::input_iterator_tag,
-                           IContained,
-                           IContained &,
-                           IContained *,
-                           IContained >
-	{
-	public:
-		iterator(std::list<std::shared_ptr<Physical>>::iterator ptr);
-		iterator(const IPhysical::iterator &copy_from);
-		iterator operator++();
-		iterator operator++(int junk);
-		IContained &operator*();
-		IContained *operator->(); 
-		bool operator == (const iterator &rhs);
-		bool operator != (const iterator &rhs);
-
-	private:
-		std::list<std::shared_ptr<Physical>>::iterator _iptr;
-		IContained _cptr;
-	};
-
-	iterator begin();
-	iterator end();
+	// A copy of what this contains, taken in one call so a script can loop over it while the
+	// game thread changes the container
+	void getContents(std::vector<std::shared_ptr<Physical>> &contents);
 
 private:
    std::shared_ptr<Physical> _eptr;
@@ -157,6 +137,8 @@ public:
 
 	int addScript(IScript &the_script);
 
+	int spawn(const char *proto_id, IPhysical &loc);
+
 private:
 
 };
@@ -0,0 +1,85 @@
+#ifndef SAVEMGR_H
+#define SAVEMGR_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "PlayerStore.h"
+#include "Metrics.h"
+
+/***************************************************************************************
+ * SaveMgr - writes player saves to the PlayerStore on a background thread so saving
+ *				 doesn't stall the heartbeat. The game thread encodes a snapshot of the player
+ *				 and hands it over; the writer takes everything waiting and saves it to the
+ *				 store as one batch. A newer snapshot of a player that is still waiting
+ *				 replaces the older one. A batch that fails is queued again and retried
+ *				 with backoff.
+ *
+ ***************************************************************************************/
+class SaveMgr
+{
+public:
+	SaveMgr();
+	SaveMgr(const SaveMgr &copy_from);
+
+	~SaveMgr();
+
+	// The store to write to. Must be set before anything is saved and outlive the writer
+	void setStore(PlayerStore *store) { _store = store; };
+
+	// What is being saved, for the log ("player saves" unless set)
+	void setDescription(const char *what) { _what = what; };
+
+	void start();
+
+	// Writes everything still queued, then stops the writer
+	void stop();
+
+	bool isRunning() const { return (_writer != nullptr); };
+
+	// Queues a snapshot of the named player. With no writer running, it is written before
+	// this returns. Returns false only if a write made right away failed
+	bool queueSave(const std::string &name, std::string &&snapshot);
+
+	// Writes a snapshot before returning, after any save of the player already queued
+	bool saveNow(const std::string &name, const std::string &snapshot);
+
+	// Blocks until any save of the player that is queued or being written is in the store
+	void waitFor(const std::string &name);
+
+	// Adds the save queue figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+private:
+	bool writeBatch(const std::vector<PlayerStore::store_record> &records);
+	void runWriter();
+
+	PlayerStore *_store = nullptr;
+	std::string _what = "player saves";
+
+	std::unique_ptr<std::thread> _writer;
+	bool _exit_writer = false;
+
+	// Snapshots waiting to be written, by name so a player only has their newest waiting
+	std::mutex _queue_mutex;
+	std::condition_variable _queue_cond;
+	std::map<std::string, std::string> _pending;
+
+	// The batch the writer is on. Only the writer changes it, under _queue_mutex
+	std::map<std::string, std::string> _writing;
+	std::condition_variable _written_cond;
+
+	// The last batch failed, so what's pending is waiting to be retried
+	bool _failing = false;
+
+	MetricGauge _pending_metric;
+	MetricCounter _written_metric;
+	MetricCounter _coalesced_metric;
+	MetricCounter _failed_metric;
+	MetricSummary _write_metric;
+};
+
+#endif
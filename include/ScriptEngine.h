@@ -5,10 +5,17 @@
 #include <memory>
 #include <boost/python.hpp>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
 
 #include "PythonInterface.h"
+#include "Metrics.h"
 
 class Organism;
+class Script;
 
 class ScriptEngine {
 public:
@@ -27,23 +34,90 @@ public:
 
 	void clearVariables();	
 
-	const char *getErrMsg() { return _errmsg.c_str(); };
+	const char *getErrMsg() { return vars().errmsg.c_str(); };
+
+	// Adds script execution figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+	// Optional worker thread that runs Script entities off the game thread
+	void startWorker();
+	void stopWorker();
+	bool isThreaded() { return (_worker_thread != nullptr); };
+	bool isWorkerThread();
+
+	// Hands a script that is due to the worker thread
+	void queueScript(std::shared_ptr<Script> sptr);
+
+	// Every call from the worker that changes the world (moves, messages, damage, door states,
+	// exits, attributes, spawns, showLocation) is buffered here and applied by the game thread
+	// in script order. Reads see the live world at the time of the call
+	void runCommand(std::function<void()> cmd);
+	void bufferCommand(std::function<void()> cmd);
+	unsigned int applyCommands();
+
+	// Held by the game thread for its heartbeat and by the worker for each call a script makes
+	// into the world (see WorldLock), never for a whole script
+	std::mutex &getWorldMutex() { return _world_mutex; };
 
 private:
+	// The variables and error of a script being set up or run. The game thread and the worker
+	// each have their own so a special on one can't clobber a script on the other
+	struct script_vars {
+		std::vector<std::pair<std::string, IPhysical>> variables;
+		std::vector<std::pair<std::string, int>> variable_ints;
+		std::vector<std::pair<std::string, float>> variable_floats;
+		std::vector<std::pair<std::string, std::string>> variable_strs;
+		std::string errmsg;
+	};
+
+	script_vars &vars() { return isWorkerThread() ? _worker_vars : _game_vars; };
+
+	int runScript(std::string &script);
+	void runWorker();
 
 	IMUD _access;
 
-	std::vector<std::pair<std::string, IPhysical>> _variables;
-	std::vector<std::pair<std::string, int>> _variable_ints;
-	std::vector<std::pair<std::string, float>> _variable_floats;
-	std::vector<std::pair<std::string, std::string>> _variable_strs;
+	script_vars _game_vars;
+	script_vars _worker_vars;
 	
 	std::string _script;
 
-	std::string _errmsg;
-
 	std::unique_ptr<boost::python::object> _main_module;
 	std::unique_ptr<boost::python::object> _main_namespace;
+
+	std::unique_ptr<std::thread> _worker_thread;
+	bool _exit_worker = false;
+	PyThreadState *_main_tstate = NULL;
+
+	std::mutex _world_mutex;
+
+	std::mutex _queue_mutex;
+	std::condition_variable _queue_cond;
+	std::queue<std::shared_ptr<Script>> _script_queue;
+
+	std::mutex _cmd_mutex;
+	std::vector<std::function<void()>> _cmd_buffer;
+
+	MetricCounter _exec_metric;
+	MetricCounter _error_metric;
+};
+
+/***************************************************************************************
+ * WorldLock - taken at the start of each call a script makes into the world. On the
+ *				   script worker it holds the world mutex for just that call, waiting out a
+ *				   heartbeat in progress with the GIL released, so a script sees a consistent
+ *				   world during a call and the heartbeat never waits longer than one call. On
+ *				   the game thread it does nothing.
+ *
+ ***************************************************************************************/
+class WorldLock
+{
+public:
+	WorldLock();
+	~WorldLock() {};
+
+private:
+	std::unique_lock<std::mutex> _lock;
 };
 
 #endif
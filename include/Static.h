@@ -33,9 +33,9 @@ public:
    // Gets the primary reference name the game refers to this entity by
 	virtual const char *getGameName(std::string &buf) const;
 
-   const char *getTitle() const { return _title.c_str(); };
-	virtual const char *getExamine() const { return _examine.c_str(); };
-	const char *getStartLoc() const { return _startloc.c_str(); };
+   const char *getTitle() const { return _desc->title.c_str(); };
+	virtual const char *getExamine() const { return _desc->examine.c_str(); };
+	const char *getStartLoc() const { return _desc->startloc.c_str(); };
 
 	virtual bool hasAltName(const char *str, bool allow_abbrev);
 
@@ -45,7 +45,7 @@ public:
 	virtual const char *listContents(std::string &buf, const Physical *exclude = NULL) const;
 
    doorstate getDoorState() { return _state; };
-   void setDoorState(doorstate new_state) { _state = new_state; };
+   void setDoorState(doorstate new_state);
    bool setDoorState(const char *new_state);
 	
 	bool isStaticFlagSet(sflags flag) { return _staticflags[flag]; };
@@ -60,6 +60,15 @@ public:
 
 protected:
 
+	// Changes the Lit flag and keeps the container's lit count current
+	void setLit(bool lit);
+
+	// Tells the location(s) this is in that their cached room description is stale
+	virtual void renderChanged();
+
+	virtual void saveState(RecordWriter &rec) const;
+	virtual void loadState(RecordReader &rec, EntityDB &edb);
+
    virtual void saveData(pugi::xml_node &entnode) const;
    virtual int loadData(pugi::xml_node &entnode);
 
@@ -68,19 +77,21 @@ protected:
 
 private:
 	
-	std::string _examine;
-	std::vector<std::string> _altnames;
-	std::string _startloc;
-
-	std::string _title;
+	// Set when loaded and shared by every entity spawned from this one
+	struct static_desc {
+		std::string examine;
+		std::vector<std::string> altnames;
+		std::string startloc;
+		std::string title;
+
+		// List of key IDs that can unlock this door - no keys listed mean all keys work
+		std::vector<std::string> keys;
+	};
+	std::shared_ptr<static_desc> _desc;
 
 	std::bitset<32> _staticflags;
 
    doorstate _state = Open;
-
-   // List of key IDs that can unlock this door - no keys listed mean all keys work
-   std::vector<std::string> _keys;
-
 };
 
 #endif
@@ -2,8 +2,11 @@
 #define TCPCONN_H
 
 #include <mutex>
+#include <memory>
+#include <deque>
 #include "FileDesc.h"
 #include "LogMgr.h"
+#include "Metrics.h"
 
 const int max_attempts = 2;
 
@@ -23,6 +26,9 @@ public:
 	void setPreWrite(const char *str);
 	void setPostWrite(const char *str);
 
+	// Replaces both the pre- and post-write strings under a single lock
+	void swapPrompt(std::string &prewrite, std::string &postwrite);
+
    bool accept(SocketFD &server);
 
 	ssize_t handleConnection(time_t timeout);
@@ -30,6 +36,9 @@ public:
 	// Adds a string to the output buffer for eventual transmission
 	void addOutput(const char *msg);
 
+	// Queues a buffer shared with other connections (a Broadcast) without copying it
+	void addOutput(std::shared_ptr<std::string> msg);
+
 	// Checks for input or output
 	bool hasInput() { return (_inputbuf.size() > 0); };
 	bool hasOutput() { return (_outputbuf.size() > 0); };
@@ -47,12 +56,17 @@ public:
    unsigned long getIPAddr() { return _connfd.getIPAddr(); };
    void getIPAddrStr(std::string &buf);
 
+	// Traffic totals across all connections
+	static void registerMetrics(MetricsRegistry &metrics);
+
 private:
 
    SocketFD _connfd;
  
    std::string _inputbuf;
-	std::string _outputbuf;
+	// Output is a queue of buffers. Buffers only we reference can be appended to, shared
+	// ones are left untouched
+	std::deque<std::shared_ptr<std::string>> _outputbuf;
 
 	std::string _prewrite;
 	std::string _postwrite;
@@ -61,6 +75,9 @@ private:
 
 	time_t _lostlink_timeout = 0;
 
+	static MetricCounter _total_in_metric;
+	static MetricCounter _total_out_metric;
+
 	std::mutex _conn_mutex;
 
 };
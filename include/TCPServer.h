@@ -4,6 +4,8 @@
 #include <memory>
 #include "FileDesc.h"
 #include "TCPConn.h"
+#include "ALMgr.h"
+#include "IPThrottle.h"
 
 /********************************************************************************************
  * TCPServer - Basic functionality to manage a server socket and a list of connections. 
@@ -17,6 +19,7 @@ class TCPServer
 {
 public:
    TCPServer();
+   TCPServer(const TCPServer &copy_from);
    virtual ~TCPServer();
 
    virtual void bindSvr(const char *ip_addr, unsigned short port);
@@ -26,6 +29,12 @@ public:
 
    TCPConn *handleSocket();
 
+   // Admit only connections the access list allows (reloaded when the file changes)
+   void setAccessList(const char *al_file, bool is_whitelist);
+
+   // Limit how fast any one IP address can connect (connections per second, 0 for no limit)
+   void setConnectLimit(float rate, float burst);
+
    unsigned long getIPAddr() { return _sockfd.getIPAddr(); };
    unsigned short getPort() { return _sockfd.getPort(); };
 
@@ -37,9 +46,9 @@ private:
    SocketFD _sockfd;
 
 	// Access control
-	bool _use_accesslist = false;
-	bool _whitelist = false;
-	std::string _whitelist_file;
+	std::unique_ptr<ALMgr> _accesslist;
+
+	IPThrottle _connect_throttle;
 };
 
 
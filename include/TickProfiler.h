@@ -0,0 +1,71 @@
+#ifndef TICKPROFILER_H
+#define TICKPROFILER_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include "Histogram.h"
+
+/***************************************************************************************
+ * TickProfiler - collects timings for the game loop: each phase of the heartbeat, each
+ *					   action ID and each Script, along with how often the heartbeat ran over its
+ *					   time. Figures cover a rolling window that is reported and reset periodically.
+ *					   Recording is mutexed as Scripts may be timed on the script worker thread.
+ *
+ ***************************************************************************************/
+class TickProfiler
+{
+public:
+	TickProfiler();
+	TickProfiler(const TickProfiler &copy_from);
+
+	~TickProfiler();
+
+	enum tick_phases { ApplyCommands, AuthResults, Users, Behaviors, Actions, Checkpoint, Tick, NumPhases };
+
+	// Seconds between reports to the log, 0 to only report on request
+	void setReportInterval(unsigned int secs) { _report_secs = secs; };
+
+	void recordPhase(tick_phases phase, uint64_t usecs);
+	void recordAction(const std::string &id, uint64_t usecs);
+	void recordScript(const std::string &id, uint64_t usecs);
+
+	// Records the whole heartbeat, counting it as an overrun if it took longer than allowed
+	void recordTick(uint64_t usecs, uint64_t allowed_usecs);
+
+	// Writes the report to the log and starts a new window if the interval has passed
+	void checkReport();
+
+	// Formats the figures for the current window
+	const char *getReport(std::string &buf, unsigned int max_entries = 10);
+
+	unsigned long getTotalOverruns() const { return _total_overruns; };
+
+	// Microseconds between two points in time, for callers timing their own sections
+	template <typename T>
+	static uint64_t elapsedUsecs(T start, T end) {
+		return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	}
+
+private:
+
+	void resetWindow();
+	static void formatEntries(std::string &buf, const char *heading,
+										const std::map<std::string, Histogram> &entries, unsigned int max_entries);
+
+	std::mutex _prof_mutex;
+
+	Histogram _phases[NumPhases];
+	std::map<std::string, Histogram> _actions;
+	std::map<std::string, Histogram> _scripts;
+
+	unsigned long _window_overruns = 0;
+	uint64_t _worst_overrun = 0;
+	unsigned long _total_overruns = 0;
+
+	unsigned int _report_secs = 0;
+	std::chrono::steady_clock::time_point _window_start;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <chrono>
+
+/***************************************************************************************
+ * TokenBucket - a simple rate limiter. Tokens refill at a steady rate up to a burst size
+ *					  and are spent by whatever is being limited. The balance can go negative so a
+ *					  costly action has to be paid off before the next one is allowed.
+ *
+ ***************************************************************************************/
+class TokenBucket
+{
+public:
+	TokenBucket(float rate = 0.0, float burst = 0.0);
+	TokenBucket(const TokenBucket &copy_from);
+
+	~TokenBucket();
+
+	// Sets the refill rate (tokens per second, 0 for no limit) and fills the bucket
+	void configure(float rate, float burst);
+
+	// Refills the bucket for the time passed and returns true if there are tokens to spend
+	bool available();
+
+	void spend(float cost) { _tokens -= cost; };
+	float getTokens() const { return _tokens; };
+
+private:
+
+	float _rate;
+	float _burst;
+	float _tokens;
+
+	std::chrono::steady_clock::time_point _last_refill;
+};
+
+#endif
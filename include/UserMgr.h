@@ -2,13 +2,21 @@
 #define USERMGR_H
 
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <memory>
 #include <thread>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <bitset>
 #include <libconfig.h++>
 #include "TCPServer.h"
 #include "Player.h"
 #include "ActionMgr.h"
 #include "EntityDB.h"
+#include "Metrics.h"
+#include "SaveMgr.h"
 
 /****************************************************************************************
  * UserMgr - class that stores and manages the connected players and provides methods for
@@ -26,6 +34,9 @@ public:
 	// Initialize certain variables for this class from the config file
 	void initialize(libconfig::Config &cfg_info);
 
+	// Adds player and network figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
 	// Starts the incoming connection socket
 	void startSocket(const char *ip_addr, unsigned short port);
 
@@ -48,27 +59,75 @@ public:
 	// Displays the list of logged on users, populating the buffer
 	const char *showUsers(std::string &buf);
 
-	// Loop through all users, performing maintenance and executing their next
-	// command via their handler
-	void handleUsers(libconfig::Config &cfg_info, EntityDB &edb);
+	// Loop through the users with pending work, performing maintenance and executing their
+	// next command via their handler. Stops at the deadline, leaving the rest for next time
+	void handleUsers(libconfig::Config &cfg_info, EntityDB &edb,
+								std::chrono::system_clock::time_point deadline);
+
+	// Queues a player to be visited on the next handleUsers pass. Thread-safe
+	void markActive(std::shared_ptr<Player> plr);
+
+	// Spends a password attempt for this IP address, false if it has tried too many too fast
+	bool allowAuthAttempt(unsigned long ipaddr) { return _auth_throttle.allow(ipaddr); };
 
-	// Functions for loading and saving user info to disk 
+	// Functions for loading and saving user info in the player store. Saves are snapshotted
+	// now and written by the save writer
 	int loadUser(const char *username, Player &plr);
 	
 	bool saveUser(const char *username);
 	bool saveUser(const Player &plr);
+	bool saveUserNow(const Player &plr);
+
+	PlayerStore *getPlayerStore() { return _store.get(); };
+
+	// Saves every player in the game, then waits for the save writer to finish and stops it
+	void stopSaves();
 
+	// Finds a logged in player by name, with or without the "player:" prefix and in any case.
+	// Abbreviations match the first name alphabetically that starts with them
 	std::shared_ptr<Player> getPlayer(const char *name, bool allow_abbrev = true);
 
+	// Adds the zone of each logged in player's location to zones
+	void listOccupiedZones(std::set<std::string> &zones);
+
 	int sendMsg(const char *msg, std::vector<std::string> *exclude_flags,
 										  std::vector<std::string> *require_flags, 
 										  std::shared_ptr<Physical> exclude_ind);
 
 private:
 
+	// Saves the next few players in line for an autosave, spreading them across the heartbeats
+	void autosave();
+
+	// Keep the logged in player indexes up to date
+	void addOnline(std::shared_ptr<Player> plr);
+	void removeOnline(Player &plr);
+	static void foldName(const char *name, std::string &key);
+
+	// Pre-resolves flag names for sendMsg so players can be checked by bitmask
+	static void resolveFlags(std::vector<std::string> *flags, std::bitset<32> &mask, 
+																		std::vector<std::string> &others);
+	static bool checkFlags(Player &plr, std::vector<std::string> &exclude_other, 
+																		std::vector<std::string> &require_other);
+
 	// List of active users
 	std::map<std::string, std::shared_ptr<Player>> _db;
 
+	// Logged in players by lowercase name (no "player:" prefix), and the same names in order
+	// for abbreviations and the who list, which is kept built until someone logs in or out
+	std::unordered_map<std::string, std::shared_ptr<Player>> _online;
+	std::set<std::string> _online_names;
+	std::string _who_list;
+
+	// Connections serviced by the listening thread. Only that thread touches this list
+	std::vector<std::shared_ptr<Player>> _net_players;
+
+	// Players with pending work and newly connected players, handed from the listening
+	// thread to the game thread
+	std::mutex _ready_mutex;
+	std::vector<std::shared_ptr<Player>> _ready;
+	std::vector<std::shared_ptr<Player>> _incoming;
+
 	// Listening socket to accept new connections
 	TCPServer _listen_sock;
 
@@ -77,9 +136,34 @@ private:
 
 	time_t _conn_timeout = 30;
 
+	// Player command rate limit (commands per second and burst), 0 rate for no limit
+	float _cmd_rate = 0.0;
+	float _cmd_burst = 1.0;
+
+	// Password attempts (each an expensive hash) allowed per IP address
+	IPThrottle _auth_throttle;
+
+	// Where accounts are kept, and the writer that saves to it in the background. The store
+	// must outlive the writer
+	std::unique_ptr<PlayerStore> _store;
+	SaveMgr _saves;
+
+	// Every player in the game is saved once per autosave_secs (0 for never). Each heartbeat
+	// earns a share of a pass through the players; _autosave_next is who is next in line
+	unsigned int _autosave_secs = 0;
+	unsigned int _heartbeat_per_sec = 10;
+	float _autosave_credit = 0.0;
+	std::string _autosave_next;
+
 	std::unique_ptr<std::thread> _listening_thread;
 	bool _exit_listening_thread = false;
 
+	// Live figures for the metrics endpoint, which is served from the listening thread
+	MetricGauge _players_metric;
+	MetricCounter _connects_metric;
+	MetricCounter _commands_metric;
+	std::unique_ptr<MetricsServer> _metrics_svr;
+
 	std::string _infodir;
 	std::string _userdir;
 };
@@ -0,0 +1,74 @@
+#ifndef WORLDCHECKPOINT_H
+#define WORLDCHECKPOINT_H
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <libconfig.h++>
+#include "LogStore.h"
+#include "SaveMgr.h"
+#include "Metrics.h"
+
+class EntityDB;
+
+/***************************************************************************************
+ * WorldCheckpoint - keeps the state of the zones across restarts: where items and NPCs
+ *						  are, door and container states, what's lit. Only entities that differ
+ *						  from how the zone files set them up are saved. On boot, each entity's
+ *						  starting state is recorded and the saved changes are replayed on top.
+ *
+ *						  Entities queue themselves in the EntityDB when their state changes. At
+ *						  each checkpoint the game thread encodes just those (a copy the tick can
+ *						  keep changing afterwards) and hands them to a SaveMgr writer thread,
+ *						  which appends them to a LogStore, so a checkpoint costs the heartbeat
+ *						  only what changed and never waits on the disk.
+ *
+ ***************************************************************************************/
+class WorldCheckpoint
+{
+public:
+	WorldCheckpoint();
+	WorldCheckpoint(const WorldCheckpoint &copy_from);
+
+	~WorldCheckpoint();
+
+	// Opens the checkpoint store and replays it onto the zones. Call once they are loaded
+	void initialize(libconfig::Config &cfg_info, EntityDB &edb);
+
+	// Called each heartbeat. Every checkpoint_secs, queues what has changed to be written
+	void checkpoint(EntityDB &edb);
+
+	// Queues the last changes, writes everything and closes the store
+	void stop(EntityDB &edb);
+
+	bool isEnabled() const { return (_store != nullptr); };
+
+	// Adds the checkpoint figures to the registry
+	void registerMetrics(MetricsRegistry &metrics);
+
+private:
+	void setBaseline(EntityDB &edb);
+	void replay(EntityDB &edb);
+	void saveChanges(EntityDB &edb);
+
+	std::unique_ptr<LogStore> _store;
+
+	// Declared after the store so it is stopped before the store closes
+	SaveMgr _writer;
+
+	// Each entity's state as the zone files set it up
+	std::unordered_map<std::string, std::string> _baseline;
+
+	// The state saved for each entity that differs from its baseline
+	std::unordered_map<std::string, std::string> _saved;
+
+	unsigned int _checkpoint_secs = 60;
+	std::chrono::steady_clock::time_point _next_checkpoint;
+
+	MetricGauge _changed_metric;
+	MetricCounter _written_metric;
+	MetricSummary _snapshot_metric;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ZONERESET_H
+#define ZONERESET_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include "Action.h"
+#include "Physical.h"
+
+class EntityDB;
+
+/***************************************************************************************
+ * ZoneReset - a job in the action queue that puts a zone back together every so often.
+ *				   Entities from the zone file that have left the world (NPCs that were killed,
+ *				   items that were consumed or destroyed) go back to their startloc with their
+ *				   attributes as the zone file set them, and each spawn rule tops its location
+ *				   back up with copies of a prototype. Set up by a
+ *				   <zone> node in the zone file:
+ *
+ *						<zone name="demo" reset="600">
+ *							<spawn prototype="demo:shell" location="demo:duskbeach" count="2" />
+ *						</zone>
+ *
+ *				   A reset handles at most its budget of entities per heartbeat and picks up
+ *				   where it left off on the next, so a big zone never holds up the heartbeat.
+ *
+ ***************************************************************************************/
+class ZoneReset : public Action
+{
+public:
+	ZoneReset(const char *zonename);
+	ZoneReset(const ZoneReset &copy_from);
+
+	virtual ~ZoneReset();
+
+	// Reads the reset interval and spawn rules from the zone's <zone> node
+	bool loadZone(pugi::xml_node &zonenode);
+
+	// An entity from the zone file to put back at its startloc when it leaves the world. Call
+	// as it's loaded, so its attributes are kept as the zone file sets them
+	void addMember(std::shared_ptr<Physical> member) { _members.push_back(zone_member{member,
+																							member->getAttributes()}); };
+
+	// Drops spawn rules whose prototype or location doesn't exist. Call once all zones are loaded
+	void checkRules(EntityDB &edb);
+
+	// Most entities restored or spawned in one heartbeat
+	void setBudget(unsigned int budget) { _budget = (budget > 0) ? budget : 1; };
+
+	float getInterval() const { return _interval; };
+
+	// Queues the first pass to run right away. It only fills the spawn rules: the zone files
+	// (and world checkpoint) already decided where everything else is
+	void start();
+
+	// Does up to a heartbeat's budget of the reset, then reschedules itself
+	virtual int execute();
+
+private:
+	struct zone_member {
+		std::shared_ptr<Physical> entity;
+		Physical::attr_map attributes;
+	};
+
+	struct spawn_rule {
+		std::string proto_id;
+		std::string loc_id;
+		unsigned int count;
+
+		// What this rule has spawned that is still its own: at the location, or out of the world
+		// and waiting to be reused. One taken elsewhere (picked up, wandered off) is let go
+		std::vector<std::shared_ptr<Physical>> instances;
+	};
+
+	bool restoreMember(EntityDB &edb, zone_member &member);
+	bool applyRule(EntityDB &edb, spawn_rule &rule, unsigned int &budget_left);
+
+	std::string _zonename;
+	float _interval = 0.0;
+	unsigned int _budget = 50;
+
+	std::vector<zone_member> _members;
+	std::vector<spawn_rule> _rules;
+
+	// Where the reset in progress is up to--members first, then rules
+	bool _in_progress = false;
+	size_t _next_member = 0;
+	size_t _next_rule = 0;
+	unsigned int _placed = 0;
+};
+
+#endif
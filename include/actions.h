@@ -20,6 +20,7 @@ int quitcom(MUD &engine, Action &act_used);
 int opencom(MUD &engine, Action &act_used);
 int closecom(MUD &engine, Action &act_used);
 int statscom(MUD &engine, Action &act_used);
+int tickstatscom(MUD &engine, Action &act_used);
 int equipcom(MUD &engine, Action &act_used);
 int removecom(MUD &engine, Action &act_used);
 int tiecom(MUD &engine, Action &act_used);
@@ -31,7 +31,7 @@ void sendInfoFiles(std::shared_ptr<Player> plr, libconfig::Config &cfg, const ch
 unsigned int locateInTable(const char *name, const char **table);
 
 // If buf is equal to compare_str, only taking into account buf.size() chars (abbreviations)
-bool equalAbbrev(std::string &buf, const char *compare_str);
+bool equalAbbrev(const std::string &buf, const char *compare_str);
 
 bool isPreposition(const char *str);
 
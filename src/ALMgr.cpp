@@ -1,10 +1,15 @@
 #include <arpa/inet.h>
+#include <sys/stat.h>
 #include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
 #include "ALMgr.h"
 #include "misc.h"
+#include "global.h"
 
-ALMgr::ALMgr(const char *al_file, bool is_whitelist):_al_file(al_file),_is_whitelist(is_whitelist) {
-
+ALMgr::ALMgr(const char *al_file, bool is_whitelist):_al_file(al_file),_is_whitelist(is_whitelist),_nodes() {
+   _nodes.push_back(al_node{{0, 0}, false});
 }
 
 
@@ -13,48 +18,165 @@ ALMgr::~ALMgr() {
 }
 
 /******************************************************************************************************
- * isAllowed - checks to see if the IP address is in the list and allows/denies based off _is_whitelist
- *  
- *    Second version takes in an unsigned long IP Addr in network (big endian) format
+ * loadList - reads the access list file into a new tree, replacing the old one. Lines are an IPv4
+ *            address or a CIDR block (a.b.c.d/nn). Blank lines and text after a # are ignored, bad
+ *            lines are logged and skipped.
+ *
+ *    Returns: number of entries loaded
  ******************************************************************************************************/
-bool ALMgr::isAllowed(const char *ipaddr) {
-   in_addr testaddr;
 
-   inet_pton(AF_INET, ipaddr, &testaddr);
-   return isAllowed(testaddr.s_addr);
-}
+unsigned int ALMgr::loadList() {
+   _nodes.clear();
+   _nodes.push_back(al_node{{0, 0}, false});
 
-bool ALMgr::isAllowed(unsigned long ipaddr) {
-   FILE *alfile;
+   struct stat fileinfo;
+   if (stat(_al_file.c_str(), &fileinfo) != 0) {
+      std::string msg("Access list file '");
+      msg += _al_file;
+      msg += "' not found, treating the list as empty.";
+      mudlog->writeLog(msg);
+      _file_mtime = 0;
+      return 0;
+   }
+   _file_mtime = fileinfo.st_mtime;
 
-   // First, find the IP address in the file
-   if ((alfile = fopen(_al_file.c_str(), "r")) == NULL) {
-      throw std::runtime_error("Unable to open white list file.");
+   std::ifstream alfile(_al_file.c_str());
+   if (!alfile.is_open()) {
+      std::string msg("Unable to open access list file '");
+      msg += _al_file;
+      msg += "', treating the list as empty.";
+      mudlog->writeLog(msg);
+      return 0;
    }
 
-   in_addr al_ip;
-   char strbuf[30];
-   strbuf[0] = '\0';
-   std::string ipstr;
+   std::string line;
+   unsigned int linenum = 0, count = 0;
+   while (std::getline(alfile, line)) {
+      linenum++;
+      clrNewlines(line);
+
+      size_t pos = line.find('#');
+      if (pos != std::string::npos)
+         line.erase(pos);
 
-   while (fgets(strbuf, 30, alfile) != NULL) {
-      ipstr = strbuf;
-      clrNewlines(ipstr);
-      inet_pton(AF_INET, ipstr.c_str(), &al_ip);
+      size_t start = line.find_first_not_of(" \t");
+      if (start == std::string::npos)
+         continue;
+      line = line.substr(start, line.find_last_not_of(" \t") - start + 1);
 
-      if (al_ip.s_addr == ipaddr) {
-         fclose(alfile);
-         if (_is_whitelist)
-            return true;
+      // Split off the prefix length, a plain address is a /32
+      unsigned int prefix_len = 32;
+      std::string ipstr = line;
+      if ((pos = line.find('/')) != std::string::npos) {
+         ipstr = line.substr(0, pos);
+         char *endptr;
+         unsigned long len = strtoul(line.c_str() + pos + 1, &endptr, 10);
+         if ((*endptr != '\0') || (endptr == line.c_str() + pos + 1) || (len > 32))
+            prefix_len = 33;
          else
-            return false;
+            prefix_len = (unsigned int) len;
       }
+
+      in_addr al_ip;
+      if ((prefix_len > 32) || (inet_pton(AF_INET, ipstr.c_str(), &al_ip) != 1)) {
+         std::stringstream msg;
+         msg << "Access list '" << _al_file << "' line " << linenum << ": '" << line <<
+                                                      "' is not an IP address or CIDR block, skipping.";
+         mudlog->writeLog(msg.str().c_str());
+         continue;
+      }
+
+      addBlock(ntohl(al_ip.s_addr), prefix_len);
+      count++;
    }
 
-   fclose(alfile);
+   std::stringstream msg;
+   msg << "Loaded " << count << " entries from access list '" << _al_file << "'.";
+   mudlog->writeLog(msg.str().c_str(), 2);
+   return count;
+}
+
+/******************************************************************************************************
+ * addBlock - adds the first prefix_len bits of addr (host byte order) to the tree
+ ******************************************************************************************************/
+
+void ALMgr::addBlock(uint32_t addr, unsigned int prefix_len) {
+   uint32_t cur = 0;
+
+   for (unsigned int i=0; i<prefix_len; i++) {
+      // Already covered by a wider block
+      if (_nodes[cur].listed)
+         return;
 
-   if (_is_whitelist)
+      unsigned int bit = (addr >> (31 - i)) & 1;
+      if (_nodes[cur].child[bit] == 0) {
+         _nodes[cur].child[bit] = (uint32_t) _nodes.size();
+         _nodes.push_back(al_node{{0, 0}, false});
+      }
+      cur = _nodes[cur].child[bit];
+   }
+   _nodes[cur].listed = true;
+}
+
+/******************************************************************************************************
+ * checkReload - reloads the list if the file's modification time changed since it was loaded
+ *
+ *    Params:  check_secs - how long to go between looking at the file
+ *
+ *    Returns: true if the list was reloaded
+ ******************************************************************************************************/
+
+bool ALMgr::checkReload(time_t check_secs) {
+   time_t now = time(NULL);
+   if (now - _last_check < check_secs)
+      return false;
+   _last_check = now;
+
+   struct stat fileinfo;
+   time_t mtime = (stat(_al_file.c_str(), &fileinfo) == 0) ? fileinfo.st_mtime : 0;
+   if (mtime == _file_mtime)
       return false;
+
+   loadList();
    return true;
 }
 
+/******************************************************************************************************
+ * isListed - walks the tree for the address
+ *
+ *    Params:  ipaddr - IP address in network (big endian) format
+ ******************************************************************************************************/
+
+bool ALMgr::isListed(unsigned long ipaddr) const {
+   uint32_t addr = ntohl((uint32_t) ipaddr);
+   uint32_t cur = 0;
+
+   for (unsigned int i=0; i<32; i++) {
+      if (_nodes[cur].listed)
+         return true;
+
+      cur = _nodes[cur].child[(addr >> (31 - i)) & 1];
+      if (cur == 0)
+         return false;
+   }
+   return _nodes[cur].listed;
+}
+
+/******************************************************************************************************
+ * isAllowed - checks to see if the IP address is in the list and allows/denies based off _is_whitelist
+ *
+ *    Second version takes in an unsigned long IP Addr in network (big endian) format
+ ******************************************************************************************************/
+bool ALMgr::isAllowed(const char *ipaddr) {
+   in_addr testaddr;
+
+   if (inet_pton(AF_INET, ipaddr, &testaddr) != 1)
+      return !_is_whitelist;
+   return isAllowed(testaddr.s_addr);
+}
+
+bool ALMgr::isAllowed(unsigned long ipaddr) {
+   if (isListed(ipaddr))
+      return _is_whitelist;
+   return !_is_whitelist;
+}
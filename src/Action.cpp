@@ -2,6 +2,7 @@
 #include <sstream>
 #include "Action.h"
 #include "Script.h"
+#include "Location.h"
 #include "MUD.h"
 #include "actions.h"
 #include "misc.h"
@@ -30,6 +31,7 @@ hardcoded_actions cmd_array[] = {
       {"opencom", opencom},
       {"closecom", closecom},
       {"statscom", statscom},
+      {"tickstatscom", tickstatscom},
 		{"equipcom", equipcom},
 		{"removecom", removecom},
 		{"tiecom", tiecom},
@@ -79,6 +81,7 @@ Action::Action(const Action &copy_from):
 								_alias(copy_from._alias),
 								_pretrig(copy_from._pretrig),
 								_posttrig(copy_from._posttrig),
+								_cost(copy_from._cost),
 								_target1(copy_from._target1),
 								_target2(copy_from._target2)
 {
@@ -237,6 +240,19 @@ int Action::loadData(pugi::xml_node &entnode) {
    if (attr != nullptr)
       _posttrig = attr.value();
 
+	// Optional weight against the player's command rate, defaults to 1
+	attr = entnode.attribute("cost");
+	if (attr != nullptr) {
+		attstr = attr.value();
+		try {
+			_cost = std::stof(attstr);
+		} catch (const std::logic_error &e) {
+			errmsg << "Action '" << getID() << "' cost field has invalid value: " << attstr;
+			mudlog->writeLog(errmsg.str().c_str());
+			return 0;
+		}
+	}
+
 	return 1;
 }
 
@@ -428,7 +444,14 @@ std::shared_ptr<Physical> Action::findTarget(const std::string &name, std::strin
 
 	// Now check location if applicable
 	if ((target == nullptr) && (isActFlagSet((act_flags) (Target1Loc + offset)))) {
-		target = cur_loc->getContainedByName(name.c_str());
+
+		// Organism targets can be found in the location's occupant list without scanning objects
+		std::shared_ptr<Location> locptr = std::dynamic_pointer_cast<Location>(cur_loc);
+		if ((locptr != nullptr) && (isActFlagSet((act_flags) (Target1Org + offset))))
+			target = locptr->getOrganismByName(name.c_str());
+
+		if (target == nullptr)
+			target = cur_loc->getContainedByName(name.c_str());
 	}
 
 	// Raise an error if we didn't find anything and we're not checking the entire MUD
@@ -157,6 +157,7 @@ unsigned int ActionMgr::loadActions(const char *actiondir) {
 			msg += ", Error: ";
 			msg += result.description();
          mudlog->writeLog(msg.c_str());
+			engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg);
          continue;
       }
 
@@ -168,6 +169,7 @@ unsigned int ActionMgr::loadActions(const char *actiondir) {
 				std::string msg("Corrupted action file for: ");
 				msg += new_act->getID();
 				mudlog->writeLog(msg);
+				engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg);
 				delete new_act;
 				continue;
 			}
@@ -185,6 +187,7 @@ unsigned int ActionMgr::loadActions(const char *actiondir) {
             std::string msg("Corrupted talent file for: ");
             msg += new_tal->getID();
             mudlog->writeLog(msg);
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg);
             delete new_tal;
             continue;
          }
@@ -203,6 +206,7 @@ unsigned int ActionMgr::loadActions(const char *actiondir) {
             std::string msg("Corrupted social file for: ");
             msg += new_soc->getID();
             mudlog->writeLog(msg);
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg);
             delete new_soc;
             continue;
          }
@@ -243,21 +247,49 @@ unsigned int ActionMgr::loadActions(const char *actiondir) {
  *				This function basically handles the dyanmics of the game. All entities that are
  *				"doing something" are doing it in this function using an action in the queue
  *
- *    Params:  cfg_info - The libconfig::Config object that stores all the necessary config info
- *                        to set up the user manager
+ *    Params:  deadline - when this heartbeat's time for actions runs out. Actions still due
+ *                        at that point stay at the front of the queue for the next heartbeat.
  *
  *********************************************************************************************/
 
-void ActionMgr::handleActions() {
+void ActionMgr::handleActions(std::chrono::system_clock::time_point deadline) {
 
 	auto cur_time = std::chrono::system_clock::now();
+	ScriptEngine &se = *engine.getScriptEngine();
+	std::shared_ptr<Script> sptr;
 
 	// Loop through all actions in the queue, executing them
 	auto aptr = _action_queue.begin();
 	while ((aptr != _action_queue.end()) && ((*aptr)->getExecTime() <= cur_time)) {
 
+		// Out of time--the rest are still due and go first next heartbeat
+		if (std::chrono::system_clock::now() >= deadline)
+			break;
 
+		// With the script worker running, scripts leave the queue here and come back through
+		// finishScript once the worker is done with them
+		if (se.isThreaded() && ((sptr = std::dynamic_pointer_cast<Script>(*aptr)) != nullptr)) {
+			se.queueScript(sptr);
+			aptr = _action_queue.erase(aptr);
+			continue;
+		}
+
+		auto exec_start = std::chrono::steady_clock::now();
 		int results = aptr->get()->execute();
+		uint64_t exec_usecs = TickProfiler::elapsedUsecs(exec_start, std::chrono::steady_clock::now());
+		_executed_metric.add();
+
+		// Scripts and actions are profiled separately, by ID
+		if (std::dynamic_pointer_cast<Script>(*aptr) != nullptr)
+			engine.getProfiler()->recordScript(aptr->get()->getID(), exec_usecs);
+		else {
+			engine.getProfiler()->recordAction(aptr->get()->getID(), exec_usecs);
+
+			std::shared_ptr<Organism> actor = aptr->get()->getActor();
+			if (actor != nullptr)
+				engine.getEventLog()->writeEvent(EventLog::Command, actor->getID(), aptr->get()->getID(), 
+																										exec_usecs);
+		}
 
 		// Check for post-action triggers if the command was successful
 		std::string posttrig = aptr->get()->getPostTrig();
@@ -279,6 +311,19 @@ void ActionMgr::handleActions() {
 		}
 	}
 
+	_queue_metric.set((int64_t) _action_queue.size());
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the action queue figures to the registry
+ *
+ *********************************************************************************************/
+
+void ActionMgr::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_action_queue_depth", "Actions and scripts waiting in the action queue",
+																										_queue_metric);
+	metrics.addCounter("aime_actions_executed_total", "Actions and scripts executed by the game loop",
+																										_executed_metric);
 }
 
 /*********************************************************************************************
@@ -537,4 +582,24 @@ bool ActionMgr::addScript(std::shared_ptr<Script> new_script) {
 	return true;
 }
 
+/*********************************************************************************************
+ * finishScript - called on the game thread once the script worker has run a script. Handles
+ *				      post-triggers and puts repeating scripts back into the queue.
+ *
+ *    Params:  sptr - the script that was executed
+ *             results - the return value of Script::execute
+ *
+ *********************************************************************************************/
+
+void ActionMgr::finishScript(std::shared_ptr<Script> sptr, int results) {
+	std::string posttrig = sptr->getPostTrig();
+	if ((results > 0) && (posttrig.size() > 0)) {
+		handleSpecials(sptr.get(), posttrig.c_str());
+	}
+
+	// Script::execute already set the next execute time
+	if (results == 2)
+		_action_queue.insert(sptr);
+}
+
 
@@ -17,6 +17,21 @@ Attribute *genAttrFromStr(const char *str) {
 		return new StrAttribute(str);
 }
 
+// makes a new attribute of the same type and value, for an entity that shares its attributes
+// with the prototype it was spawned from to get its own copy before changing one
+Attribute *copyAttribute(Attribute &attr) {
+	switch (attr.getType()) {
+		case Attribute::Int:
+			return new IntAttribute(attr.getInt());
+		case Attribute::Float:
+			return new FloatAttribute(attr.getFloat());
+		case Attribute::String:
+			return new StrAttribute(attr.getStr());
+		default:
+			throw std::invalid_argument("copyAttribute - attribute type not recognized");
+	}
+}
+
 Attribute::Attribute() {
 
 }
@@ -0,0 +1,214 @@
+#include <sstream>
+#include <algorithm>
+#include "AuthPool.h"
+#include "Player.h"
+#include "TickProfiler.h"
+#include "global.h"
+
+AuthPool::AuthPool():
+						_workers(),
+						_job_queue(),
+						_done_jobs()
+{
+
+}
+
+// Threads and queued jobs are not copied
+AuthPool::AuthPool(const AuthPool &copy_from):
+						_workers(),
+						_job_queue(),
+						_done_jobs()
+{
+	(void) copy_from;
+}
+
+AuthPool::~AuthPool() {
+	stop();
+}
+
+/*********************************************************************************************
+ * start - launches the worker threads. Each running hash holds Player::passwd_mem_kb, so the
+ *			  count is limited to what fits in memory_mb (always at least one)
+ *
+ *		Params:	num_threads - workers wanted
+ *					memory_mb - memory the workers may use for hashing between them
+ *
+ *		Throws: runtime_error - workers are already running
+ *
+ *********************************************************************************************/
+
+void AuthPool::start(unsigned int num_threads, unsigned int memory_mb) {
+	if (_workers.size() > 0) {
+		throw std::runtime_error("AuthPool::start - attempted to start the auth workers. They are already running");
+	}
+
+	unsigned int fits = (unsigned int) (((uint64_t) memory_mb * 1024) / Player::passwd_mem_kb);
+	unsigned int use_threads = std::max(std::min(num_threads, fits), 1U);
+
+	if (use_threads < num_threads) {
+		std::stringstream msg;
+		msg << "Only " << use_threads << " of " << num_threads << " auth workers fit in auth_memory_mb (" <<
+																							memory_mb << " MB).";
+		mudlog->writeLog(msg.str().c_str(), 2);
+	}
+
+	_exit_workers = false;
+	for (unsigned int i=0; i<use_threads; i++)
+		_workers.emplace_back([this](){ runWorker(); });
+}
+
+/*********************************************************************************************
+ * stop - signals the workers to exit after their current hash and waits for them. Jobs left
+ *			 in the queue are dropped--their players are disconnecting anyway
+ *
+ *********************************************************************************************/
+
+void AuthPool::stop() {
+	if (_workers.size() == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		_exit_workers = true;
+		_in_flight -= (unsigned int) _job_queue.size();
+		_job_queue.clear();
+	}
+	_queue_cond.notify_all();
+
+	for (unsigned int i=0; i<_workers.size(); i++)
+		_workers[i].join();
+	_workers.clear();
+	_queue_metric.set(0);
+}
+
+/*********************************************************************************************
+ * checkPassword/createPassword - queue a hash for the workers
+ *
+ *		Params:	cleartext - the password the user entered
+ *					passwd_hash - the salt+hash from the user file to compare against
+ *					callback - run on the game thread with the results
+ *
+ *		Returns: true if queued, false if too many hashes are already in flight
+ *
+ *********************************************************************************************/
+
+bool AuthPool::checkPassword(const std::string &cleartext, const std::vector<unsigned char> &passwd_hash,
+																							auth_callback callback) {
+	return queueJob(std::unique_ptr<auth_job>(new auth_job{Check, cleartext, passwd_hash, callback, false}));
+}
+
+bool AuthPool::createPassword(const std::string &cleartext, auth_callback callback) {
+	return queueJob(std::unique_ptr<auth_job>(new auth_job{Create, cleartext, std::vector<unsigned char>(),
+																							callback, false}));
+}
+
+bool AuthPool::queueJob(std::unique_ptr<auth_job> job) {
+	// No workers (not started or shutting down), so do it the old, blocking way
+	if (_workers.size() == 0) {
+		runJob(*job);
+		job->callback(job->success, job->passwd_hash);
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+
+		// Each hash holds a lot of memory and CPU, so a flood of logins waits its turn at the
+		// door instead of in here
+		if ((_max_pending > 0) && (_in_flight >= _max_pending)) {
+			_refused_metric.add();
+			return false;
+		}
+
+		_in_flight++;
+		_job_queue.push_back(std::move(job));
+		_queue_metric.set((int64_t) _job_queue.size());
+	}
+	_queue_cond.notify_one();
+	return true;
+}
+
+/*********************************************************************************************
+ * runJob - does the hashing for a job and wipes the cleartext password once done
+ *
+ *********************************************************************************************/
+
+void AuthPool::runJob(auth_job &job) {
+	if (job.type == Check)
+		job.success = Player::matchPasswdHash(job.cleartext.c_str(), job.passwd_hash);
+	else {
+		Player::makePasswdHash(job.cleartext.c_str(), job.passwd_hash);
+		job.success = true;
+	}
+
+	std::fill(job.cleartext.begin(), job.cleartext.end(), '\0');
+	job.cleartext.clear();
+}
+
+/*********************************************************************************************
+ * runWorker - a worker's loop. Takes the oldest job, hashes it and puts it on the done list
+ *				   for the game thread
+ *
+ *********************************************************************************************/
+
+void AuthPool::runWorker() {
+	while (true) {
+		std::unique_ptr<auth_job> job;
+		{
+			std::unique_lock<std::mutex> lock(_queue_mutex);
+			_queue_cond.wait(lock, [this](){ return (_exit_workers || !_job_queue.empty()); });
+			if (_exit_workers)
+				return;
+
+			job = std::move(_job_queue.front());
+			_job_queue.pop_front();
+			_queue_metric.set((int64_t) _job_queue.size());
+		}
+
+		auto hash_start = std::chrono::steady_clock::now();
+		runJob(*job);
+		_hash_metric.record(TickProfiler::elapsedUsecs(hash_start, std::chrono::steady_clock::now()));
+
+		{
+			std::lock_guard<std::mutex> lock(_done_mutex);
+			_done_jobs.push_back(std::move(job));
+		}
+
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		_in_flight--;
+	}
+}
+
+/*********************************************************************************************
+ * handleCompletions - runs the callbacks of the jobs the workers have finished, in the order
+ *						     they finished. Called by the game thread.
+ *
+ *		Returns: number of jobs completed
+ *
+ *********************************************************************************************/
+
+unsigned int AuthPool::handleCompletions() {
+	std::vector<std::unique_ptr<auth_job>> done;
+	{
+		std::lock_guard<std::mutex> lock(_done_mutex);
+		done.swap(_done_jobs);
+	}
+
+	for (unsigned int i=0; i<done.size(); i++)
+		done[i]->callback(done[i]->success, done[i]->passwd_hash);
+
+	return (unsigned int) done.size();
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the auth queue figures to the registry
+ *
+ *********************************************************************************************/
+
+void AuthPool::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_auth_queue_depth", "Password hashes waiting for an auth worker", _queue_metric);
+	metrics.addSummary("aime_auth_hash_usecs", "Time taken by each password hash on the auth workers",
+																										_hash_metric);
+	metrics.addCounter("aime_auth_refused_total", "Password attempts turned away because too many hashes were in flight",
+																										_refused_metric);
+}
@@ -0,0 +1,257 @@
+#include <sstream>
+#include "BehaviorMgr.h"
+#include "EntityDB.h"
+#include "UserMgr.h"
+#include "ActionMgr.h"
+#include "Location.h"
+#include "NPC.h"
+#include "Player.h"
+#include "global.h"
+
+BehaviorMgr::BehaviorMgr():
+							_zones(),
+							_awake(),
+							_rng(std::random_device{}())
+{
+
+}
+
+// Zones are shared, so a copy sees the same NPCs
+BehaviorMgr::BehaviorMgr(const BehaviorMgr &copy_from):
+							_zones(copy_from._zones),
+							_awake(copy_from._awake),
+							_turn_secs(copy_from._turn_secs),
+							_rng(std::random_device{}())
+{
+
+}
+
+BehaviorMgr::~BehaviorMgr() {
+
+}
+
+/*********************************************************************************************
+ * initialize - reads the turn length and groups the NPCs already loaded by zone
+ *
+ *		Params:	cfg_info - the MUD's config
+ *					edb - the entities, already loaded and linked
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::initialize(libconfig::Config &cfg_info, EntityDB &edb) {
+	cfg_info.lookupValue("misc.npc_turn_secs", _turn_secs);
+	if (_turn_secs <= 0.0) {
+		mudlog->writeLog("NPC behaviors are off.", 2);
+		return;
+	}
+
+	std::vector<std::shared_ptr<Physical>> physicals;
+	edb.listPhysicals(physicals);
+
+	for (unsigned int i=0; i<physicals.size(); i++) {
+		std::shared_ptr<NPC> npc = std::dynamic_pointer_cast<NPC>(physicals[i]);
+		if (npc != nullptr)
+			addNPC(npc);
+	}
+}
+
+/*********************************************************************************************
+ * addNPC - adds the NPC to its zone's group
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::addNPC(std::shared_ptr<NPC> npc) {
+	std::string zonename;
+	npc->getZoneID(zonename);
+
+	std::shared_ptr<zone_npcs> &zone = _zones[zonename];
+	if (zone == nullptr)
+		zone = std::make_shared<zone_npcs>();
+	zone->npcs.push_back(npc);
+}
+
+/*********************************************************************************************
+ * handleBehaviors - wakes the zones that players are in and puts to sleep those they've left.
+ *						   An awake zone's NPCs take their turns every npc_turn_secs, starting one
+ *						   turn after it wakes so a player walking in isn't set upon right away.
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::handleBehaviors(UserMgr &users, ActionMgr &actions) {
+	if (_turn_secs <= 0.0)
+		return;
+
+	std::set<std::string> occupied;
+	users.listOccupiedZones(occupied);
+
+	auto now = std::chrono::steady_clock::now();
+	auto turn_len = std::chrono::milliseconds((int) (_turn_secs * 1000));
+
+	std::set<std::string> awake;
+	for (auto zone_it = occupied.begin(); zone_it != occupied.end(); zone_it++) {
+		auto npcs_it = _zones.find(*zone_it);
+		if (npcs_it == _zones.end())
+			continue;
+
+		zone_npcs &zone = *npcs_it->second;
+		awake.insert(*zone_it);
+		if (!zone.awake) {
+			zone.awake = true;
+			zone.next_turn = now + turn_len;
+			continue;
+		}
+
+		if (now < zone.next_turn)
+			continue;
+
+		takeTurns(zone, actions);
+		zone.next_turn = now + turn_len;
+	}
+
+	// Zones nobody is in anymore go to sleep
+	for (auto zone_it = _awake.begin(); zone_it != _awake.end(); zone_it++) {
+		if (awake.count(*zone_it) == 0)
+			_zones[*zone_it]->awake = false;
+	}
+	_awake.swap(awake);
+	_awake_metric.set((int64_t) _awake.size());
+}
+
+/*********************************************************************************************
+ * takeTurns - gives each NPC of the zone that is alive and in a location a turn
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::takeTurns(zone_npcs &zone, ActionMgr &actions) {
+	for (unsigned int i=0; i<zone.npcs.size(); i++) {
+		if (zone.npcs[i]->getCurLoc() == nullptr)
+			continue;
+
+		behave(zone.npcs[i], actions);
+		_turns_metric.add();
+	}
+}
+
+/*********************************************************************************************
+ * behave - decides what the NPC does this turn. A "behave" special on the NPC goes first and
+ *				if it ends the turn (returns 1) the NPC does nothing else. Otherwise an aggressive
+ *				NPC may attack a player in the room (not in a Peaceful one), a timid one
+ *				(negative aggression) may flee, and one with speed may wander.
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::behave(std::shared_ptr<NPC> npc, ActionMgr &actions) {
+	std::shared_ptr<Location> loc = std::dynamic_pointer_cast<Location>(npc->getCurLoc());
+	if (loc == nullptr)
+		return;
+
+	std::vector<std::pair<std::string, std::shared_ptr<Physical>>> variables;
+	variables.push_back(std::pair<std::string, std::shared_ptr<Physical>>("actor", npc));
+	variables.push_back(std::pair<std::string, std::shared_ptr<Physical>>("location", loc));
+	if (npc->execSpecial("behave", variables) == 2)
+		return;
+
+	int aggression = npc->hasAttribute("aggression") ? npc->getAttribInt("aggression") : 0;
+	int speed = npc->hasAttribute("speed") ? npc->getAttribInt("speed") : 0;
+
+	const std::vector<std::shared_ptr<Player>> &players = loc->getPlayers();
+	if ((players.size() > 0) && (aggression > 0) && !loc->isLocFlagSet(Location::Peaceful) &&
+																					((int) roll() < aggression)) {
+		std::uniform_int_distribution<size_t> pick(0, players.size() - 1);
+		if (queueAction(actions, "hit", npc, players[pick(_rng)]))
+			return;
+	}
+
+	if ((players.size() > 0) && (aggression < 0) && ((int) roll() < -aggression)) {
+		if (wander(npc, loc, actions))
+			return;
+	}
+
+	if ((speed > 0) && ((int) roll() < speed))
+		wander(npc, loc, actions);
+}
+
+/*********************************************************************************************
+ * wander - sends the NPC through a random exit that leads somewhere in its own zone
+ *
+ *		Returns: true if a move was queued, false if there was nowhere to go
+ *
+ *********************************************************************************************/
+
+bool BehaviorMgr::wander(std::shared_ptr<NPC> npc, std::shared_ptr<Location> loc, ActionMgr &actions) {
+	std::vector<std::pair<std::string, std::shared_ptr<Location>>> exits;
+	loc->getMobileExits(exits);
+
+	std::string npc_zone, exit_zone;
+	npc->getZoneID(npc_zone);
+
+	auto exit_it = exits.begin();
+	while (exit_it != exits.end()) {
+		if (npc_zone.compare(exit_it->second->getZoneID(exit_zone)) != 0)
+			exit_it = exits.erase(exit_it);
+		else
+			exit_it++;
+	}
+
+	if (exits.size() == 0)
+		return false;
+
+	std::uniform_int_distribution<size_t> pick(0, exits.size() - 1);
+	return queueAction(actions, "go", npc, nullptr, exits[pick(_rng)].first.c_str());
+}
+
+/*********************************************************************************************
+ * queueAction - clones the action, fills it in for the NPC and queues it to run right away
+ *
+ *		Params:	cmd - the action's name, as it's found in the ActionMgr
+ *					target - the action's first target, or nullptr
+ *					token - for actions that take a word rather than a target (like go), or NULL
+ *
+ *		Returns: true if it was queued, false (logged) if there's no such action
+ *
+ *********************************************************************************************/
+
+bool BehaviorMgr::queueAction(ActionMgr &actions, const char *cmd, std::shared_ptr<NPC> npc,
+																std::shared_ptr<Physical> target, const char *token) {
+	Action *new_act = actions.cloneAction(cmd);
+	if (new_act == NULL) {
+		std::string msg("NPC behavior could not find action '");
+		msg += cmd;
+		msg += "'.";
+		mudlog->writeLog(msg);
+		return false;
+	}
+
+	new_act->setActor(npc);
+	if (target != nullptr)
+		new_act->setTarget1(target);
+	if (token != NULL)
+		new_act->addToken(token);
+
+	new_act->setExecuteNow();
+	actions.execAction(new_act);
+	_actions_metric.add();
+	return true;
+}
+
+/*********************************************************************************************
+ * roll - a random number from 0 to 99
+ *
+ *********************************************************************************************/
+
+unsigned int BehaviorMgr::roll() {
+	std::uniform_int_distribution<unsigned int> percent(0, 99);
+	return percent(_rng);
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the NPC figures to the registry
+ *
+ *********************************************************************************************/
+
+void BehaviorMgr::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_npc_awake_zones", "Zones with players in them, whose NPCs are taking turns",
+																											_awake_metric);
+	metrics.addCounter("aime_npc_turns_total", "Turns taken by NPCs in awake zones", _turns_metric);
+	metrics.addCounter("aime_npc_actions_total", "Actions queued by NPC behaviors", _actions_metric);
+}
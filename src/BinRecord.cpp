@@ -0,0 +1,177 @@
+#include <string.h>
+#include "BinRecord.h"
+
+RecordWriter::RecordWriter():
+						_body(),
+						_keys(),
+						_key_idx()
+{
+
+}
+
+/*********************************************************************************************
+ * appendVarint - LEB128: seven bits at a time, low bits first, high bit set on all but the last
+ *
+ *********************************************************************************************/
+
+void RecordWriter::appendVarint(std::string &buf, uint64_t value) {
+	while (value >= 0x80) {
+		buf += (char) ((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	buf += (char) value;
+}
+
+void RecordWriter::putVarint(uint64_t value) {
+	appendVarint(_body, value);
+}
+
+// Zigzag so small negative numbers stay small
+void RecordWriter::putSigned(int64_t value) {
+	appendVarint(_body, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+void RecordWriter::putFloat(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for (unsigned int i=0; i<4; i++)
+		_body += (char) ((bits >> (i * 8)) & 0xFF);
+}
+
+void RecordWriter::putString(const std::string &value) {
+	appendVarint(_body, value.size());
+	_body += value;
+}
+
+void RecordWriter::putBytes(const std::vector<unsigned char> &value) {
+	appendVarint(_body, value.size());
+	_body.append(value.begin(), value.end());
+}
+
+/*********************************************************************************************
+ * putKey - writes the index of the key, adding it to the key table the first time it is seen
+ *
+ *********************************************************************************************/
+
+void RecordWriter::putKey(const std::string &key) {
+	auto key_it = _key_idx.find(key);
+	if (key_it == _key_idx.end()) {
+		key_it = _key_idx.emplace(key, _keys.size()).first;
+		_keys.push_back(key);
+	}
+	appendVarint(_body, key_it->second);
+}
+
+/*********************************************************************************************
+ * finish - puts the record together
+ *
+ *		Params:	magic - 4 characters identifying the kind of record
+ *					version - the format version the body was written in
+ *					out - set to the finished record
+ *
+ *********************************************************************************************/
+
+void RecordWriter::finish(const char *magic, unsigned int version, std::string &out) const {
+	out.clear();
+	out.reserve(_body.size() + 64);
+	out.append(magic, 4);
+	appendVarint(out, version);
+
+	appendVarint(out, _keys.size());
+	for (unsigned int i=0; i<_keys.size(); i++) {
+		appendVarint(out, _keys[i].size());
+		out += _keys[i];
+	}
+
+	out += _body;
+}
+
+
+RecordReader::RecordReader(const std::string &data):
+						_data(data),
+						_keys()
+{
+
+}
+
+/*********************************************************************************************
+ * open - checks that this is the kind of record expected and loads the key table
+ *
+ *		Returns: the version the record was written in
+ *
+ *		Throws: record_error if the magic doesn't match or the header is cut short
+ *
+ *********************************************************************************************/
+
+unsigned int RecordReader::open(const char *magic) {
+	_pos = 0;
+	need(4);
+	if (_data.compare(0, 4, magic, 4) != 0)
+		throw record_error("not a record of the expected type");
+	_pos = 4;
+
+	unsigned int version = (unsigned int) getVarint();
+
+	uint64_t num_keys = getVarint();
+	_keys.clear();
+	for (uint64_t i=0; i<num_keys; i++) {
+		std::string key;
+		getString(key);
+		_keys.push_back(key);
+	}
+	return version;
+}
+
+void RecordReader::need(size_t bytes) const {
+	if (_data.size() - _pos < bytes)
+		throw record_error("record ends early");
+}
+
+uint64_t RecordReader::getVarint() {
+	uint64_t value = 0;
+	for (unsigned int shift=0; shift < 64; shift += 7) {
+		need(1);
+		uint8_t byte = (uint8_t) _data[_pos++];
+		value |= (uint64_t) (byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	throw record_error("varint too long");
+}
+
+int64_t RecordReader::getSigned() {
+	uint64_t value = getVarint();
+	return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+float RecordReader::getFloat() {
+	need(4);
+	uint32_t bits = 0;
+	for (unsigned int i=0; i<4; i++)
+		bits |= (uint32_t) (uint8_t) _data[_pos++] << (i * 8);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void RecordReader::getString(std::string &value) {
+	uint64_t len = getVarint();
+	need((size_t) len);
+	value.assign(_data, _pos, (size_t) len);
+	_pos += (size_t) len;
+}
+
+void RecordReader::getBytes(std::vector<unsigned char> &value) {
+	uint64_t len = getVarint();
+	need((size_t) len);
+	value.assign(_data.begin() + (long) _pos, _data.begin() + (long) (_pos + len));
+	_pos += (size_t) len;
+}
+
+const std::string &RecordReader::getKey() {
+	uint64_t idx = getVarint();
+	if (idx >= _keys.size())
+		throw record_error("key index out of range");
+	return _keys[(size_t) idx];
+}
@@ -0,0 +1,61 @@
+#include "Broadcast.h"
+#include "Player.h"
+
+Broadcast::Broadcast(const char *msg):
+								_msg(msg),
+								_formatted()
+{
+
+}
+
+Broadcast::Broadcast(const std::string &msg):
+								_msg(msg),
+								_formatted()
+{
+
+}
+
+Broadcast::Broadcast(const Broadcast &copy_from):
+								_msg(copy_from._msg),
+								_formatted(copy_from._formatted)
+{
+
+}
+
+Broadcast::~Broadcast() {
+
+}
+
+/*********************************************************************************************
+ * getFormatted - returns the message formatted for the given output profile. The first player
+ *					   with a profile pays for the formatting, the rest share the same buffer.
+ *
+ *    Params:  use_color - whether the recipient wants ANSI color codes
+ *             wrap_width - the recipient's word wrap width (0 for none)
+ *             end_wrap - populated with the wrap column after this message is sent
+ *
+ *		Returns: shared pointer to the formatted buffer. Callers must not modify it.
+ *
+ *********************************************************************************************/
+
+std::shared_ptr<std::string> Broadcast::getFormatted(bool use_color, unsigned int wrap_width, 
+																						unsigned int &end_wrap) {
+	for (unsigned int i=0; i<_formatted.size(); i++) {
+		if ((_formatted[i].use_color == use_color) && (_formatted[i].wrap_width == wrap_width)) {
+			end_wrap = _formatted[i].end_wrap;
+			return _formatted[i].formatted;
+		}
+	}
+
+	fmtprofile new_fmt;
+	new_fmt.use_color = use_color;
+	new_fmt.wrap_width = wrap_width;
+	new_fmt.end_wrap = 0;
+	new_fmt.formatted = std::make_shared<std::string>();
+
+	Player::formatForTelnet(_msg, *new_fmt.formatted, use_color, wrap_width, new_fmt.end_wrap);
+
+	_formatted.push_back(new_fmt);
+	end_wrap = new_fmt.end_wrap;
+	return new_fmt.formatted;
+}
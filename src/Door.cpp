@@ -308,6 +308,19 @@ std::shared_ptr<Physical> Door::getOppositeLoc(Location *cur_loc) {
    }
 }
 
+/*********************************************************************************************
+ * renderChanged - the door's state shows in the exits and contents of both of its rooms
+ *
+ *********************************************************************************************/
+
+void Door::renderChanged() {
+	Static::renderChanged();
+
+	std::shared_ptr<Location> locptr = std::dynamic_pointer_cast<Location>(_cur_loc2);
+	if (locptr != nullptr)
+		locptr->invalidateRender(Location::RenderExits | Location::RenderContents);
+}
+
 /*********************************************************************************************
  * getCurRoomdesc - Gets the roomdesc matching the cur_loc and current door state
  *
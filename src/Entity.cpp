@@ -3,6 +3,7 @@
 #include <sstream>
 #include <regex>
 #include "Entity.h"
+#include "BinRecord.h"
 #include "global.h"
 #include "Attribute.h"
 #include "misc.h"
@@ -21,6 +22,7 @@ Entity::Entity(const char *id):
 
 // Called by child class
 Entity::Entity(const Entity &copy_from):
+								_typename(copy_from._typename),
 								_id(copy_from._id)
 {
 
@@ -146,6 +148,25 @@ int Entity::loadData(pugi::xml_node &entnode) {
 
 }
 
+/*********************************************************************************************
+ * saveRecord/loadRecord - binary versions of saveData/loadData. Child classes call these first
+ *								   and then write or read their own fields, in the same order.
+ *
+ *		Returns: (loadRecord) 1 for success, 0 for failure
+ *
+ *		Throws: record_error - (loadRecord) the record is cut short or corrupted
+ *
+ *********************************************************************************************/
+
+void Entity::saveRecord(RecordWriter &rec) const {
+	rec.putString(_id);
+}
+
+int Entity::loadRecord(RecordReader &rec) {
+	rec.getString(_id);
+	return 1;
+}
+
 /*********************************************************************************************
  * loadEntity - Public entrypoint for all entities to load their class-specific details
  *
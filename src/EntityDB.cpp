@@ -14,6 +14,8 @@
 #include "Door.h"
 #include "Trait.h"
 #include "Script.h"
+#include "ZoneReset.h"
+#include "ActionMgr.h"
 
 
 /*********************************************************************************************
@@ -70,12 +72,19 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
    boost::filesystem::directory_iterator start(p), end;
    std::transform(start, end, std::back_inserter(files), path_leaf_string());
 
+	// Most entities a zone reset may check, restore or spawn in one heartbeat
+	int reset_budget = 100;
+	mud_cfg.lookupValue("misc.reset_budget", reset_budget);
+
    pugi::xml_document zonefile;
    for (unsigned int i=0; i<files.size(); i++) {
       std::string filepath(zonedir);
       filepath += "/";
       filepath += files[i].c_str();
 
+		// The entities from this file that a zone reset would put back
+		std::vector<std::shared_ptr<Physical>> members;
+
       pugi::xml_parse_result result = zonefile.load_file(filepath.c_str());
 
       if (!result) {
@@ -84,6 +93,7 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
 			errmsg.str("");
 			errmsg << "Unable to open/parse zone file '" << filepath << "', (line: " << linenum << ") error: " << result.description();
          mudlog->writeLog(errmsg.str().c_str());
+         engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, errmsg.str());
          continue;
       }
 
@@ -94,6 +104,7 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
 				std::stringstream msg;
 				msg << "Bad location format for loc '" << new_ent->getID() << "', file '" << files[i] << "'";
 				mudlog->writeLog(msg.str().c_str());
+				engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
 				delete new_ent;
 				continue;
 			}
@@ -109,12 +120,13 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for static '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
          std::shared_ptr<Physical> newptr(new_ent);
          new_ent->setSelfPtr(newptr);
-         _db.insert(std::pair<std::string, std::shared_ptr<Physical>>(new_ent->getID(), newptr));
+         insertLoaded(stat, newptr, members);
          count++;
  			 
 		}
@@ -125,12 +137,13 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for getable '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
          std::shared_ptr<Physical> newptr(new_ent);
          new_ent->setSelfPtr(newptr);
-         _db.insert(std::pair<std::string, std::shared_ptr<Physical>>(new_ent->getID(), newptr));
+         insertLoaded(get_x, newptr, members);
          count++;
 
       }
@@ -141,6 +154,7 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for door '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
@@ -159,12 +173,13 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for equipment '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
          std::shared_ptr<Physical> newptr(new_ent);
          new_ent->setSelfPtr(newptr);
-         _db.insert(std::pair<std::string, std::shared_ptr<Physical>>(new_ent->getID(),newptr));
+         insertLoaded(get_x, newptr, members);
          count++;
 
       }
@@ -175,12 +190,13 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for NPC '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
          std::shared_ptr<Physical> newptr(new_ent);
          new_ent->setSelfPtr(newptr);
-         _db.insert(std::pair<std::string, std::shared_ptr<Physical>>(new_ent->getID(), newptr));
+         insertLoaded(get_x, newptr, members);
          count++;
 
       }
@@ -192,6 +208,7 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for Script '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
@@ -201,6 +218,28 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
 
       }
 
+		// The zone's reset schedule, if it has one
+		pugi::xml_node zonenode = zonefile.child("zone");
+		if (zonenode) {
+			std::shared_ptr<ZoneReset> reset;
+			try {
+				reset = std::make_shared<ZoneReset>(zonenode.attribute("name").value());
+			} catch (std::invalid_argument &e) {
+				reset = nullptr;
+			}
+
+			if ((reset == nullptr) || !reset->loadZone(zonenode)) {
+				std::stringstream msg;
+				msg << "Bad zone reset format in file '" << files[i] << "', the zone will not reset.";
+				mudlog->writeLog(msg.str().c_str());
+				engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
+			} else {
+				for (unsigned int j=0; j<members.size(); j++)
+					reset->addMember(members[j]);
+				reset->setBudget((unsigned int) std::max(reset_budget, 1));
+				_resets.push_back(reset);
+			}
+		}
 	}
 
 
@@ -212,10 +251,39 @@ int EntityDB::loadPhysicals(libconfig::Config &mud_cfg) {
 			pptr->addLinks(*this, pptr);
 	}
 
+	// Only now that everything is in place do changes count toward world checkpoints
+	for (ent_it = _db.begin(); ent_it != _db.end(); ent_it++) {
+		std::shared_ptr<Physical> pptr = std::dynamic_pointer_cast<Physical>(ent_it->second);
+		if (pptr != nullptr)
+			pptr->trackState(true);
+	}
+
 	return count;
  
 }
 
+/*********************************************************************************************
+ * insertLoaded - adds an entity just read from a zone file to the database and the zone's
+ *					   members or, if it has prototype="true", to the prototypes
+ *
+ *********************************************************************************************/
+
+void EntityDB::insertLoaded(pugi::xml_node &xnode, std::shared_ptr<Physical> newptr,
+															std::vector<std::shared_ptr<Physical>> &members) {
+	if (!xnode.attribute("prototype").as_bool()) {
+		_db.insert(std::pair<std::string, std::shared_ptr<Physical>>(newptr->getID(), newptr));
+		members.push_back(newptr);
+		return;
+	}
+
+	if (!_prototypes.insert(std::pair<std::string, std::shared_ptr<Physical>>(newptr->getID(), newptr)).second) {
+		std::string msg("Duplicate prototype '");
+		msg += newptr->getID();
+		msg += "', keeping the first.";
+		mudlog->writeLog(msg);
+	}
+}
+
 /*********************************************************************************************
  * loadTraits - reads the traits directory and loads all files in that directory.
  *
@@ -258,6 +326,7 @@ int EntityDB::loadTraits(libconfig::Config &mud_cfg) {
          msg += ", error: ";
          msg += result.description();
          mudlog->writeLog(msg.c_str());
+         engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg);
          continue;
       }
 
@@ -268,6 +337,7 @@ int EntityDB::loadTraits(libconfig::Config &mud_cfg) {
             std::stringstream msg;
             msg << "Bad format for trait '" << new_ent->getID() << "', file '" << files[i] << "'";
             mudlog->writeLog(msg.str().c_str());
+            engine.getEventLog()->writeEvent(EventLog::LoadFailure, filepath, msg.str());
             delete new_ent;
             continue;
          }
@@ -295,6 +365,98 @@ std::shared_ptr<Physical> EntityDB::getPhysical(const char *id) {
 	return phyptr;
 }
 
+/*********************************************************************************************
+ * scheduleResets - checks the zone resets' spawn rules and queues each reset's first pass,
+ *						  which fills the spawn rules right away
+ *
+ *		Returns: number of zones that reset
+ *
+ *********************************************************************************************/
+
+unsigned int EntityDB::scheduleResets(ActionMgr &actions) {
+	for (unsigned int i=0; i<_resets.size(); i++) {
+		_resets[i]->checkRules(*this);
+		_resets[i]->start();
+		actions.addJob(_resets[i]);
+	}
+	return _resets.size();
+}
+
+/*********************************************************************************************
+ * getPrototype - retrieves the prototype with the given id
+ *
+ *		Returns: shared_ptr to the prototype, or set to null if not found
+ *
+ *********************************************************************************************/
+
+std::shared_ptr<Physical> EntityDB::getPrototype(const char *id) {
+	auto proto_it = _prototypes.find(id);
+
+	if (proto_it == _prototypes.end())
+		return std::shared_ptr<Physical>(nullptr);
+	return proto_it->second;
+}
+
+/*********************************************************************************************
+ * spawn - creates a new entity from a prototype. It shares the prototype's descriptions,
+ *			  specials and attributes, copying only what it later changes, so spawning is cheap and
+ *			  many copies of a prototype take little more memory than one. Its ID is the
+ *			  prototype's with a number added (demo:goblin_12).
+ *
+ *		Params:	proto_id - the prototype to copy
+ *					loc - where to put the new entity. If null, it goes where the prototype's startloc
+ *							says and equipment marked startequipped is worn
+ *
+ *		Returns: the new entity, or null (logged) if there's no such prototype
+ *
+ *********************************************************************************************/
+
+std::shared_ptr<Physical> EntityDB::spawn(const char *proto_id, std::shared_ptr<Physical> loc) {
+	std::shared_ptr<Physical> proto = getPrototype(proto_id);
+	if (proto == nullptr) {
+		std::string msg("Attempt to spawn from prototype '");
+		msg += proto_id;
+		msg += "' which doesn't exist.";
+		mudlog->writeLog(msg);
+		return std::shared_ptr<Physical>(nullptr);
+	}
+
+	// Most derived type first
+	Physical *new_ent = NULL;
+	if (std::dynamic_pointer_cast<Equipment>(proto) != nullptr)
+		new_ent = new Equipment(*std::dynamic_pointer_cast<Equipment>(proto));
+	else if (std::dynamic_pointer_cast<Getable>(proto) != nullptr)
+		new_ent = new Getable(*std::dynamic_pointer_cast<Getable>(proto));
+	else if (std::dynamic_pointer_cast<Static>(proto) != nullptr)
+		new_ent = new Static(*std::dynamic_pointer_cast<Static>(proto));
+	else if (std::dynamic_pointer_cast<NPC>(proto) != nullptr)
+		new_ent = new NPC(*std::dynamic_pointer_cast<NPC>(proto));
+	else
+		throw std::runtime_error("EntityDB::spawn - prototype is not a type that can be spawned");
+
+	std::string new_id;
+	do {
+		new_id = proto_id;
+		new_id += "_";
+		new_id += std::to_string(++_spawn_count);
+	} while (_db.count(new_id) > 0);
+	new_ent->setID(new_id.c_str());
+
+	std::shared_ptr<Physical> newptr(new_ent);
+	new_ent->setSelfPtr(newptr);
+	_db.insert(std::pair<std::string, std::shared_ptr<Physical>>(new_id, newptr));
+
+	if (loc != nullptr)
+		new_ent->movePhysical(loc, newptr);
+	else
+		new_ent->addLinks(*this, newptr);
+
+	std::shared_ptr<NPC> npc = std::dynamic_pointer_cast<NPC>(newptr);
+	if (npc != nullptr)
+		engine.getBehaviorMgr()->addNPC(npc);
+	return newptr;
+}
+
 /*********************************************************************************************
  * getScript - retrieves the script with the given id
  *
@@ -345,3 +507,29 @@ size_t EntityDB::purgePhysical(std::shared_ptr<Physical> item) {
 	return count;
 }
 
+/*********************************************************************************************
+ * listPhysicals - fills the list with every physical in the database
+ *
+ *********************************************************************************************/
+
+void EntityDB::listPhysicals(std::vector<std::shared_ptr<Physical>> &list) {
+	list.clear();
+	for (auto ent_it = _db.begin(); ent_it != _db.end(); ent_it++) {
+		std::shared_ptr<Physical> pptr = std::dynamic_pointer_cast<Physical>(ent_it->second);
+		if (pptr != nullptr)
+			list.push_back(pptr);
+	}
+}
+
+/*********************************************************************************************
+ * takeDirty - hands over the entities changed since the last call and clears their dirty
+ *				   flags, so further changes queue them again
+ *
+ *********************************************************************************************/
+
+void EntityDB::takeDirty(std::vector<std::shared_ptr<Physical>> &dirty) {
+	dirty.clear();
+	dirty.swap(_dirty);
+	for (unsigned int i=0; i<dirty.size(); i++)
+		dirty[i]->clearStateDirty();
+}
@@ -14,16 +14,20 @@ const char *equipflag_list[] = {"twohanded", "antimagic", "outerlayer", NULL};
  *
  *********************************************************************************************/
 Equipment::Equipment(const char *id):
-								Getable(id)
+								Getable(id),
+								_equip_list(std::make_shared<std::vector<std::pair<std::string, std::string>>>())
 {
 	_typename = "Equipment";
 
 	addAttribute("damage", 0);
 }
 
-// Copy constructor
+// Copy constructor - the body part list is shared
 Equipment::Equipment(const Equipment &copy_from):
-								Getable(copy_from)
+								Getable(copy_from),
+								_equip_list(copy_from._equip_list),
+								_equipflags(copy_from._equipflags),
+								_start_equipped(copy_from._start_equipped)
 {
 
 }
@@ -109,7 +113,7 @@ int Equipment::loadData(pugi::xml_node &entnode) {
             return 0;
          }
 
-			_equip_list.push_back(std::pair<std::string, std::string>(bpname, attr.value()));
+			writableCopy(_equip_list).push_back(std::pair<std::string, std::string>(bpname, attr.value()));
       }
       catch (std::invalid_argument &e) {
          errmsg << getTypeName() << " '" << getID() << "' equipment node error: " << e.what();
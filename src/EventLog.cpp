@@ -0,0 +1,286 @@
+#include <string.h>
+#include <strings.h>
+#include "EventLog.h"
+#include "exceptions.h"
+
+const char event_magic[] = "AIMEEV";
+const size_t header_size = 8;
+
+const char *event_names[] = {"none", "connect", "disconnect", "login", "command", "scripterror",
+									  "loadfailure", NULL};
+
+// Type, timestamp and three one-byte varints. No one record should get near the max, anything
+// larger means the file is corrupted
+const uint32_t min_record_size = 12;
+const uint32_t max_record_size = 1 << 20;
+
+EventLog::EventLog():
+								_enabled(false),
+								_buffer(),
+								_last_flush(std::chrono::steady_clock::now())
+{
+
+}
+
+// Copies settings only, the copy is not open
+EventLog::EventLog(const EventLog &copy_from):
+								_enabled(false),
+								_buffer(),
+								_flush_bytes(copy_from._flush_bytes),
+								_last_flush(copy_from._last_flush)
+{
+
+}
+
+EventLog::~EventLog() {
+	close();
+}
+
+/*********************************************************************************************
+ * open - opens the file for appending, writing the header if the file is new
+ *
+ *    Params:  filename - the event file to write
+ *             flush_bytes - write to the file once this much has been buffered
+ *
+ *    Throws:  logfile_error if the file could not be opened
+ *
+ *********************************************************************************************/
+
+void EventLog::open(const char *filename, size_t flush_bytes) {
+	close();
+
+	std::lock_guard<std::mutex> guard(_event_mutex);
+	if ((_efptr = fopen(filename, "ab")) == NULL) {
+		std::string msg("Unable to open event log '");
+		msg += filename;
+		msg += "' to append.";
+		throw logfile_error(msg);
+	}
+
+	// A new file gets the header
+	fseek(_efptr, 0, SEEK_END);
+	if (ftell(_efptr) == 0) {
+		char header[header_size] = {0};
+		memcpy(header, event_magic, strlen(event_magic));
+		header[6] = (char) version;
+		fwrite(header, 1, header_size, _efptr);
+	}
+
+	_flush_bytes = flush_bytes;
+	_buffer.reserve(flush_bytes + 256);
+	_last_flush = std::chrono::steady_clock::now();
+	_enabled = true;
+}
+
+/*********************************************************************************************
+ * close - writes out the buffer and closes the file
+ *
+ *********************************************************************************************/
+
+void EventLog::close() {
+	std::lock_guard<std::mutex> guard(_event_mutex);
+	_enabled = false;
+
+	if (_efptr == NULL)
+		return;
+
+	writeBuffer();
+	fclose(_efptr);
+	_efptr = NULL;
+}
+
+/*********************************************************************************************
+ * appendVarint - appends value 7 bits at a time, low bits first, with the high bit of each
+ *					   byte set if more follow
+ *
+ *********************************************************************************************/
+
+void EventLog::appendVarint(std::string &buf, uint64_t value) {
+	while (value >= 0x80) {
+		buf += (char) ((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	buf += (char) value;
+}
+
+/*********************************************************************************************
+ * writeEvent - encodes an event onto the buffer, writing the buffer out if it is full
+ *
+ *    Params:  type - the kind of event
+ *             subject, detail, value - see event_types for what each type stores
+ *
+ *********************************************************************************************/
+
+void EventLog::writeEvent(event_types type, const char *subject, const char *detail, uint64_t value) {
+	if (!_enabled)
+		return;
+
+	uint64_t timestamp = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+									std::chrono::system_clock::now().time_since_epoch()).count();
+	size_t subject_len = strlen(subject);
+	size_t detail_len = strlen(detail);
+
+	std::lock_guard<std::mutex> guard(_event_mutex);
+	if (_efptr == NULL)
+		return;
+
+	// Leave room for the length, fill it in once we know it
+	size_t start = _buffer.size();
+	_buffer.append(4, '\0');
+
+	_buffer += (char) type;
+	for (unsigned int i=0; i<8; i++)
+		_buffer += (char) ((timestamp >> (i * 8)) & 0xff);
+	appendVarint(_buffer, value);
+	appendVarint(_buffer, subject_len);
+	_buffer.append(subject, subject_len);
+	appendVarint(_buffer, detail_len);
+	_buffer.append(detail, detail_len);
+
+	uint32_t length = (uint32_t) (_buffer.size() - start - 4);
+	for (unsigned int i=0; i<4; i++)
+		_buffer[start + i] = (char) ((length >> (i * 8)) & 0xff);
+
+	if (_buffer.size() >= _flush_bytes)
+		writeBuffer();
+}
+
+/*********************************************************************************************
+ * flush/checkFlush - write the buffer out now, or if it has been flush_ms since the last time
+ *
+ *********************************************************************************************/
+
+void EventLog::flush() {
+	std::lock_guard<std::mutex> guard(_event_mutex);
+	writeBuffer();
+}
+
+void EventLog::checkFlush(std::chrono::milliseconds flush_ms) {
+	if (!_enabled)
+		return;
+
+	if (std::chrono::steady_clock::now() - _last_flush >= flush_ms)
+		flush();
+}
+
+// Must be called with _event_mutex held
+void EventLog::writeBuffer() {
+	_last_flush = std::chrono::steady_clock::now();
+
+	if ((_efptr == NULL) || (_buffer.size() == 0))
+		return;
+
+	fwrite(_buffer.data(), 1, _buffer.size(), _efptr);
+	fflush(_efptr);
+	_buffer.clear();
+}
+
+/*********************************************************************************************
+ * readHeader - checks that the file starts with an event log header we can read
+ *
+ *    Returns: true if it does, false if not
+ *
+ *********************************************************************************************/
+
+bool EventLog::readHeader(FILE *fptr) {
+	unsigned char header[header_size];
+	if (fread(header, 1, header_size, fptr) != header_size)
+		return false;
+
+	if (memcmp(header, event_magic, strlen(event_magic)) != 0)
+		return false;
+
+	return (header[6] <= version);
+}
+
+/*********************************************************************************************
+ * getVarint - decodes a varint, moving pos past it
+ *
+ *    Returns: false if the data ran out first
+ *
+ *********************************************************************************************/
+
+bool EventLog::getVarint(const unsigned char *&pos, const unsigned char *end, uint64_t &value) {
+	value = 0;
+	unsigned int shift = 0;
+	while ((pos < end) && (shift < 64)) {
+		value |= (uint64_t) (*pos & 0x7f) << shift;
+		if ((*pos++ & 0x80) == 0)
+			return true;
+		shift += 7;
+	}
+	return false;
+}
+
+/*********************************************************************************************
+ * readEvent - reads the next record from the file
+ *
+ *    Params:  fptr - the file, positioned past the header or the last record
+ *             ev - populated with the record
+ *
+ *    Returns: true if a record was read, false at the end of the file
+ *
+ *    Throws:  logfile_error if the record is corrupted or cut short
+ *
+ *********************************************************************************************/
+
+bool EventLog::readEvent(FILE *fptr, event &ev) {
+	unsigned char lenbuf[4];
+	size_t got = fread(lenbuf, 1, 4, fptr);
+	if (got == 0)
+		return false;
+
+	if (got != 4)
+		throw logfile_error("Event log ends partway through a record.");
+
+	uint32_t length = (uint32_t) lenbuf[0] | ((uint32_t) lenbuf[1] << 8) |
+							((uint32_t) lenbuf[2] << 16) | ((uint32_t) lenbuf[3] << 24);
+	if ((length < min_record_size) || (length > max_record_size))
+		throw logfile_error("Event log record has an invalid length.");
+
+	std::string record(length, '\0');
+	if (fread(&record[0], 1, length, fptr) != length)
+		throw logfile_error("Event log ends partway through a record.");
+
+	const unsigned char *pos = (const unsigned char *) record.data();
+	const unsigned char *end = pos + length;
+
+	// Types from a newer version are passed through as NoEvent
+	ev.type = (*pos < NumEventTypes) ? (event_types) *pos : NoEvent;
+	pos++;
+
+	ev.timestamp = 0;
+	for (unsigned int i=0; i<8; i++)
+		ev.timestamp |= (uint64_t) *pos++ << (i * 8);
+
+	uint64_t len;
+	if (!getVarint(pos, end, ev.value) || !getVarint(pos, end, len) || (len > (uint64_t) (end - pos)))
+		throw logfile_error("Event log record is corrupted.");
+	ev.subject.assign((const char *) pos, len);
+	pos += len;
+
+	if (!getVarint(pos, end, len) || (len > (uint64_t) (end - pos)))
+		throw logfile_error("Event log record is corrupted.");
+	ev.detail.assign((const char *) pos, len);
+
+	return true;
+}
+
+/*********************************************************************************************
+ * getTypeName/getTypeByName - convert between event types and their names
+ *
+ *********************************************************************************************/
+
+const char *EventLog::getTypeName(event_types type) {
+	if (type >= NumEventTypes)
+		return event_names[NoEvent];
+	return event_names[type];
+}
+
+EventLog::event_types EventLog::getTypeByName(const char *name) {
+	for (unsigned int i=0; event_names[i] != NULL; i++) {
+		if (strcasecmp(name, event_names[i]) == 0)
+			return (event_types) i;
+	}
+	return NoEvent;
+}
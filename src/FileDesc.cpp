@@ -105,11 +105,11 @@ ssize_t FileDesc::readFD(std::string &buf) {
    bzero(readbuf, sizeof(char) * bufsize);
    ssize_t amt_read = 0;
    if ((amt_read = read(_fd, readbuf, bufsize)) < 0) {
-      delete readbuf;
+      delete[] readbuf;
       return -1;
    }
    
-   buf = readbuf;
+   buf.assign(readbuf, (size_t) amt_read);
    delete[] readbuf;
    return amt_read;
 }
@@ -274,6 +274,9 @@ void SocketFD::listenFD(int backlog) {
 bool SocketFD::acceptFD(SocketFD &server) {
    socklen_t len = sizeof(_fd_addr);
 
+   // Release the socket the constructor made, accept gives us a new one
+   closeFD();
+
    _fd = accept(server.getFD(), (struct sockaddr *) &_fd_addr, &len);
    if (_fd == -1)
       return false;
@@ -0,0 +1,205 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include "FileStore.h"
+#include "misc.h"
+#include "global.h"
+
+FileStore::FileStore(const char *userdir):
+						PlayerStore(),
+						_userdir(userdir)
+{
+
+}
+
+FileStore::~FileStore() {
+
+}
+
+/*********************************************************************************************
+ * open - checks that the user directory is there
+ *
+ *********************************************************************************************/
+
+bool FileStore::open() {
+	struct stat dirinfo;
+	if ((stat(_userdir.c_str(), &dirinfo) != 0) || (!S_ISDIR(dirinfo.st_mode))) {
+		std::string msg("User directory '");
+		msg += _userdir;
+		msg += "' does not exist.";
+		mudlog->writeLog(msg);
+		return false;
+	}
+	return true;
+}
+
+/*********************************************************************************************
+ * getUserFile - gets the path to a player's save file
+ *
+ *    Params:  name - the player's name, any case
+ *             filename - set to the path
+ *             legacy - get the old XML file's path instead
+ *
+ *********************************************************************************************/
+
+void FileStore::getUserFile(const std::string &name, std::string &filename, bool legacy) const {
+   std::string user = name;
+   lower(user);
+
+   filename = _userdir;
+	filename += "/";
+   filename += user;
+   filename += legacy ? ".xml" : ".plr";
+}
+
+/*********************************************************************************************
+ * load - reads the player's file, or their old XML file if they haven't been saved since the
+ *		    switch to binary saves
+ *
+ *		Returns: 1 if found, 0 if not found, -1 if the file could not be read
+ *
+ *********************************************************************************************/
+
+int FileStore::load(const std::string &name, std::string &record) {
+	std::string filename;
+	getUserFile(name, filename);
+
+	std::ifstream userfile(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!userfile.is_open()) {
+		getUserFile(name, filename, true);
+		userfile.open(filename.c_str(), std::ios::in | std::ios::binary);
+		if (!userfile.is_open())
+			return 0;
+	}
+
+	record.assign((std::istreambuf_iterator<char>(userfile)), std::istreambuf_iterator<char>());
+	if (userfile.bad()) {
+		std::string msg("Error reading user file '");
+		msg += filename;
+		msg += "'.";
+		mudlog->writeLog(msg);
+		return -1;
+	}
+	return 1;
+}
+
+bool FileStore::exists(const std::string &name) {
+	return (lastSaved(name) != 0);
+}
+
+/*********************************************************************************************
+ * saveBatch - replaces each player's file in turn. A crash part way through the batch leaves
+ *				   some players with their new file and some with their old.
+ *
+ *********************************************************************************************/
+
+bool FileStore::saveBatch(const std::vector<store_record> &records) {
+	bool results = true;
+	std::string filename;
+
+	for (unsigned int i=0; i<records.size(); i++) {
+		getUserFile(records[i].name, filename);
+		if (!writeFile(filename, records[i].data))
+			results = false;
+	}
+
+	if (records.size() > 0)
+		syncDir(_userdir);
+	return results;
+}
+
+/*********************************************************************************************
+ * listNames - every player with a save file in the user directory, sorted
+ *
+ *********************************************************************************************/
+
+void FileStore::listNames(std::vector<std::string> &names) {
+	names.clear();
+
+	boost::system::error_code ec;
+	boost::filesystem::directory_iterator dir_it(_userdir, ec), end;
+	for ( ; !ec && (dir_it != end); dir_it.increment(ec)) {
+		std::string ext = dir_it->path().extension().string();
+		if ((ext == ".plr") || (ext == ".xml"))
+			names.push_back(dir_it->path().stem().string());
+	}
+
+	// A player may have both their file and an old XML one
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+time_t FileStore::lastSaved(const std::string &name) {
+	std::string filename;
+	struct stat fileinfo;
+
+	getUserFile(name, filename);
+	if (stat(filename.c_str(), &fileinfo) == 0)
+		return fileinfo.st_mtime;
+
+	getUserFile(name, filename, true);
+	if (stat(filename.c_str(), &fileinfo) == 0)
+		return fileinfo.st_mtime;
+	return 0;
+}
+
+/*********************************************************************************************
+ * writeFile - writes the data next to filename, flushes it to disk and renames it over
+ *				   filename so the file is never seen half written. The caller syncs the directory
+ *				   so the rename itself survives a crash.
+ *
+ *		Returns: true if successful, false (logged) otherwise
+ *
+ *********************************************************************************************/
+
+bool FileStore::writeFile(const std::string &filename, const std::string &data) {
+	std::string tmpfile(filename);
+	tmpfile += ".tmp";
+
+	const char *failed_at = NULL;
+	int fd = ::open(tmpfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		failed_at = "open";
+
+	size_t written = 0;
+	while ((failed_at == NULL) && (written < data.size())) {
+		ssize_t results = write(fd, data.c_str() + written, data.size() - written);
+		if (results < 0) {
+			if (errno != EINTR)
+				failed_at = "write";
+		} else
+			written += (size_t) results;
+	}
+
+	if ((failed_at == NULL) && (fsync(fd) != 0))
+		failed_at = "fsync";
+
+	if ((fd >= 0) && (close(fd) != 0) && (failed_at == NULL))
+		failed_at = "close";
+
+	if ((failed_at == NULL) && (rename(tmpfile.c_str(), filename.c_str()) != 0))
+		failed_at = "rename";
+
+	if (failed_at != NULL) {
+		std::stringstream msg;
+		msg << "Unable to save '" << filename << "', " << failed_at << " failed: " << strerror(errno);
+		mudlog->writeLog(msg.str().c_str());
+		unlink(tmpfile.c_str());
+		return false;
+	}
+	return true;
+}
+
+void FileStore::syncDir(const std::string &dir) {
+	int dirfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (dirfd >= 0) {
+		fsync(dirfd);
+		close(dirfd);
+	}
+}
@@ -49,7 +49,8 @@ int GameHandler::handleCommand(std::string &cmd) {
 		return 0;
 	}
 
-	// Now add it to the queue to be executed
+	// Charge the player for it, then add it to the queue to be executed
+	_plr->getCmdBucket().spend(new_action->getCost());
 	_actions.execAction(new_action);
 
 // 	_plr->sendPrompt();
@@ -5,6 +5,7 @@
 #include "MUD.h"
 #include "misc.h"
 #include "global.h"
+#include "BinRecord.h"
 
 const char *gflag_list[] = {"noget", "nodrop", "food", "rope", "luckfast", "thiefonly",  
 								"blockmagic", "fastheal", "enhancemagic", "canlight", "holy", "key", "booze", NULL};
@@ -15,7 +16,9 @@ const char *gflag_list[] = {"noget", "nodrop", "food", "rope", "luckfast", "thie
  *
  *********************************************************************************************/
 Getable::Getable(const char *id):
-								Static(id)
+								Static(id),
+								_roomdesc(std::make_shared<std::vector<std::pair<std::string, std::string>>>(
+															(size_t) Custom, std::pair<std::string, std::string>("","")))
 {
 	_typename = "Getable";
 
@@ -23,12 +26,14 @@ Getable::Getable(const char *id):
 	addAttribute("size", 0);
 
 
-	_roomdesc.assign((size_t) Custom, std::pair<std::string, std::string>("",""));
 }
 
-// Copy constructor
+// Copy constructor - the room descriptions are shared until one of the two changes them
 Getable::Getable(const Getable &copy_from):
-								Static(copy_from)
+								Static(copy_from),
+								_roomdesc(copy_from._roomdesc),
+								_getflags(copy_from._getflags),
+								_dstate(copy_from._dstate)
 {
 }
 
@@ -123,28 +128,28 @@ int Getable::loadData(pugi::xml_node &entnode) {
 
 	// Set the roomdesc to the appropriate one. First, pristine always has priority
 	_dstate = Custom;
-	if (_roomdesc[Pristine].first.size() > 0)
+	if ((*_roomdesc)[Pristine].first.size() > 0)
 		_dstate = Pristine;
-	else if ((isStaticFlagSet(Static::Lit)) && (_roomdesc[Lit].first.size() > 0))
+	else if ((isStaticFlagSet(Static::Lit)) && ((*_roomdesc)[Lit].first.size() > 0))
 		_dstate = Lit;
 	else if (isStaticFlagSet(Static::Container)) {
-		if ((getDoorState() == Static::Closed) && (_roomdesc[Closed].first.size() > 0))
+		if ((getDoorState() == Static::Closed) && ((*_roomdesc)[Closed].first.size() > 0))
 			_dstate = Closed;
-      if ((getDoorState() == Static::Open) && (_roomdesc[Open].first.size() > 0))
+      if ((getDoorState() == Static::Open) && ((*_roomdesc)[Open].first.size() > 0))
          _dstate = Open;
 	}
 	else if (isStaticFlagSet(Static::Extinguish) && (!isStaticFlagSet(Static::Lit)) &&
-				(_roomdesc[Extinguished].first.size() != 0))
+				((*_roomdesc)[Extinguished].first.size() != 0))
 		_dstate = Extinguished;
 
 	// Default, other than custom
-	else if (_roomdesc[Dropped].first.size() > 0)
+	else if ((*_roomdesc)[Dropped].first.size() > 0)
 		_dstate = Dropped;
 	
 	// If it never found a valid setting
 	if (_dstate == Custom) {
 		// If there is no custom roomdesc
-		if (_roomdesc.size() == Custom) {
+		if (_roomdesc->size() == Custom) {
 			errmsg << "Getable '" << getID() << "' must have at least one roomdesc defined.";
 			mudlog->writeLog(errmsg.str().c_str());
 			return 0;
@@ -222,6 +227,8 @@ bool Getable::isFlagSetInternal(const char *flagname, bool &results) {
  *********************************************************************************************/
 
 void Getable::setRoomDesc(descstates new_state, const char *new_desc, const char *customname) {
+	std::vector<std::pair<std::string, std::string>> &roomdesc = writableCopy(_roomdesc);
+
 	if (new_state == Custom) {
 		if (customname == NULL)
 			throw std::invalid_argument("Attempt to set Custom roomDesc but no customname is set");
@@ -229,19 +236,19 @@ void Getable::setRoomDesc(descstates new_state, const char *new_desc, const char
 		std::string cname(customname);
 
 		// First see if it already exists
-		for (unsigned int i=Custom; i<_roomdesc.size(); i++) {
-			if (cname.compare(_roomdesc[i].second.c_str()) == 0) {
-				_roomdesc[i].first = new_desc;
+		for (unsigned int i=Custom; i<roomdesc.size(); i++) {
+			if (cname.compare(roomdesc[i].second.c_str()) == 0) {
+				roomdesc[i].first = new_desc;
 				return;
 			}			
 		}
 
 		// It wasn't found, add it
-		_roomdesc.push_back(std::pair<std::string, std::string>(new_desc, customname));
+		roomdesc.push_back(std::pair<std::string, std::string>(new_desc, customname));
 		return;
 	}
 
-	_roomdesc[new_state].first = new_desc;
+	roomdesc[new_state].first = new_desc;
 }
 
 /*********************************************************************************************
@@ -262,24 +269,50 @@ bool Getable::changeRoomDesc(descstates new_state, const char *customname) {
 	if (new_state == Custom) {
 		cname = customname;
 		unsigned int i;
-		for (i=Custom-1; i<_roomdesc.size(); i++) {
-			if (cname.compare(_roomdesc[i].second.c_str()) == 0) {
+		for (i=Custom-1; i<_roomdesc->size(); i++) {
+			if (cname.compare((*_roomdesc)[i].second.c_str()) == 0) {
 				_dstate = i;
+				renderChanged();
+				stateChanged();
 				return true;
 			}
 		}
-		if (i == _roomdesc.size())
+		if (i == _roomdesc->size())
 			return false;
    }
 
 	// It's not custom, see if it is empty
-	if (_roomdesc[new_state].first.size() == 0)
+	if ((*_roomdesc)[new_state].first.size() == 0)
 		return false;
 	_dstate = new_state;
+	renderChanged();
+	stateChanged();
 
 	return true;
 }
 
+/*********************************************************************************************
+ * saveState/loadState - adds which room description is showing to what world checkpoints keep
+ *
+ *********************************************************************************************/
+
+void Getable::saveState(RecordWriter &rec) const {
+	Static::saveState(rec);
+	rec.putVarint(_dstate);
+}
+
+void Getable::loadState(RecordReader &rec, EntityDB &edb) {
+	Static::loadState(rec, edb);
+
+	uint64_t dstate = rec.getVarint();
+	if (dstate >= _roomdesc->size())
+		throw record_error("room description out of range");
+	if (_dstate != (unsigned int) dstate) {
+		_dstate = (unsigned int) dstate;
+		renderChanged();
+	}
+}
+
 /*********************************************************************************************
  * getRoomDesc - gets the currently active roomdesc
  *
@@ -287,7 +320,7 @@ bool Getable::changeRoomDesc(descstates new_state, const char *customname) {
  *********************************************************************************************/
 
 const char *Getable::getRoomDesc() {
-	return _roomdesc[_dstate].first.c_str();
+	return (*_roomdesc)[_dstate].first.c_str();
 }
 
 /*********************************************************************************************
@@ -0,0 +1,133 @@
+#include "Histogram.h"
+
+// Sub-buckets per power of two are 2^sub_bits. Values below 2^max_bits are tracked
+// separately, anything from there up lands in the last bucket (max is still exact).
+const unsigned int sub_bits = 5;
+const unsigned int sub_count = 1 << sub_bits;
+const unsigned int max_bits = 40;
+const unsigned int num_buckets = (max_bits - sub_bits + 1) * sub_count;
+
+Histogram::Histogram():
+							_buckets(num_buckets, 0)
+{
+
+}
+
+Histogram::Histogram(const Histogram &copy_from):
+							_buckets(copy_from._buckets),
+							_count(copy_from._count),
+							_total(copy_from._total),
+							_max(copy_from._max)
+{
+
+}
+
+Histogram::~Histogram() {
+
+}
+
+Histogram &Histogram::operator = (const Histogram &copy_from) {
+	_buckets = copy_from._buckets;
+	_count = copy_from._count;
+	_total = copy_from._total;
+	_max = copy_from._max;
+	return *this;
+}
+
+/*********************************************************************************************
+ * getBucket - finds the bucket a value belongs in. Small values get a bucket each, larger ones
+ *				   share buckets that widen with each power of two.
+ *
+ *********************************************************************************************/
+
+unsigned int Histogram::getBucket(uint64_t value) {
+	if (value < 2 * sub_count)
+		return (unsigned int) value;
+
+	unsigned int msb = 63 - (unsigned int) __builtin_clzll(value);
+	if (msb >= max_bits)
+		return num_buckets - 1;
+
+	unsigned int shift = msb - sub_bits;
+	return (shift + 1) * sub_count + (unsigned int) (value >> shift) - sub_count;
+}
+
+/*********************************************************************************************
+ * getBucketValue - the smallest value that falls into the given bucket
+ *
+ *********************************************************************************************/
+
+uint64_t Histogram::getBucketValue(unsigned int bucket) {
+	if (bucket < 2 * sub_count)
+		return bucket;
+
+	unsigned int shift = (bucket / sub_count) - 1;
+	return ((uint64_t) (bucket % sub_count) + sub_count) << shift;
+}
+
+/*********************************************************************************************
+ * record - adds a value to the histogram
+ *
+ *********************************************************************************************/
+
+void Histogram::record(uint64_t value) {
+	_buckets[getBucket(value)]++;
+	_count++;
+	_total += value;
+	if (value > _max)
+		_max = value;
+}
+
+/*********************************************************************************************
+ * merge - adds all the values recorded in another histogram to this one
+ *
+ *********************************************************************************************/
+
+void Histogram::merge(const Histogram &other) {
+	for (unsigned int i=0; i<_buckets.size(); i++)
+		_buckets[i] += other._buckets[i];
+	_count += other._count;
+	_total += other._total;
+	if (other._max > _max)
+		_max = other._max;
+}
+
+/*********************************************************************************************
+ * reset - clears all recorded values
+ *
+ *********************************************************************************************/
+
+void Histogram::reset() {
+	_buckets.assign(num_buckets, 0);
+	_count = 0;
+	_total = 0;
+	_max = 0;
+}
+
+/*********************************************************************************************
+ * getPercentile - walks the buckets until pct percent of the values have been passed
+ *
+ *    Params:  pct - percentile between 0 and 100
+ *
+ *		Returns: the bottom of the bucket the percentile falls in, capped at the max recorded
+ *
+ *********************************************************************************************/
+
+uint64_t Histogram::getPercentile(double pct) const {
+	if (_count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t) ((pct / 100.0) * (double) _count);
+	if (target >= _count)
+		return _max;
+
+	uint64_t seen = 0;
+	for (unsigned int i=0; i<_buckets.size(); i++) {
+		seen += _buckets[i];
+		if (seen > target) {
+			uint64_t value = getBucketValue(i);
+			return (value > _max) ? _max : value;
+		}
+	}
+	return _max;
+}
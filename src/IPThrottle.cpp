@@ -0,0 +1,101 @@
+#include "IPThrottle.h"
+
+IPThrottle::IPThrottle():
+								_addrs()
+{
+
+}
+
+// Buckets are not copied, the copy starts everyone fresh
+IPThrottle::IPThrottle(const IPThrottle &copy_from):
+								_rate(copy_from._rate),
+								_burst(copy_from._burst),
+								_max_addrs(copy_from._max_addrs),
+								_addrs()
+{
+
+}
+
+IPThrottle::~IPThrottle() {
+
+}
+
+/*********************************************************************************************
+ * configure - sets the limits for each address and forgets any addresses seen so far
+ *
+ *    Params:  rate - tokens added per second. 0 turns the limiting off
+ *             burst - the most tokens an address can save up
+ *					max_addrs - most addresses to track at once
+ *
+ *********************************************************************************************/
+
+void IPThrottle::configure(float rate, float burst, size_t max_addrs) {
+	std::lock_guard<std::mutex> guard(_throttle_mutex);
+	_rate = rate;
+	_burst = burst;
+	_max_addrs = max_addrs;
+	_addrs.clear();
+}
+
+/*********************************************************************************************
+ * allow - tops up the address's bucket and spends from it
+ *
+ *    Params:  ipaddr - the address (any consistent format, network order is used elsewhere)
+ *             cost - tokens to spend
+ *
+ *    Returns: true if the address had tokens to spend, false if it is over its limit
+ *
+ *********************************************************************************************/
+
+bool IPThrottle::allow(unsigned long ipaddr, float cost) {
+	std::lock_guard<std::mutex> guard(_throttle_mutex);
+
+	if (_rate <= 0.0)
+		return true;
+
+	time_t now = time(NULL);
+	if ((now - _last_prune >= 60) || ((_addrs.size() >= _max_addrs) && (now != _last_prune)))
+		prune(now);
+
+	auto addr_it = _addrs.find(ipaddr);
+	if (addr_it == _addrs.end()) {
+		// Everyone is active and the table is full. Turning new addresses away is safer than
+		// letting the table grow
+		if (_addrs.size() >= _max_addrs)
+			return false;
+
+		addr_it = _addrs.emplace(ipaddr, ip_entry{TokenBucket(_rate, _burst), now}).first;
+	}
+
+	ip_entry &entry = addr_it->second;
+	entry.last_seen = now;
+	if (!entry.bucket.available())
+		return false;
+
+	entry.bucket.spend(cost);
+	return true;
+}
+
+/*********************************************************************************************
+ * prune - forgets addresses that have been quiet long enough to have refilled their bucket,
+ *			  since a new entry starts out full anyway
+ *
+ *********************************************************************************************/
+
+void IPThrottle::prune(time_t now) {
+	_last_prune = now;
+
+	time_t refill_secs = (time_t) (_burst / _rate) + 1;
+	auto addr_it = _addrs.begin();
+	while (addr_it != _addrs.end()) {
+		if (now - addr_it->second.last_seen > refill_secs)
+			addr_it = _addrs.erase(addr_it);
+		else
+			addr_it++;
+	}
+}
+
+size_t IPThrottle::getNumAddrs() {
+	std::lock_guard<std::mutex> guard(_throttle_mutex);
+	return _addrs.size();
+}
@@ -3,11 +3,15 @@
 #include <memory>
 #include "Location.h"
 #include "Player.h"
+#include "Broadcast.h"
 #include "Getable.h"
 #include "MUD.h"
 #include "misc.h"
 #include "global.h"
 #include "Door.h"
+#include "NPC.h"
+
+unsigned int Location::_title_gen = 0;
 
 const char *lflag_list[] = {"outdoors", "bright", "death", "realtime", "nomobiles", "dark", "nosummon", "private", 
 									 "oneperson", "noteleport", "peaceful", "maze", "soundproof", NULL};
@@ -172,10 +176,14 @@ int Location::loadData(pugi::xml_node &entnode) {
 
 void Location::setDesc(const char *newdesc) {
 	_desc = newdesc;
+	invalidateRender(RenderHeader);
 }
 
+// Neighbours show this title in their exits, so their cached exits are stale too
 void Location::setTitle(const char *newtitle) {
    _title = newtitle;
+	invalidateRender(RenderHeader);
+	_title_gen++;
 }
 
 /*********************************************************************************************
@@ -325,6 +333,36 @@ void Location::addLinks(EntityDB &edb, std::shared_ptr<Physical> self) {
 }
 
 
+/*********************************************************************************************
+ * getMobileExits - lists the exits an NPC may take on its own: not hidden or special, not
+ *						  through a closed door and not into a location flagged Death or NoMobiles
+ *
+ *		Params:	exits - gets the direction and destination of each such exit
+ *
+ *********************************************************************************************/
+
+void Location::getMobileExits(std::vector<std::pair<std::string, std::shared_ptr<Location>>> &exits) {
+	for (unsigned int i=0; i<_exits.size(); i++) {
+		if (_exits[i].eflags[(size_t) Hidden] || _exits[i].eflags[(size_t) Special])
+			continue;
+
+		// Through a door only if it's open
+		std::shared_ptr<Physical> locptr = _exits[i].link_loc;
+		std::shared_ptr<Door> doorptr = std::dynamic_pointer_cast<Door>(locptr);
+		if (doorptr != nullptr) {
+			if (doorptr->getDoorState() != Static::Open)
+				continue;
+			locptr = doorptr->getOppositeLoc(this);
+		}
+
+		std::shared_ptr<Location> dest = std::dynamic_pointer_cast<Location>(locptr);
+		if ((dest == nullptr) || dest->isLocFlagSet(Death) || dest->isLocFlagSet(NoMobiles))
+			continue;
+
+		exits.push_back(std::pair<std::string, std::shared_ptr<Location>>(_exits[i].dir, dest));
+	}
+}
+
 /*********************************************************************************************
  * getExitsStr - Formats a display string of the exits that can be sent to the player
  *
@@ -387,17 +425,27 @@ const char *Location::getExitsStr(std::string &buf) {
 
 
 /*********************************************************************************************
- * listContents - preps a string with a list of visible getables and organisms first
- *
+ * listContents - preps a string with a list of visible getables and organisms first. NPCs
+ *					  are listed before players, rather than in the order they arrived
  *
  *********************************************************************************************/
 
 const char *Location::listContents(std::string &buf, const Physical *exclude) const {
-	auto cit = _contained.begin();
+	listObjects(buf);
+	return listPlayers(buf, exclude);
+}
+
+/*********************************************************************************************
+ * listObjects - appends the doors, getables and NPCs to buf. This is the part of the contents
+ *					  list that looks the same to every viewer, so it can be cached.
+ *
+ *********************************************************************************************/
+
+const char *Location::listObjects(std::string &buf) const {
 
 	// Show doors first
-	for ( ; cit != _contained.end(); cit++) {
-		std::shared_ptr<Door> dptr = std::dynamic_pointer_cast<Door>(*cit);
+	for (unsigned int i=0; i<_statics.size(); i++) {
+		std::shared_ptr<Door> dptr = std::dynamic_pointer_cast<Door>(_statics[i]);
 		if (dptr == nullptr)
 			continue;
 
@@ -410,55 +458,230 @@ const char *Location::listContents(std::string &buf, const Physical *exclude) co
 	}	
 
 	// Show getables
-	for (cit = _contained.begin(); cit != _contained.end(); cit++) {
-      std::shared_ptr<Getable> gptr = std::dynamic_pointer_cast<Getable>(*cit);
-
-      if (gptr == nullptr)
-         continue;
-	
-		buf += gptr->getRoomDesc();
+	for (unsigned int i=0; i<_getables.size(); i++) {
+		buf += _getables[i]->getRoomDesc();
 		buf += "\n";	
 	}
 
    // Show organisms next
-   for (cit = _contained.begin(); cit != _contained.end(); cit++) {
-      std::shared_ptr<Organism> optr = std::dynamic_pointer_cast<Organism>(*cit);
-		if (optr == nullptr)
-			continue;
+	std::string reviewstr;
+	for (unsigned int i=0; i<_npcs.size(); i++) {
+		buf += _npcs[i]->getReviewProcessed(Organism::Standing, reviewstr);
+		buf += "\n";
+	}
+	return buf.c_str();
+}
 
+/*********************************************************************************************
+ * listPlayers - appends the players in the room to buf, skipping the one who is looking
+ *
+ *********************************************************************************************/
+
+const char *Location::listPlayers(std::string &buf, const Physical *exclude) const {
+	std::string reviewstr;
+   for (unsigned int i=0; i<_players.size(); i++) {
 		// Skip players on the exclude list
-		std::shared_ptr<Player> pptr = std::dynamic_pointer_cast<Player>(optr);
-      if ((pptr != nullptr) && (*pptr == exclude))
+      if (*_players[i] == exclude)
          continue;
 
-		std::string reviewstr;
-		buf += optr->getReviewProcessed(Organism::Standing, reviewstr);
+		buf += _players[i]->getReviewProcessed(Organism::Standing, reviewstr);
 		buf += "\n";
    }
 	return buf.c_str();
 }
 
 /*********************************************************************************************
- * sendMsg - sends a message to all organisms in this room
+ * sendMsg - sends a message to all organisms in this room. The message is wrapped in a
+ *				 Broadcast so it is only formatted once for everyone sharing an output profile
  *
  *
  *********************************************************************************************/
 
 void Location::sendMsg(const char *msg, std::shared_ptr<Physical> exclude, std::shared_ptr<Physical> exclude2) {
-   std::string unformatted = msg;
-   sendMsg(unformatted, exclude, exclude2);
+	Broadcast bcast(msg);
+	sendBroadcast(bcast, exclude, exclude2);
 }
 
 void Location::sendMsg(std::string &msg, std::shared_ptr<Physical> exclude, std::shared_ptr<Physical> exclude2) {
-	
-	auto cit = _contained.begin();
-	for ( ; cit != _contained.end(); cit++) {
-		// Compare against exclude - comparing shared pointers wasn't working
-		if ((*cit != exclude) && (*cit != exclude2))
-			(*cit)->sendMsg(msg);
+	Broadcast bcast(msg);
+	sendBroadcast(bcast, exclude, exclude2);
+}
+
+void Location::sendBroadcast(Broadcast &bcast, std::shared_ptr<Physical> exclude, 
+																			std::shared_ptr<Physical> exclude2) {
+	// Only players do anything with messages
+	for (unsigned int i=0; i<_players.size(); i++) {
+		if ((_players[i] != exclude) && (_players[i] != exclude2))
+			_players[i]->sendBroadcast(bcast);
 	}	
 }
 
+/*********************************************************************************************
+ * addPhysical/removePhysical - adds or removes the physical from the container, also updating
+ *					the typed index (players, NPCs, getables, statics) it belongs in
+ *
+ *    Returns: same as the Physical versions
+ *
+ *********************************************************************************************/
+
+bool Location::addPhysical(std::shared_ptr<Physical> new_phys) {
+	if (!Physical::addPhysical(new_phys))
+		return false;
+
+	std::shared_ptr<Player> pptr;
+	std::shared_ptr<NPC> nptr;
+	std::shared_ptr<Getable> gptr;
+	std::shared_ptr<Static> sptr;
+
+	// Players are listed per viewer, so only the other kinds dirty the contents block
+	if ((pptr = std::dynamic_pointer_cast<Player>(new_phys)) != nullptr) {
+		_players.push_back(pptr);
+		return true;
+	} else if ((nptr = std::dynamic_pointer_cast<NPC>(new_phys)) != nullptr)
+		_npcs.push_back(nptr);
+	else if ((gptr = std::dynamic_pointer_cast<Getable>(new_phys)) != nullptr)
+		_getables.push_back(gptr);
+	else if ((sptr = std::dynamic_pointer_cast<Static>(new_phys)) != nullptr)
+		_statics.push_back(sptr);
+
+	invalidateRender(RenderContents);
+	return true;
+}
+
+// Removes an entry from one of the typed indexes, returning true if it was found
+template <typename T>
+static bool eraseFromIndex(std::vector<std::shared_ptr<T>> &index, std::shared_ptr<Physical> phys_ptr) {
+	for (unsigned int i=0; i<index.size(); i++) {
+		if (index[i] == phys_ptr) {
+			index.erase(index.begin() + i);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Location::removePhysical(std::shared_ptr<Physical> phys_ptr) {
+	if (!Physical::removePhysical(phys_ptr))
+		return false;
+
+	if (eraseFromIndex(_players, phys_ptr))
+		return true;
+
+	if (!eraseFromIndex(_npcs, phys_ptr) && !eraseFromIndex(_getables, phys_ptr))
+		eraseFromIndex(_statics, phys_ptr);
+	invalidateRender(RenderContents);
+	return true;
+}
+
+/*********************************************************************************************
+ * purgePhysical - Removes all references to the parameter from this location and its indexes
+ *
+ *    Returns: number of references to this object cleared
+ *
+ *********************************************************************************************/
+
+size_t Location::purgePhysical(std::shared_ptr<Physical> item) {
+	size_t count = Physical::purgePhysical(item);
+	if (count == 0)
+		return 0;
+
+	while (eraseFromIndex(_players, item) || eraseFromIndex(_npcs, item) || 
+			 eraseFromIndex(_getables, item) || eraseFromIndex(_statics, item));
+	invalidateRender(RenderContents);
+	return count;
+}
+
+/*********************************************************************************************
+ * getHeaderRender/getExitsRender/getContentsRender - return the cached text of one block of
+ *					the room description, rebuilding it first if it was invalidated. The returned
+ *					Broadcast also caches its telnet formatting per color/wrap profile, so a busy
+ *					room is formatted once per change rather than once per look.
+ *
+ *		Returns: reference to the cached Broadcast, valid until the block is next invalidated
+ *
+ *********************************************************************************************/
+
+Broadcast &Location::getHeaderRender() {
+	if (_header_render == nullptr) {
+		std::string buf("\n");
+		buf += _title;
+		buf += "\n";
+		buf += _desc;
+		_header_render.reset(new Broadcast(buf));
+	}
+	return *_header_render;
+}
+
+Broadcast &Location::getExitsRender() {
+	if ((_exits_render == nullptr) || (_exits_title_gen != _title_gen)) {
+		std::string buf;
+		getExitsStr(buf);
+		_exits_render.reset(new Broadcast(buf));
+		_exits_title_gen = _title_gen;
+	}
+	return *_exits_render;
+}
+
+Broadcast &Location::getContentsRender() {
+	if (_contents_render == nullptr) {
+		std::string buf;
+		listObjects(buf);
+		_contents_render.reset(new Broadcast(buf));
+	}
+	return *_contents_render;
+}
+
+/*********************************************************************************************
+ * invalidateRender - marks cached blocks of the room description dirty. Called when the
+ *					contents, exits, door states or lighting in this room change.
+ *
+ *    Params:  blocks - mask of renderblocks values to drop
+ *
+ *********************************************************************************************/
+
+void Location::invalidateRender(unsigned int blocks) {
+	if (blocks & RenderHeader)
+		_header_render.reset();
+	if (blocks & RenderExits)
+		_exits_render.reset();
+	if (blocks & RenderContents)
+		_contents_render.reset();
+}
+
+/*********************************************************************************************
+ * getOrganismByName - same matching rules as getContainedByName, but only looks at the
+ *					players and NPCs in this location
+ *
+ *    Returns: shared_ptr if found, nullptr if not
+ *
+ *********************************************************************************************/
+
+std::shared_ptr<Organism> Location::getOrganismByName(const char *name, bool allow_abbrev) {
+	std::string namebuf = name;
+
+	for (unsigned int i=0; i<_npcs.size(); i++) {
+		if (_npcs[i]->matchesGameName(namebuf, allow_abbrev))
+			return _npcs[i];
+	}
+
+	for (unsigned int i=0; i<_players.size(); i++) {
+		if (_players[i]->matchesGameName(namebuf, allow_abbrev))
+			return _players[i];
+	}
+
+	// Search by altnames next
+	for (unsigned int i=0; i<_npcs.size(); i++) {
+		if (_npcs[i]->hasAltName(name, allow_abbrev))
+			return _npcs[i];
+	}
+
+	for (unsigned int i=0; i<_players.size(); i++) {
+		if (_players[i]->hasAltName(name, allow_abbrev))
+			return _players[i];
+	}
+	return nullptr;
+}
+
 
 /*********************************************************************************************
  * getOppositeDir - Given an exit enum, returns the opposing direction
@@ -497,6 +720,7 @@ bool Location::setExit(const char *exitname, std::shared_ptr<Physical> new_exit)
    }
 
    _exits.push_back(new_le);
+	invalidateRender(RenderExits);
 	return true;
 }
 
@@ -510,6 +734,7 @@ bool Location::clrExit(const char *exitname) {
 	for (unsigned int i=0; i<_exits.size(); i++) {
 		if (_exits[i].dir.compare(exitname) == 0) {
 			_exits.erase(_exits.begin() + i);
+			invalidateRender(RenderExits);
 			return true;
 		}
 	}
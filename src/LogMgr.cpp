@@ -2,6 +2,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <ostream>
 #include <string>
 #include <string.h>
@@ -13,7 +14,13 @@
 LogMgr::LogMgr():
 				_log_file(""),
 				_log_lvl(1),
-				_lfptr(NULL)
+				_lfptr(NULL),
+				_head(0),
+				_async(false),
+				_pushing(0),
+				_dropped(0),
+				_exit_writer(false),
+				_flush_interval(1000)
 {
 }
 				
@@ -22,7 +29,13 @@ LogMgr::LogMgr():
 LogMgr::LogMgr(const char *log_file, unsigned int log_lvl):
 											_log_file(log_file),
 											_log_lvl(log_lvl),
-											_lfptr(NULL)
+											_lfptr(NULL),
+											_head(0),
+											_async(false),
+											_pushing(0),
+											_dropped(0),
+											_exit_writer(false),
+											_flush_interval(1000)
 {
 
 }
@@ -35,7 +48,13 @@ LogMgr::~LogMgr() {
 LogMgr::LogMgr(const LogMgr &copy_from):
 										_log_file(copy_from._log_file),
 										_log_lvl(copy_from._log_lvl),
-										_lfptr(NULL)
+										_lfptr(NULL),
+										_head(0),
+										_async(false),
+										_pushing(0),
+										_dropped(0),
+										_exit_writer(false),
+										_flush_interval(copy_from._flush_interval)
 {
 }
 
@@ -51,20 +70,36 @@ LogMgr &LogMgr::operator = (const LogMgr &copy_from) {
  * createTimeStamp - creates a time stamp string and places it in buf
  ***************************************************************************************************/
 void LogMgr::createTimestamp(std::string &buf) {
-   // Put together our timestamp and start the log with the stamp
-   std::string logstr;
+	buf.clear();
+	appendTimestamp(buf);
+}
+
+/***************************************************************************************************
+ * appendTimestamp - adds the time stamp to buf. The string is only rebuilt when the second changes,
+ *						   with a cached copy per thread so no locking is needed.
+ ***************************************************************************************************/
+void LogMgr::appendTimestamp(std::string &buf) {
+	thread_local time_t cached_time = 0;
+	thread_local char cached_str[27] = "";
+
    time_t curtime = time(NULL);
-   char timestr[27];
-   if (ctime_r(&curtime, timestr) == NULL)
-      throw std::runtime_error("ctime_r function failed unexpectedly");
+	if (curtime != cached_time) {
+		if (ctime_r(&curtime, cached_str) == NULL)
+			throw std::runtime_error("ctime_r function failed unexpectedly");
 
-   buf = timestr;
-   clrNewlines(buf);
+		// ctime_r ends the string with a newline
+		char *newline = strchr(cached_str, '\n');
+		if (newline != NULL)
+			*newline = '\0';
+		cached_time = curtime;
+	}
 
+	buf += cached_str;
 }
 
 /***************************************************************************************************
- * writeLog - Writes a string to a log with the timestamp
+ * writeLog - Writes a string to a log with the timestamp. The entry is formatted here, then either
+ *				  handed to the writer thread or, if it isn't running, written directly.
  *
  *    Params:  str - string to write to the log in const char * or std::string format
  *             lvl - the "importance" of this log - can be used to set verbosity
@@ -76,25 +111,29 @@ void LogMgr::writeLog(const char *str, unsigned int lvl) {
    if (lvl > _log_lvl)
       return;
 
-   // If the file is not open yet, open it
-   if (_lfptr == NULL) {
-      if ((_lfptr = fopen(_log_file.c_str(), "a+")) == NULL) {
-			throw logfile_error("Unable to open log file to append.");
-      }
-   }
-
    // Put together our timestamp and start the log with the stamp
    std::string logstr;
-   createTimestamp(logstr);
+	logstr.reserve(strlen(str) + 32);
+   appendTimestamp(logstr);
 
    // Now add on the text to log
    logstr += " ";
    logstr += str;
    logstr += "\n";
 
-   fputs(logstr.c_str(), _lfptr);
-   fflush(_lfptr);
+	// _pushing lets stopWriter wait out producers that saw the writer running
+	if (_async) {
+		_pushing++;
+		if (_async) {
+			if (!pushRecord(logstr))
+				_dropped++;
+			_pushing--;
+			return;
+		}
+		_pushing--;
+	}
 
+	writeSync(logstr);
 }
 
 void LogMgr::writeLog(std::string &str, unsigned int lvl) {
@@ -120,8 +159,203 @@ void LogMgr::strerrLog(const char *str, unsigned int lvl) {
    return writeLog(logstr.c_str(), lvl);
 }
 
+/***************************************************************************************************
+ * openLog - opens the log file for appending if it isn't open yet
+ *
+ *		Throws:	logfile_error if the file could not be opened
+ ***************************************************************************************************/
+
+void LogMgr::openLog() {
+   if (_lfptr == NULL) {
+      if ((_lfptr = fopen(_log_file.c_str(), "a+")) == NULL) {
+			throw logfile_error("Unable to open log file to append.");
+      }
+   }
+}
+
+/***************************************************************************************************
+ * writeSync - writes a formatted record straight to the file, for when the writer is not running
+ ***************************************************************************************************/
+
+void LogMgr::writeSync(const std::string &record) {
+	std::lock_guard<std::mutex> guard(_sync_mutex);
+
+	openLog();
+   fputs(record.c_str(), _lfptr);
+   fflush(_lfptr);
+}
+
+/***************************************************************************************************
+ * pushRecord - places a record on the ring. Producers claim a slot by advancing _head, then
+ *					 publish it by bumping the slot's sequence so the writer knows it is filled.
+ *
+ *		Params:	record - the formatted record. Its contents are swapped into the ring.
+ *
+ *		Returns: true if queued, false if the ring is full
+ ***************************************************************************************************/
+
+bool LogMgr::pushRecord(std::string &record) {
+	size_t pos = _head.load(std::memory_order_relaxed);
+
+	while (true) {
+		logslot &slot = _ring[pos & _ring_mask];
+		size_t seq = slot.seq.load(std::memory_order_acquire);
+		long diff = (long) seq - (long) pos;
+
+		// The slot is free for this position, try to claim it
+		if (diff == 0) {
+			if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.record.swap(record);
+				slot.seq.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		// The writer hasn't gotten to this slot from the last time around
+		else if (diff < 0)
+			return false;
+
+		// Another thread beat us to it
+		else
+			pos = _head.load(std::memory_order_relaxed);
+	}
+}
+
+/***************************************************************************************************
+ * popRecord - takes the next published record off the ring (writer thread only)
+ *
+ *		Params:	batch - the record is appended to this buffer
+ *
+ *		Returns: true if a record was read, false if the next slot isn't published yet
+ ***************************************************************************************************/
+
+bool LogMgr::popRecord(std::string &batch) {
+	logslot &slot = _ring[_tail & _ring_mask];
+	if (slot.seq.load(std::memory_order_acquire) != _tail + 1)
+		return false;
+
+	batch += slot.record;
+	slot.record.clear();
+
+	// Free the slot for the producer that comes around the ring next
+	slot.seq.store(_tail + _ring_mask + 1, std::memory_order_release);
+	_tail++;
+	return true;
+}
+
+/***************************************************************************************************
+ * startWriter - sets up the ring and launches the background writer thread
+ *
+ *		Params:	ring_size - number of records the ring holds (rounded up to a power of two)
+ *					flush_ms - the longest a record waits in the writer before being written
+ *					flush_bytes - write early once this much has built up
+ *
+ *		Throws:	logfile_error if the file could not be opened
+ *					runtime_error if the writer is already running
+ ***************************************************************************************************/
+
+void LogMgr::startWriter(size_t ring_size, unsigned int flush_ms, size_t flush_bytes) {
+	if (_writer_thread != nullptr)
+		throw std::runtime_error("LogMgr::startWriter - the log writer is already running");
+
+	{
+		std::lock_guard<std::mutex> guard(_sync_mutex);
+		openLog();
+	}
+
+	size_t size = 2;
+	while (size < ring_size)
+		size <<= 1;
+
+	_ring.reset(new logslot[size]);
+	for (size_t i=0; i<size; i++)
+		_ring[i].seq.store(i, std::memory_order_relaxed);
+	_ring_mask = size - 1;
+	_head.store(0);
+	_tail = 0;
+
+	_flush_interval = std::chrono::milliseconds(flush_ms);
+	_flush_bytes = flush_bytes;
+	_exit_writer = false;
+
+	_writer_thread = std::unique_ptr<std::thread>(new std::thread([this](){ runWriter(); }));
+	_async = true;
+}
+
+/***************************************************************************************************
+ * stopWriter - switches back to direct writes, waits for any producer still pushing to publish its
+ *				    record, then lets the writer drain the ring and waits for it
+ ***************************************************************************************************/
+
+void LogMgr::stopWriter() {
+	if (_writer_thread == nullptr)
+		return;
+
+	_async = false;
+	while (_pushing > 0)
+		std::this_thread::yield();
+
+	// Every claimed slot is published now, so the writer's last pass gets them all
+	_exit_writer = true;
+	_writer_thread->join();
+	_writer_thread.reset();
+
+	std::string batch;
+	while (_tail != _head.load(std::memory_order_acquire)) {
+		if (!popRecord(batch))
+			std::this_thread::yield();
+	}
+	if (batch.size() > 0)
+		writeSync(batch);
+}
+
+/***************************************************************************************************
+ * runWriter - the writer thread. Drains the ring into a batch and writes it out when it is big
+ *				   enough or old enough. Lost records are reported in the log itself.
+ ***************************************************************************************************/
+
+void LogMgr::runWriter() {
+	std::string batch;
+	auto last_flush = std::chrono::steady_clock::now();
+
+	while (true) {
+		bool exiting = _exit_writer;
+
+		size_t before = batch.size();
+		while (popRecord(batch));
+		bool got_records = (batch.size() > before);
+
+		unsigned long dropped = _dropped.exchange(0);
+		if (dropped > 0) {
+			_total_dropped += dropped;
+			appendTimestamp(batch);
+			batch += " LogMgr: log ring was full, dropped ";
+			batch += std::to_string(dropped);
+			batch += " records\n";
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if ((batch.size() > 0) && (exiting || (batch.size() >= _flush_bytes) || 
+														(now - last_flush >= _flush_interval))) {
+			fwrite(batch.data(), 1, batch.size(), _lfptr);
+			fflush(_lfptr);
+			batch.clear();
+			last_flush = now;
+		}
+
+		if (exiting)
+			return;
+
+		// Nothing came in, give the producers some time
+		if (!got_records)
+			usleep(5000);
+	}
+}
+
 // self-explanatory
 void LogMgr::closeLog() {
+	stopWriter();
+
+	std::lock_guard<std::mutex> guard(_sync_mutex);
    if (_lfptr != NULL) {
       fclose(_lfptr);
       _lfptr = NULL;
@@ -0,0 +1,566 @@
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/file.h>
+#include "LogStore.h"
+#include "FileStore.h"
+#include "misc.h"
+#include "global.h"
+
+// File header: identifies the file and the entry format version
+const char *logstore_magic = "AKVL";
+const uint32_t logstore_version = 1;
+const size_t logstore_header_len = 8;
+
+namespace {
+
+/*********************************************************************************************
+ * crc32 - the standard (zlib) CRC-32, table driven
+ *
+ *********************************************************************************************/
+
+uint32_t crc32(const char *data, size_t len) {
+	static const std::vector<uint32_t> table = [](){
+		std::vector<uint32_t> t(256);
+		for (uint32_t i=0; i<256; i++) {
+			uint32_t c = i;
+			for (unsigned int k=0; k<8; k++)
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i=0; i<len; i++)
+		crc = table[(crc ^ (uint8_t) data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+void putLE(std::string &buf, uint64_t value, unsigned int bytes) {
+	for (unsigned int i=0; i<bytes; i++)
+		buf += (char) ((value >> (i * 8)) & 0xFF);
+}
+
+uint64_t getLE(const char *data, unsigned int bytes) {
+	uint64_t value = 0;
+	for (unsigned int i=0; i<bytes; i++)
+		value |= (uint64_t) (uint8_t) data[i] << (i * 8);
+	return value;
+}
+
+}
+
+LogStore::LogStore(const char *dbfile, PlayerStore *fallback):
+						PlayerStore(),
+						_dbfile(dbfile),
+						_fallback(fallback),
+						_index()
+{
+
+}
+
+LogStore::~LogStore() {
+	close();
+}
+
+/*********************************************************************************************
+ * open - opens (or creates) the store file, locks it against other servers and replays it
+ *		    into the index
+ *
+ *		Returns: false (logged) if the file can't be opened, is locked or isn't a store
+ *
+ *********************************************************************************************/
+
+bool LogStore::open() {
+	std::lock_guard<std::mutex> lock(_store_mutex);
+	std::stringstream msg;
+
+	_fd = ::open(_dbfile.c_str(), O_RDWR | O_CREAT, 0644);
+	if (_fd < 0) {
+		msg << "Unable to open " << _what << " '" << _dbfile << "': " << strerror(errno);
+		mudlog->writeLog(msg.str().c_str());
+		return false;
+	}
+
+	if (flock(_fd, LOCK_EX | LOCK_NB) != 0) {
+		msg << "The " << _what << " '" << _dbfile << "' is in use by another process.";
+		mudlog->writeLog(msg.str().c_str());
+		::close(_fd);
+		_fd = -1;
+		return false;
+	}
+
+	if (!replay()) {
+		::close(_fd);
+		_fd = -1;
+		return false;
+	}
+
+	if ((_fallback != nullptr) && (!_fallback->open())) {
+		mudlog->writeLog("Player store fallback could not be opened, players will only be read from the log.");
+		_fallback.reset();
+	}
+
+	msg << "Opened " << _what << " '" << _dbfile << "': " << _index.size() << " records, " << _file_size <<
+																										" bytes.";
+	mudlog->writeLog(msg.str().c_str(), 2);
+	return true;
+}
+
+void LogStore::close() {
+	std::lock_guard<std::mutex> lock(_store_mutex);
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+}
+
+/*********************************************************************************************
+ * encodeEntry - appends an entry to buf
+ *
+ *********************************************************************************************/
+
+void LogStore::encodeEntry(std::string &buf, entry_type type, const std::string &name,
+																				const std::string &data, time_t saved) {
+	size_t start = buf.size();
+
+	putLE(buf, 0, 4);
+	buf += (char) type;
+	putLE(buf, name.size(), 4);
+	putLE(buf, data.size(), 4);
+	putLE(buf, (uint64_t) saved, 8);
+	buf += name;
+	buf += data;
+
+	uint32_t crc = crc32(buf.data() + start + 4, buf.size() - start - 4);
+	for (unsigned int i=0; i<4; i++)
+		buf[start + i] = (char) ((crc >> (i * 8)) & 0xFF);
+}
+
+/*********************************************************************************************
+ * validEntry - checks that a whole entry of a known type starts at pos and matches its CRC
+ *
+ *		Params:	len - set to the entry's length if it is valid
+ *
+ *********************************************************************************************/
+
+bool LogStore::validEntry(const std::string &contents, uint64_t pos, uint64_t &len) {
+	if (pos + header_len > contents.size())
+		return false;
+
+	const char *entry = contents.data() + pos;
+	uint8_t type = (uint8_t) entry[4];
+	if ((type != Put) && (type != Commit))
+		return false;
+
+	len = header_len + getLE(entry + 5, 4) + getLE(entry + 9, 4);
+	if (pos + len > contents.size())
+		return false;
+
+	return ((uint32_t) getLE(entry, 4) == crc32(entry + 4, (size_t) len - 4));
+}
+
+/*********************************************************************************************
+ * replay - reads the file and builds the index from its committed batches. A torn write at
+ *		      the end (anything after the last commit, unless a later batch follows it) is cut
+ *				off. Damage with a later batch after it is refused, since it would lose saves.
+ *
+ *********************************************************************************************/
+
+bool LogStore::replay() {
+	std::stringstream msg;
+
+	_index.clear();
+	_live_bytes = 0;
+
+	off_t size = lseek(_fd, 0, SEEK_END);
+	std::string contents;
+	if ((size < 0) || !readAt(0, (size_t) size, contents)) {
+		msg << "Unable to read " << _what << " '" << _dbfile << "': " << strerror(errno);
+		mudlog->writeLog(msg.str().c_str());
+		return false;
+	}
+
+	// A new store, give it a header
+	if (contents.size() == 0) {
+		std::string header(logstore_magic, 4);
+		putLE(header, logstore_version, 4);
+		if ((pwrite(_fd, header.data(), header.size(), 0) != (ssize_t) header.size()) || (fsync(_fd) != 0)) {
+			msg << "Unable to initialize " << _what << " '" << _dbfile << "': " << strerror(errno);
+			mudlog->writeLog(msg.str().c_str());
+			return false;
+		}
+		FileStore::syncDir(_dbfile.substr(0, _dbfile.find_last_of('/') + 1) + ".");
+		_file_size = header.size();
+		return true;
+	}
+
+	if ((contents.size() < logstore_header_len) || (contents.compare(0, 4, logstore_magic, 4) != 0)) {
+		msg << "File '" << _dbfile << "' is not a " << _what << ".";
+		mudlog->writeLog(msg.str().c_str());
+		return false;
+	}
+
+	uint32_t version = (uint32_t) getLE(contents.data() + 4, 4);
+	if (version > logstore_version) {
+		msg << "The " << _what << " '" << _dbfile << "' is version " << version << ", newer than this server reads.";
+		mudlog->writeLog(msg.str().c_str());
+		return false;
+	}
+
+	std::vector<std::pair<std::string, index_entry>> batch;
+	uint64_t pos = logstore_header_len, last_commit = logstore_header_len;
+	uint64_t len = 0;
+
+	while (pos + header_len <= contents.size()) {
+		if (!validEntry(contents, pos, len))
+			break;
+
+		const char *entry = contents.data() + pos;
+		uint64_t name_len = getLE(entry + 5, 4);
+		uint64_t data_len = getLE(entry + 9, 4);
+
+		if ((uint8_t) entry[4] == Put) {
+			std::string name(entry + header_len, (size_t) name_len);
+			batch.emplace_back(name, index_entry{pos, (uint32_t) data_len, (time_t) getLE(entry + 13, 8)});
+		} else {
+			for (unsigned int i=0; i<batch.size(); i++)
+				indexRecord(batch[i].first, batch[i].second);
+			batch.clear();
+			last_commit = pos + len;
+		}
+
+		pos += len;
+	}
+
+	// Each batch is written and synced before the next starts, so only the last can be torn, and
+	// its pages may reach the disk in any order. A good commit past the damage with more good
+	// entries after it is a later batch, so something already committed is damaged--cutting the
+	// file there would throw away saves, so leave it for someone to look at
+	bool commit_seen = false;
+	uint64_t check = pos + 1;
+	while (check + header_len <= contents.size()) {
+		if (!validEntry(contents, check, len)) {
+			check++;
+			continue;
+		}
+
+		if (commit_seen) {
+			msg << "The " << _what << " '" << _dbfile << "' is damaged at byte " << pos << 
+							" but has a later batch after it (from byte " << check << "). Not opening it, " <<
+							"to keep from losing saved data. Restore it from a backup, or move it aside to start over.";
+			mudlog->writeLog(msg.str().c_str());
+			return false;
+		}
+
+		if ((uint8_t) contents[check + 4] == Commit)
+			commit_seen = true;
+		check += len;
+	}
+
+	if (last_commit < contents.size()) {
+		msg << "The " << _what << " '" << _dbfile << "' had " << contents.size() - last_commit <<
+												" bytes of unfinished or damaged writes at the end, discarding them.";
+		mudlog->writeLog(msg.str().c_str());
+		if (ftruncate(_fd, (off_t) last_commit) != 0) {
+			msg.str("");
+			msg << "Unable to truncate the " << _what << ".";
+			mudlog->writeLog(msg.str().c_str());
+			return false;
+		}
+	}
+
+	_file_size = last_commit;
+	_size_metric.set((int64_t) _file_size);
+	_live_metric.set((int64_t) _live_bytes);
+	return true;
+}
+
+/*********************************************************************************************
+ * indexRecord - points the index at a committed record. An empty record deletes the name, so
+ *					  it isn't indexed and is left out when the file is compacted.
+ *
+ *********************************************************************************************/
+
+void LogStore::indexRecord(const std::string &name, const index_entry &entry) {
+	auto idx_it = _index.find(name);
+	if (idx_it != _index.end()) {
+		_live_bytes -= entryLen(name, idx_it->second.data_len);
+		if (entry.data_len == 0)
+			_index.erase(idx_it);
+	}
+
+	if (entry.data_len > 0) {
+		_index[name] = entry;
+		_live_bytes += entryLen(name, entry.data_len);
+	}
+}
+
+/*********************************************************************************************
+ * readAt - reads len bytes from the file at offset into buf
+ *
+ *********************************************************************************************/
+
+bool LogStore::readAt(uint64_t offset, size_t len, std::string &buf) const {
+	buf.resize(len);
+
+	size_t got = 0;
+	while (got < len) {
+		ssize_t results = pread(_fd, &buf[got], len - got, (off_t) (offset + got));
+		if (results < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (results == 0)
+			return false;
+		got += (size_t) results;
+	}
+	return true;
+}
+
+/*********************************************************************************************
+ * writeAt - writes all of buf to fd at offset
+ *
+ *********************************************************************************************/
+
+bool LogStore::writeAt(int fd, const std::string &buf, uint64_t offset) {
+	size_t written = 0;
+	while (written < buf.size()) {
+		ssize_t results = pwrite(fd, buf.data() + written, buf.size() - written, (off_t) (offset + written));
+		if (results < 0) {
+			if (errno != EINTR)
+				return false;
+		} else
+			written += (size_t) results;
+	}
+	return true;
+}
+
+/*********************************************************************************************
+ * load - gets a player's newest record, checking it against its CRC
+ *
+ *		Returns: 1 if found, 0 if not found, -1 if it could not be read
+ *
+ *********************************************************************************************/
+
+int LogStore::load(const std::string &name, std::string &record) {
+	std::string key(name);
+	lower(key);
+
+	{
+		std::lock_guard<std::mutex> lock(_store_mutex);
+
+		auto idx_it = _index.find(key);
+		if (idx_it != _index.end()) {
+			std::string entry;
+			uint64_t len = entryLen(key, idx_it->second.data_len);
+			if (!readAt(idx_it->second.offset, (size_t) len, entry) ||
+							((uint32_t) getLE(entry.data(), 4) != crc32(entry.data() + 4, entry.size() - 4))) {
+				std::string msg("Record for '");
+				msg += key;
+				msg += "' in the ";
+				msg += _what;
+				msg += " could not be read or is damaged.";
+				mudlog->writeLog(msg);
+				return -1;
+			}
+
+			record.assign(entry, header_len + key.size(), idx_it->second.data_len);
+			return 1;
+		}
+	}
+
+	if (_fallback != nullptr)
+		return _fallback->load(key, record);
+	return 0;
+}
+
+bool LogStore::exists(const std::string &name) {
+	return (lastSaved(name) != 0);
+}
+
+/*********************************************************************************************
+ * saveBatch - appends the records and a commit marker in one write and syncs once. If the
+ *				   write fails, the file is cut back to where it was.
+ *
+ *********************************************************************************************/
+
+bool LogStore::saveBatch(const std::vector<store_record> &records) {
+	if (records.size() == 0)
+		return true;
+
+	std::vector<std::string> keys;
+	std::string buf;
+	time_t now = time(NULL);
+
+	for (unsigned int i=0; i<records.size(); i++) {
+		keys.push_back(records[i].name);
+		lower(keys[i]);
+		encodeEntry(buf, Put, keys[i], records[i].data, now);
+	}
+	encodeEntry(buf, Commit, std::string(), std::string(), now);
+
+	std::lock_guard<std::mutex> lock(_store_mutex);
+	if (_fd < 0)
+		return false;
+
+	if (!writeAt(_fd, buf, _file_size) || (fdatasync(_fd) != 0)) {
+		std::stringstream msg;
+		msg << "Unable to write " << records.size() << " records to the " << _what << ": " << strerror(errno);
+		mudlog->writeLog(msg.str().c_str());
+		if (ftruncate(_fd, (off_t) _file_size) != 0)
+			mudlog->writeLog("Unable to truncate the store after a failed write.");
+		return false;
+	}
+
+	// Everything is on disk, so point the index at the new records
+	uint64_t offset = _file_size;
+	for (unsigned int i=0; i<records.size(); i++) {
+		uint32_t data_len = (uint32_t) records[i].data.size();
+		indexRecord(keys[i], index_entry{offset, data_len, now});
+		offset += entryLen(keys[i], data_len);
+	}
+	_file_size += buf.size();
+
+	if ((_file_size >= _compact_min) && ((_file_size - _live_bytes) * 100 > _file_size * _compact_dead))
+		compact();
+
+	_size_metric.set((int64_t) _file_size);
+	_live_metric.set((int64_t) _live_bytes);
+	return true;
+}
+
+/*********************************************************************************************
+ * listNames - every player in the store (and its fallback), sorted
+ *
+ *********************************************************************************************/
+
+void LogStore::listNames(std::vector<std::string> &names) {
+	std::vector<std::string> fallback_names;
+	if (_fallback != nullptr)
+		_fallback->listNames(fallback_names);
+
+	std::vector<std::string> log_names;
+	{
+		std::lock_guard<std::mutex> lock(_store_mutex);
+		log_names.reserve(_index.size());
+		for (auto idx_it = _index.begin(); idx_it != _index.end(); idx_it++)
+			log_names.push_back(idx_it->first);
+	}
+
+	names.clear();
+	std::set_union(log_names.begin(), log_names.end(), fallback_names.begin(), fallback_names.end(),
+																									std::back_inserter(names));
+}
+
+time_t LogStore::lastSaved(const std::string &name) {
+	std::string key(name);
+	lower(key);
+
+	{
+		std::lock_guard<std::mutex> lock(_store_mutex);
+		auto idx_it = _index.find(key);
+		if (idx_it != _index.end())
+			return idx_it->second.saved;
+	}
+
+	if (_fallback != nullptr)
+		return _fallback->lastSaved(key);
+	return 0;
+}
+
+/*********************************************************************************************
+ * compact - copies the live records to a new file as one batch and renames it over the store.
+ *			    Called with the store locked. If anything fails the old file is kept as is.
+ *
+ *		Returns: true if compacted, false (logged) otherwise
+ *
+ *********************************************************************************************/
+
+bool LogStore::compact() {
+	std::string tmpfile(_dbfile);
+	tmpfile += ".compact";
+
+	int newfd = ::open(tmpfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (newfd < 0) {
+		std::string msg("Unable to create a file to compact the ");
+		msg += _what;
+		msg += " into.";
+		mudlog->writeLog(msg);
+		return false;
+	}
+
+	std::string buf(logstore_magic, 4);
+	putLE(buf, logstore_version, 4);
+
+	std::map<std::string, index_entry> new_index;
+	uint64_t new_size = 0;
+	bool failed = false;
+
+	// Copy the entries over as they are, writing a megabyte or so at a time
+	std::string entry;
+	for (auto idx_it = _index.begin(); !failed && (idx_it != _index.end()); idx_it++) {
+		uint64_t len = entryLen(idx_it->first, idx_it->second.data_len);
+		if (!readAt(idx_it->second.offset, (size_t) len, entry)) {
+			failed = true;
+			break;
+		}
+		new_index[idx_it->first] = index_entry{new_size + buf.size(), idx_it->second.data_len,
+																					idx_it->second.saved};
+		buf += entry;
+
+		if (buf.size() >= (1 << 20)) {
+			failed = !writeAt(newfd, buf, new_size);
+			new_size += buf.size();
+			buf.clear();
+		}
+	}
+
+	if (!failed) {
+		encodeEntry(buf, Commit, std::string(), std::string(), time(NULL));
+		failed = !writeAt(newfd, buf, new_size);
+		new_size += buf.size();
+	}
+
+	// Lock the new file before it takes the store's name, so no other server can open it between
+	if (failed || (fsync(newfd) != 0) || (flock(newfd, LOCK_EX | LOCK_NB) != 0) ||
+																(rename(tmpfile.c_str(), _dbfile.c_str()) != 0)) {
+		std::stringstream msg;
+		msg << "Unable to compact the " << _what << ": " << strerror(errno);
+		mudlog->writeLog(msg.str().c_str());
+		::close(newfd);
+		unlink(tmpfile.c_str());
+		return false;
+	}
+	FileStore::syncDir(_dbfile.substr(0, _dbfile.find_last_of('/') + 1) + ".");
+
+	::close(_fd);
+	_fd = newfd;
+
+	std::stringstream msg;
+	msg << "Compacted the " << _what << " from " << _file_size << " to " << new_size << " bytes.";
+	mudlog->writeLog(msg.str().c_str(), 2);
+
+	_index.swap(new_index);
+	_file_size = new_size;
+	_compact_metric.add();
+	return true;
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the store size figures to the registry
+ *
+ *********************************************************************************************/
+
+void LogStore::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_playerstore_bytes", "Size of the player store file", _size_metric);
+	metrics.addGauge("aime_playerstore_live_bytes", "Bytes of the player store holding each player's newest record",
+																										_live_metric);
+	metrics.addCounter("aime_playerstore_compactions_total", "Times the player store was compacted", _compact_metric);
+}
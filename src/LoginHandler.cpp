@@ -6,6 +6,7 @@
 #include "Player.h"
 #include "global.h"
 #include "Trait.h"
+#include "AuthPool.h"
 
 
 LoginHandler::LoginHandler(std::shared_ptr<Player> plr, libconfig::Config &mud_cfg, login_state start_state):
@@ -13,7 +14,8 @@ LoginHandler::LoginHandler(std::shared_ptr<Player> plr, libconfig::Config &mud_c
 								_mud_cfg(mud_cfg),
 								_username(""),
 								_new_passwd(""),
-								_cur_state(start_state)
+								_cur_state(start_state),
+								_handle(new LoginHandler *(this))
 {
 	if (start_state == LoginMenu)
 		plr->getNameID(_username);
@@ -24,7 +26,8 @@ LoginHandler::LoginHandler(const LoginHandler &copy_from):
 								_mud_cfg(copy_from._mud_cfg),
 								_username(copy_from._username),
 								_new_passwd(copy_from._new_passwd),
-								_cur_state(copy_from._cur_state)
+								_cur_state(copy_from._cur_state),
+								_handle(new LoginHandler *(this))
 {
 
 }
@@ -61,7 +64,7 @@ bool LoginHandler::validateUsername(std::string &name) {
 
 int LoginHandler::handleCommand(std::string &cmd) {
 
-	std::string tempname, plrid, userdir;
+	std::string tempname, plrid;
 	int results = 0;
 	libconfig::Config &mud_cfg= *engine.getConfig();
 
@@ -80,8 +83,7 @@ int LoginHandler::handleCommand(std::string &cmd) {
 			}	
 
 			plrid = _plr->getID();
-			_mud_cfg.lookupValue("datadir.userdir", userdir);	
-			if ((results = _plr->loadUser(userdir.c_str(), cmd.c_str())) == 0) {
+			if ((results = engine.getUserMgr()->loadUser(cmd.c_str(), *_plr)) == 0) {
 				_username = cmd;
 				_plr->sendMsg("That user does not exist.\n");
 				_cur_state = AskCreate;
@@ -132,20 +134,28 @@ int LoginHandler::handleCommand(std::string &cmd) {
 				break;
 			}
 			
-			// Create the account
-			_plr->createPassword(cmd.c_str());
-
-			// Temporarily set the name so we can save the user data--can't permanently change it yet as
-			// this will be done when the handler is popped.
-			tempname = _plr->getID();
-			plrid = "player:" + _username;
-			_plr->setID(plrid.c_str());
-
-			// Display the gender instructions
-			infodir += "gender.info";
-			_plr->sendFile(infodir.c_str());
+			if (!engine.getUserMgr()->allowAuthAttempt(_plr->getIPAddr())) {
+				_plr->sendMsg("Too many password attempts. Wait a bit and try again.\n");
+				break;
+			}
 
-			_cur_state = GetGender;
+			// Hash it on the auth workers, picking up in finishCreate
+			_cur_state = Authenticating;
+			{
+				std::weak_ptr<LoginHandler *> handle = _handle;
+				if (!engine.getAuthPool()->createPassword(cmd, 
+								[handle](bool success, const std::vector<unsigned char> &passwd_hash) {
+					(void) success;
+					std::shared_ptr<LoginHandler *> hptr = handle.lock();
+					if (hptr != nullptr)
+						(*hptr)->finishCreate(passwd_hash);
+				})) {
+					_plr->sendMsg("The server is busy. Try again in a moment.\n");
+					_cur_state = CreatePasswd2;
+					break;
+				}
+			}
+			_new_passwd.clear();
 			break;
 		
 		// **** These are LoginHandler states that muds would likely want to edit to suit their own
@@ -221,11 +231,9 @@ int LoginHandler::handleCommand(std::string &cmd) {
          plrid = "player:" + _username;
          _plr->setID(plrid.c_str());
 
-			_mud_cfg.lookupValue("datadir.userdir", userdir);
-
-			if (!_plr->saveUser(userdir.c_str())) {
-				std::string msg("Unable to save user file to ");
-				msg += userdir;
+			if (!engine.getUserMgr()->saveUserNow(*_plr)) {
+				std::string msg("Unable to save new user ");
+				msg += _username;
 				mudlog->writeLog(msg.c_str());
 				_plr->sendMsg("Failed saving your user file. Alert an Admin.\n");
 				handler_state = Disconnect;
@@ -249,15 +257,32 @@ int LoginHandler::handleCommand(std::string &cmd) {
 			break;
 
 		case AskPasswd:
-			if (_plr->checkPassword(cmd.c_str())) {
-				_cur_state = LoginMenu;
-				_plr->sendMsg("Successfully logged in!\n");
-				sendLoginMenu();
+			if (!engine.getUserMgr()->allowAuthAttempt(_plr->getIPAddr())) {
+				_plr->sendMsg("Too many password attempts. Wait a bit and try again.\n");
 				break;
 			}
-			_plr->sendMsg("Incorrect password.\n");
-	
+
+			// Checked on the auth workers, picking up in finishCheck
+			_cur_state = Authenticating;
+			{
+				std::weak_ptr<LoginHandler *> handle = _handle;
+				if (!engine.getAuthPool()->checkPassword(cmd, _plr->getPasswdHash(),
+								[handle](bool success, const std::vector<unsigned char> &passwd_hash) {
+					(void) passwd_hash;
+					std::shared_ptr<LoginHandler *> hptr = handle.lock();
+					if (hptr != nullptr)
+						(*hptr)->finishCheck(success);
+				})) {
+					_plr->sendMsg("The server is busy. Try again in a moment.\n");
+					_cur_state = AskPasswd;
+				}
+			}
 			break;
+
+		case Authenticating:
+			_plr->sendMsg("Still checking your password, one moment.\n");
+			break;
+
 		case LoginMenu:
 			switch (cmd[0]) {
 			case '1':
@@ -338,6 +363,11 @@ void LoginHandler::getPrompt(std::string &buf) {
 			buf = "\rWhat is your choice? ";
 			break;
 
+		// Nothing to enter until the password is checked
+		case Authenticating:
+			buf.clear();
+			break;
+
       default:
          throw std::runtime_error("Unknown state in LoginHandler::handleCommand. Could not handle.");
 
@@ -401,6 +431,64 @@ void LoginHandler::addTrait(std::shared_ptr<Player> plr, const char *trait, bool
 	}
 }
 
+/*********************************************************************************************
+ * finishCheck - picks the login back up once the auth workers have checked the password
+ *
+ *		Params:	matched - whether the password matched the user file
+ *
+ *********************************************************************************************/
+
+void LoginHandler::finishCheck(bool matched) {
+	// They left while we were hashing, and have already been cleaned up
+	if (_plr->getConnStatus() == TCPConn::Closed)
+		return;
+
+	if (matched) {
+		_cur_state = LoginMenu;
+		_plr->sendMsg("Successfully logged in!\n");
+		sendLoginMenu();
+	} else {
+		_cur_state = AskPasswd;
+		_plr->sendMsg("Incorrect password.\n");
+	}
+
+	// Nothing may be queued for this player, so have the game thread visit them for the prompt
+	_plr->markPromptDirty();
+	engine.getUserMgr()->markActive(_plr);
+}
+
+/*********************************************************************************************
+ * finishCreate - picks account creation back up once the auth workers have hashed the new
+ *					   password
+ *
+ *		Params:	passwd_hash - the salt+hash to store in the user file
+ *
+ *********************************************************************************************/
+
+void LoginHandler::finishCreate(const std::vector<unsigned char> &passwd_hash) {
+	std::string infodir, plrid;
+
+	if (_plr->getConnStatus() == TCPConn::Closed)
+		return;
+
+	_plr->setPasswdHash(passwd_hash);
+
+	// Temporarily set the name so we can save the user data--can't permanently change it yet as
+	// this will be done when the handler is popped.
+	plrid = "player:" + _username;
+	_plr->setID(plrid.c_str());
+
+	// Display the gender instructions
+	_mud_cfg.lookupValue("datadir.infodir", infodir);
+	infodir += "/gender.info";
+	_plr->sendFile(infodir.c_str());
+
+	_cur_state = GetGender;
+
+	_plr->markPromptDirty();
+	engine.getUserMgr()->markActive(_plr);
+}
+
 /*********************************************************************************************
  * sendLoginMenu - simply sends the login menu to the user
  *
@@ -1,6 +1,8 @@
 #include <iostream>
+#include <algorithm>
 #include "MUD.h"
 #include "global.h"
+#include "exceptions.h"
 
 namespace lc = libconfig;
 
@@ -21,7 +23,10 @@ MUD::MUD():
 		_entity_db(),
 		_actions(),
 		_users(),
-		_time_between_heartbeat(100000)
+		_events(),
+		_event_flush(1000),
+		_time_between_heartbeat(100000),
+		_tick_budget(80000)
 {
 
 
@@ -34,7 +39,10 @@ MUD::MUD(MUD &copy_from):
 		_entity_db(copy_from._entity_db),
 		_actions(copy_from._actions),
 		_users(copy_from._users),
-		_time_between_heartbeat(copy_from._time_between_heartbeat)
+		_events(copy_from._events),
+		_event_flush(copy_from._event_flush),
+		_time_between_heartbeat(copy_from._time_between_heartbeat),
+		_tick_budget(copy_from._tick_budget)
 {
 
 }
@@ -110,6 +118,34 @@ void MUD::startLog() {
    _mudlog.changeFilename(cstr_setting.c_str());
    _mudlog.setLogLvl((unsigned int) cint_setting);
    mudlog = &_mudlog;
+
+	// Hand writes off to the background writer unless the ring is turned off
+	int ring_size = 0, flush_ms = 1000, flush_bytes = 65536;
+	_mud_config.lookupValue("misc.log_ring_size", ring_size);
+	_mud_config.lookupValue("misc.log_flush_ms", flush_ms);
+	_mud_config.lookupValue("misc.log_flush_bytes", flush_bytes);
+
+	if (ring_size > 0)
+		_mudlog.startWriter((size_t) ring_size, (unsigned int) std::max(flush_ms, 0), 
+																	(size_t) std::max(flush_bytes, 0));
+
+	// The event log is opened here as well so load failures during initialize are captured
+	std::string eventlog;
+	int event_flush_ms = 1000, event_flush_bytes = 65536;
+	_mud_config.lookupValue("misc.eventlog", eventlog);
+	_mud_config.lookupValue("misc.eventlog_flush_ms", event_flush_ms);
+	_mud_config.lookupValue("misc.eventlog_flush_bytes", event_flush_bytes);
+	_event_flush = std::chrono::milliseconds(std::max(event_flush_ms, 0));
+
+	if (eventlog.size() > 0) {
+		try {
+			_events.open(eventlog.c_str(), (size_t) std::max(event_flush_bytes, 0));
+		} catch (const logfile_error &e) {
+			std::string msg("Event log disabled: ");
+			msg += e.what();
+			_mudlog.writeLog(msg);
+		}
+	}
 }
 
 /*********************************************************************************************
@@ -128,6 +164,30 @@ void MUD::initialize() {
 	_mud_config.lookupValue("misc.heartbeat_per_sec", heartbeat_per_sec);
 	_time_between_heartbeat = 1000000 / heartbeat_per_sec;
 
+	// Percent of the heartbeat that players and actions may use before the rest is deferred
+	int tick_budget = 80;
+	_mud_config.lookupValue("misc.tick_budget", tick_budget);
+	if ((tick_budget < 1) || (tick_budget > 100)) {
+		mudlog->writeLog("ERROR - Config setting tick_budget is not between 1 and 100. Defaulting to 80.\n");
+		tick_budget = 80;
+	}
+	_tick_budget = _time_between_heartbeat * tick_budget / 100;
+
+	// How often the tick profile gets written to the log
+	int profile_report = 0;
+	_mud_config.lookupValue("misc.profile_report", profile_report);
+	_profiler.setReportInterval((profile_report > 0) ? (unsigned int) profile_report : 0);
+
+	// Everything that reports to the metrics endpoint
+	_metrics.addSummary("aime_tick_duration_usecs", "Time taken by each heartbeat", _tick_metric);
+	_metrics.addCounter("aime_tick_overruns_total", "Heartbeats that ran past their time", _overrun_metric);
+	_users.registerMetrics(_metrics);
+	_actions.registerMetrics(_metrics);
+	_scripts.registerMetrics(_metrics);
+	_auth.registerMetrics(_metrics);
+	_world.registerMetrics(_metrics);
+	_behaviors.registerMetrics(_metrics);
+
 	// Init the user database
 	_users.initialize(_mud_config);
 	
@@ -140,9 +200,41 @@ void MUD::initialize() {
 	// Load all entities
 	_entity_db.loadPhysicals(_mud_config);
 
+	// Put back the state the zones were in when the MUD last stopped
+	_world.initialize(_mud_config, _entity_db);
+
+	// Group the NPCs by zone so only those near players take turns
+	_behaviors.initialize(_mud_config, _entity_db);
+
+	// Start the zone resets, which fill their spawn rules right away
+	_entity_db.scheduleResets(_actions);
+
 	// Initialize the script engine
 	// _scripts.initialize();
 
+	// Optionally run Script entities on their own thread
+	bool script_worker = false;
+	_mud_config.lookupValue("misc.script_worker", script_worker);
+	if (script_worker) {
+		_scripts.startWorker();
+		mudlog->writeLog("Script worker thread started.", 2);
+	}
+
+	// Password hashing for logins, limited by the memory each hash takes
+	int auth_threads = 2, auth_memory_mb = 128;
+	_mud_config.lookupValue("misc.auth_threads", auth_threads);
+	_mud_config.lookupValue("misc.auth_memory_mb", auth_memory_mb);
+
+	int auth_max_pending = 0;
+	_mud_config.lookupValue("misc.auth_max_pending", auth_max_pending);
+	_auth.setMaxPending((unsigned int) std::max(auth_max_pending, 0));
+	if (auth_threads > 0) {
+		_auth.start((unsigned int) auth_threads, (unsigned int) std::max(auth_memory_mb, 0));
+		std::string msg("Started ");
+		msg += std::to_string(_auth.getNumWorkers());
+		msg += " auth worker(s).";
+		mudlog->writeLog(msg, 2);
+	}
 }
 
 /*********************************************************************************************
@@ -188,18 +280,69 @@ void MUD::runMUD() {
 		
 		std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
 
-		// Goes through the user's handlers, creating actions as required on the queue 
-		_users.handleUsers(_mud_config, _entity_db);
-
-		// Go through the actions in the queue, handling those that are being executed now
-		_actions.handleActions();
+		// Players get the first half of the budget, actions whatever is left of the rest
+		auto users_deadline = start + std::chrono::microseconds(_tick_budget / 2);
+		auto actions_deadline = start + std::chrono::microseconds(_tick_budget);
+
+		{
+			// Calls from scripts on the worker into the world wait for the heartbeat to finish
+			std::lock_guard<std::mutex> world(_scripts.getWorldMutex());
+			auto phase_start = std::chrono::steady_clock::now();
+
+			// Apply world changes made by scripts on the worker thread since the last heartbeat
+			_scripts.applyCommands();
+			auto phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::ApplyCommands, TickProfiler::elapsedUsecs(phase_start, phase_end));
+
+			// Pick up logins whose passwords the auth workers have finished with
+			phase_start = phase_end;
+			_auth.handleCompletions();
+			phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::AuthResults, TickProfiler::elapsedUsecs(phase_start, phase_end));
+
+			// Goes through the user's handlers, creating actions as required on the queue 
+			phase_start = phase_end;
+			_users.handleUsers(_mud_config, _entity_db, users_deadline);
+			phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::Users, TickProfiler::elapsedUsecs(phase_start, phase_end));
+
+			// NPCs in zones with players decide what to do, queueing it as actions
+			phase_start = phase_end;
+			_behaviors.handleBehaviors(_users, _actions);
+			phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::Behaviors, TickProfiler::elapsedUsecs(phase_start, phase_end));
+
+			// Go through the actions in the queue, handling those that are being executed now
+			phase_start = phase_end;
+			_actions.handleActions(actions_deadline);
+			phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::Actions, TickProfiler::elapsedUsecs(phase_start, phase_end));
+
+			// Hand what changed in the zones to the checkpoint writer when it's time
+			phase_start = phase_end;
+			_world.checkpoint(_entity_db);
+			phase_end = std::chrono::steady_clock::now();
+			_profiler.recordPhase(TickProfiler::Checkpoint, TickProfiler::elapsedUsecs(phase_start, phase_end));
+		}
 
 		std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
 
-		long sleep_duration = _time_between_heartbeat - 
-										std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+		long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+		_profiler.recordTick((uint64_t) std::max(elapsed, 0L), (uint64_t) _time_between_heartbeat);
+		_tick_metric.record((uint64_t) std::max(elapsed, 0L));
+		_profiler.checkReport();
+		_events.checkFlush(_event_flush);
+
+		long sleep_duration = _time_between_heartbeat - elapsed;
 		if (sleep_duration > 0)
 			usleep(sleep_duration);
+		else {
+			_overrun_metric.add();
+			std::string msg("Heartbeat overran by ");
+			msg += std::to_string(-sleep_duration);
+			msg += " usec.";
+			mudlog->writeLog(msg, 3);
+		}
 	}
 
 }
@@ -214,6 +357,13 @@ void MUD::runMUD() {
 
 void MUD::cleanup() {
 	_users.stopListeningThread();
-
+	_scripts.stopWorker();
+	_auth.stop();
+	_users.stopSaves();
+	_world.stop(_entity_db);
+
+	// Last, so everything logged during shutdown makes it to disk
+	_events.close();
+	_mudlog.stopWriter();
 }
 
@@ -0,0 +1,278 @@
+#include <string.h>
+#include <cerrno>
+#include "Metrics.h"
+#include "global.h"
+
+// Percentiles reported for summaries
+const double summary_quantiles[] = {0.5, 0.9, 0.99};
+const unsigned int num_quantiles = 3;
+
+// Scrapers that haven't sent a full request in this many seconds are dropped
+const time_t scraper_timeout = 5;
+const size_t max_request_size = 8192;
+const size_t max_scrapers = 16;
+
+/*********************************************************************************************
+ * MetricSummary - records a value into the distribution and hands out copies for reading
+ *
+ *********************************************************************************************/
+
+void MetricSummary::record(uint64_t value) {
+	std::lock_guard<std::mutex> guard(_summary_mutex);
+	_hist.record(value);
+}
+
+Histogram MetricSummary::getSnapshot() {
+	std::lock_guard<std::mutex> guard(_summary_mutex);
+	return _hist;
+}
+
+
+MetricsRegistry::MetricsRegistry():
+								_metrics()
+{
+
+}
+
+// Metrics belong to the subsystems that registered them, so a copy starts empty
+MetricsRegistry::MetricsRegistry(const MetricsRegistry &copy_from):
+								_metrics()
+{
+	(void) copy_from;
+}
+
+MetricsRegistry::~MetricsRegistry() {
+
+}
+
+/*********************************************************************************************
+ * addCounter/addGauge/addSummary - add a metric to the registry
+ *
+ *    Params:  name - the Prometheus metric name (a-z, 0-9 and _)
+ *             help - description shown in the HELP line
+ *             counter/gauge/summary - the metric, owned by the caller
+ *
+ *    Throws:  std::invalid_argument if the name is already registered
+ *
+ *********************************************************************************************/
+
+void MetricsRegistry::addCounter(const char *name, const char *help, MetricCounter &counter) {
+	addMetric(metric{name, help, Counter, &counter, NULL, NULL});
+}
+
+void MetricsRegistry::addGauge(const char *name, const char *help, MetricGauge &gauge) {
+	addMetric(metric{name, help, Gauge, NULL, &gauge, NULL});
+}
+
+void MetricsRegistry::addSummary(const char *name, const char *help, MetricSummary &summary) {
+	addMetric(metric{name, help, Summary, NULL, NULL, &summary});
+}
+
+void MetricsRegistry::addMetric(const metric &new_metric) {
+	std::lock_guard<std::mutex> guard(_reg_mutex);
+
+	for (unsigned int i=0; i<_metrics.size(); i++) {
+		if (_metrics[i].name == new_metric.name) {
+			std::string msg("Metric '");
+			msg += new_metric.name;
+			msg += "' registered twice.";
+			throw std::invalid_argument(msg);
+		}
+	}
+
+	_metrics.push_back(new_metric);
+}
+
+/*********************************************************************************************
+ * formatText - renders all metrics in the Prometheus text exposition format (version 0.0.4)
+ *
+ *    Params:  buf - the text is placed here
+ *
+ *********************************************************************************************/
+
+void MetricsRegistry::formatText(std::string &buf) {
+	std::lock_guard<std::mutex> guard(_reg_mutex);
+	const char *type_names[] = {"counter", "gauge", "summary"};
+
+	buf.clear();
+	for (unsigned int i=0; i<_metrics.size(); i++) {
+		metric &m = _metrics[i];
+
+		buf += "# HELP ";
+		buf += m.name;
+		buf += " ";
+		buf += m.help;
+		buf += "\n# TYPE ";
+		buf += m.name;
+		buf += " ";
+		buf += type_names[m.type];
+		buf += "\n";
+
+		switch (m.type) {
+		case Counter:
+			buf += m.name;
+			buf += " ";
+			buf += std::to_string(m.counter->get());
+			buf += "\n";
+			break;
+
+		case Gauge:
+			buf += m.name;
+			buf += " ";
+			buf += std::to_string(m.gauge->get());
+			buf += "\n";
+			break;
+
+		case Summary:
+			{
+				Histogram hist = m.summary->getSnapshot();
+				for (unsigned int j=0; j<num_quantiles; j++) {
+					std::string quantile = std::to_string(summary_quantiles[j]);
+					quantile.erase(quantile.find_last_not_of('0') + 1);
+
+					buf += m.name;
+					buf += "{quantile=\"";
+					buf += quantile;
+					buf += "\"} ";
+					buf += std::to_string(hist.getPercentile(summary_quantiles[j] * 100.0));
+					buf += "\n";
+				}
+				buf += m.name;
+				buf += "_sum ";
+				buf += std::to_string(hist.getTotal());
+				buf += "\n";
+				buf += m.name;
+				buf += "_count ";
+				buf += std::to_string(hist.getCount());
+				buf += "\n";
+			}
+			break;
+		}
+	}
+}
+
+
+MetricsServer::MetricsServer(MetricsRegistry &registry):
+								_registry(registry),
+								_sockfd(),
+								_scrapers()
+{
+
+}
+
+MetricsServer::~MetricsServer() {
+	shutdown();
+}
+
+/*********************************************************************************************
+ * bindSvr - binds the metrics socket to the address and port and starts it listening
+ *
+ *    Throws:  socket_error if the socket could not be set up
+ *
+ *********************************************************************************************/
+
+void MetricsServer::bindSvr(const char *ip_addr, unsigned short port) {
+	_sockfd.reset(new SocketFD());
+	_sockfd->setNonBlocking();
+	_sockfd->setReusable();
+	_sockfd->bindFD(ip_addr, port);
+	_sockfd->listenFD(5);
+	_listening = true;
+
+	std::string msg("Metrics available at http://");
+	msg += ip_addr;
+	msg += ":";
+	msg += std::to_string(port);
+	msg += "/metrics";
+	mudlog->writeLog(msg);
+}
+
+/*********************************************************************************************
+ * handleRequests - accepts new scrapers, reads what they've sent and answers those with a
+ *						  complete request. Each connection gets one response and is closed.
+ *
+ *********************************************************************************************/
+
+void MetricsServer::handleRequests() {
+	if (!_listening)
+		return;
+
+	while ((_scrapers.size() < max_scrapers) && _sockfd->hasData(0)) {
+		std::unique_ptr<SocketFD> new_sock(new SocketFD());
+		if (!new_sock->acceptFD(*_sockfd))
+			break;
+
+		new_sock->setNonBlocking();
+		_scrapers.push_back(scraper{std::move(new_sock), std::string(), time(NULL)});
+	}
+
+	time_t now = time(NULL);
+	auto scr_it = _scrapers.begin();
+	while (scr_it != _scrapers.end()) {
+		bool done = false;
+
+		if (scr_it->sock->hasData(0)) {
+			std::string readbuf;
+			if (scr_it->sock->readFD(readbuf) <= 0)
+				done = true;
+			else
+				scr_it->request += readbuf;
+
+			// Just the headers are needed, GETs have no body
+			if (!done && ((scr_it->request.find("\r\n\r\n") != std::string::npos) ||
+							  (scr_it->request.find("\n\n") != std::string::npos))) {
+				sendResponse(*(scr_it->sock), scr_it->request);
+				done = true;
+			}
+		}
+
+		if (done || (scr_it->request.size() > max_request_size) || (now - scr_it->started > scraper_timeout)) {
+			scr_it->sock->closeFD();
+			scr_it = _scrapers.erase(scr_it);
+		} else
+			scr_it++;
+	}
+}
+
+/*********************************************************************************************
+ * sendResponse - answers a request: the metrics for GET /metrics (or /), 404 otherwise
+ *
+ *********************************************************************************************/
+
+void MetricsServer::sendResponse(SocketFD &sock, const std::string &request) {
+	std::string body;
+	std::string response;
+
+	if ((request.compare(0, 13, "GET /metrics ") == 0) || (request.compare(0, 6, "GET / ") == 0)) {
+		_registry.formatText(body);
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n";
+	} else {
+		body = "Not found\n";
+		response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+	}
+
+	response += "Content-Length: ";
+	response += std::to_string(body.size());
+	response += "\r\nConnection: close\r\n\r\n";
+	response += body;
+
+	// The response is small enough to go out in one write on a local socket. If it doesn't,
+	// the scraper gets a short read and tries again next interval.
+	sock.writeFD(response);
+}
+
+/*********************************************************************************************
+ * shutdown - closes the listening socket and any scrapers still connected
+ *
+ *********************************************************************************************/
+
+void MetricsServer::shutdown() {
+	for (unsigned int i=0; i<_scrapers.size(); i++)
+		_scrapers[i].sock->closeFD();
+	_scrapers.clear();
+
+	if (_sockfd != nullptr)
+		_sockfd->closeFD();
+	_sockfd.reset();
+	_listening = false;
+}
@@ -24,7 +24,9 @@ NPC::NPC(const char *id):
 
 // Called by child class
 NPC::NPC(const NPC &copy_from):
-								Organism(copy_from)
+								Organism(copy_from),
+								_startloc(copy_from._startloc),
+								_npcflags(copy_from._npcflags)
 {
 
 }
@@ -8,6 +8,7 @@
 #include "Equipment.h"
 #include "Getable.h"
 #include "Trait.h"
+#include "BinRecord.h"
 
 const char *reviewlist[] = {"standing", "entering", "leaving", NULL};
 
@@ -26,12 +27,13 @@ const char *oflag_list[] = { "NoSummon", NULL};
  *
  *********************************************************************************************/
 Organism::Organism(const char *id):
-								Physical(id) 
+								Physical(id),
+								_desc(std::make_shared<organism_desc>())
 {
 	// Review defaults
-	_reviews.push_back("%n is standing here.");				// Standing
-	_reviews.push_back("%n enters the room from %3");	// Entering
-	_reviews.push_back("%n departs the room %1.");		// Leaving
+	_desc->reviews.push_back("%n is standing here.");				// Standing
+	_desc->reviews.push_back("%n enters the room from %3");	// Entering
+	_desc->reviews.push_back("%n departs the room %1.");		// Leaving
 
 	// Hardcoded body parts for now, but later on, could customize for race/class
 	addBodyPart("head", "head");
@@ -75,11 +77,18 @@ Organism::Organism(const char *id):
 
 }
 
-// Called by child class
+// Called by child class. The descriptions are shared until one of the two changes them, and
+// the copy starts out wearing nothing
 Organism::Organism(const Organism &copy_from):
-								Physical(copy_from)
+								Physical(copy_from),
+								_rformatter(copy_from._rformatter),
+								_desc(copy_from._desc),
+								_orgflags(copy_from._orgflags),
+								_bodyparts(copy_from._bodyparts),
+								_traits(copy_from._traits)
 {
-
+	for (auto bp_it = _bodyparts.begin(); bp_it != _bodyparts.end(); bp_it++)
+		bp_it->second.worn.clear();
 }
 
 
@@ -106,15 +115,15 @@ void Organism::saveData(pugi::xml_node &entnode) const {
 
 	// Save the examine 
 	xnode = entnode.append_child("examine");
-	xnode.append_child(pugi::node_pcdata).set_value(_examine.c_str());
+	xnode.append_child(pugi::node_pcdata).set_value(_desc->examine.c_str());
 
 	// Save the reviews
 	const char *reviewtype[] = {"standing", "entering", "leaving", NULL};
 
 	unsigned int i;
-	for (i = 0; i<_reviews.size(); i++) {
+	for (i = 0; i<_desc->reviews.size(); i++) {
 		xnode = entnode.append_child("reviewmsg");
-		xnode.append_child(pugi::node_pcdata).set_value(_reviews[i].c_str());
+		xnode.append_child(pugi::node_pcdata).set_value(_desc->reviews[i].c_str());
 
 		xattr = xnode.append_attribute("type");
 		xattr.set_value(reviewtype[i]);
@@ -153,12 +162,12 @@ int Organism::loadData(pugi::xml_node &entnode) {
       mudlog->writeLog("Organism save file missing mandatory 'examine' field.", 2);
       return 0;
    }
-   _examine = node.child_value();
+   writableCopy(_desc).examine = node.child_value();
 
    // Now populate organism data (none yet)
    pugi::xml_attribute attr = entnode.attribute("title");
    if (node != nullptr) {
-		_title = attr.value();
+		writableCopy(_desc).title = attr.value();
 		
    }
 
@@ -226,7 +235,75 @@ int Organism::loadData(pugi::xml_node &entnode) {
       }
    }
 
-	// Set up our review information
+	setupReviewFormat();
+	return 1;
+}
+
+/*********************************************************************************************
+ * saveRecord/loadRecord - binary versions of saveData/loadData. Reviews are written in
+ *								   review_type order and traits by ID.
+ *
+ *		Returns: (loadRecord) 1 for success, 0 for failure
+ *
+ *********************************************************************************************/
+
+void Organism::saveRecord(RecordWriter &rec) const {
+	Physical::saveRecord(rec);
+
+	rec.putString(_desc->examine);
+
+	rec.putVarint(_desc->reviews.size());
+	for (unsigned int i=0; i<_desc->reviews.size(); i++)
+		rec.putString(_desc->reviews[i]);
+
+	rec.putVarint(_traits.size());
+	for (unsigned int i=0; i<_traits.size(); i++)
+		rec.putKey(_traits[i]->getID());
+}
+
+int Organism::loadRecord(RecordReader &rec) {
+	std::stringstream errmsg;
+
+	int results = 0;
+	if ((results = Physical::loadRecord(rec)) != 1)
+		return results;
+
+	rec.getString(writableCopy(_desc).examine);
+
+	uint64_t num_reviews = rec.getVarint();
+	for (uint64_t i=0; i<num_reviews; i++) {
+		std::string desc;
+		rec.getString(desc);
+		if (i <= Leaving)
+			setReview((review_type) i, desc.c_str());
+	}
+
+	EntityDB *edb = engine.getEntityDB();
+	uint64_t num_traits = rec.getVarint();
+	for (uint64_t i=0; i<num_traits; i++) {
+		const std::string &trait_id = rec.getKey();
+
+		std::shared_ptr<Trait> trait = edb->getTrait(trait_id.c_str());
+		if (trait == nullptr) {
+			errmsg << getTypeName() << " '" << getID() << "' trait '" << trait_id << 
+																				"' does not appear to be a valid trait.";
+			mudlog->writeLog(errmsg.str().c_str());
+			return 0;
+		}
+		addTrait(trait);
+	}
+
+	setupReviewFormat();
+	return 1;
+}
+
+/*********************************************************************************************
+ * setupReviewFormat - maps the name codes in the review messages to this organism's name,
+ *						     dropping a leading "the" or "a" for the lowercase version
+ *
+ *********************************************************************************************/
+
+void Organism::setupReviewFormat() {
 	std::string buf;
 	getGameName(buf);
    _rformatter.changeMap('N', buf.c_str());
@@ -239,8 +316,6 @@ int Organism::loadData(pugi::xml_node &entnode) {
       if ((prefix.compare("the") == 0) || (prefix.compare("a") == 0))
          _rformatter.changeMap('n', buf.substr(pos+1, buf.size()-pos).c_str());
    }
-
-	return 1;
 }
 
 /*********************************************************************************************
@@ -305,7 +380,7 @@ bool Organism::isFlagSetInternal(const char *flagname, bool &results) {
  *********************************************************************************************/
 
 const char *Organism::getReview(review_type review) {
-	return _reviews[(unsigned int) review].c_str();
+	return _desc->reviews[(unsigned int) review].c_str();
 }
 
 const char *Organism::getReview(const char *reviewstr) {
@@ -344,7 +419,7 @@ const char *Organism::getReviewProcessed(review_type review, std::string &buf,
 	}
 	
 	try {
-		_rformatter.formatStr(_reviews[review].c_str(), buf);
+		_rformatter.formatStr(_desc->reviews[review].c_str(), buf);
 	} catch (const format_error &e) {
 		// On errors, set review to the error message
 		buf = "Organism review error: ";
@@ -376,7 +451,7 @@ const char *Organism::getReviewProcessed(const char *reviewstr, std::string &buf
  *********************************************************************************************/
 
 void Organism::setReview(review_type review, const char *new_review) {
-	_reviews[review] = new_review;
+	writableCopy(_desc).reviews[review] = new_review;
 }
 
 /*********************************************************************************************
@@ -780,10 +855,11 @@ bool Organism::canSee() {
 	if (!cur_loc->isLocFlagSet(Location::Dark))
 		return true;
 
-	if (containsLit(0))
+	// Lit counts are kept by the containers, so no need to search
+	if (hasLitContents())
 		return true;
 
-	if (cur_loc->containsLit(0))
+	if (cur_loc->hasLitContents())
 		return true;
 
 	return false;
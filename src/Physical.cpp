@@ -3,6 +3,8 @@
 #include <sstream>
 #include <regex>
 #include "Physical.h"
+#include "BinRecord.h"
+#include "Broadcast.h"
 #include "global.h"
 #include "Attribute.h"
 #include "misc.h"
@@ -14,15 +16,19 @@
  *
  *********************************************************************************************/
 Physical::Physical(const char *id):
-								Entity(id)
+								Entity(id),
+								_specials(std::make_shared<std::vector<std::pair<std::string, std::string>>>())
 {
 
 
 }
 
-// Called by child class
+// Called by child class. Specials and attributes are shared with copy_from (see
+// writableAttribute), while location, contents and checkpoint tracking are not copied
 Physical::Physical(const Physical &copy_from):
-										Entity(copy_from)
+										Entity(copy_from),
+										_specials(copy_from._specials),
+										_attributes(copy_from._attributes)
 {
 
 }
@@ -103,7 +109,7 @@ int Physical::loadData(pugi::xml_node &entnode) {
          }
          std::string trigger = attr.value();
 
-			_specials.push_back(std::pair<std::string, std::string>(trigger, special.child_value()));
+			_specials->push_back(std::pair<std::string, std::string>(trigger, special.child_value()));
 		}
       catch (std::invalid_argument &e) {
          errmsg << getTypeName() << " '" << getID() << "' specials error: " << e.what();
@@ -116,6 +122,155 @@ int Physical::loadData(pugi::xml_node &entnode) {
 
 }
 
+/*********************************************************************************************
+ * saveRecord/loadRecord - binary versions of saveData/loadData. Attributes are written as an
+ *								   interned name, a type and the value in its native form.
+ *
+ *		Returns: (loadRecord) 1 for success, 0 for failure
+ *
+ *********************************************************************************************/
+
+void Physical::saveRecord(RecordWriter &rec) const {
+	Entity::saveRecord(rec);
+
+	rec.putVarint(_attributes.size());
+	for (auto m_it = _attributes.begin(); m_it != _attributes.end(); m_it++) {
+		rec.putKey(m_it->first);
+
+		Attribute::attr_type atype = m_it->second->getType();
+		rec.putVarint((uint64_t) atype);
+		if (atype == Attribute::Int)
+			rec.putSigned(m_it->second->getInt());
+		else if (atype == Attribute::Float)
+			rec.putFloat(m_it->second->getFloat());
+		else if (atype == Attribute::String)
+			rec.putString(m_it->second->getStr());
+	}
+}
+
+int Physical::loadRecord(RecordReader &rec) {
+	if (!Entity::loadRecord(rec))
+		return 0;
+
+	uint64_t num_attribs = rec.getVarint();
+	for (uint64_t i=0; i<num_attribs; i++) {
+		std::string name = rec.getKey();
+
+		// Try to set an existing attribute and, if not found, create it
+		uint64_t atype = rec.getVarint();
+		if (atype == Attribute::Int) {
+			int value = (int) rec.getSigned();
+			if (!setAttribute(name.c_str(), value))
+				addAttribute(name.c_str(), value);
+		} else if (atype == Attribute::Float) {
+			float value = rec.getFloat();
+			if (!setAttribute(name.c_str(), value))
+				addAttribute(name.c_str(), value);
+		} else if (atype == Attribute::String) {
+			std::string value;
+			rec.getString(value);
+			if (!setAttribute(name.c_str(), value.c_str()))
+				addAttribute(name.c_str(), value.c_str());
+		} else {
+			std::stringstream errmsg;
+			errmsg << getTypeName() << " '" << getID() << "' attribute '" << name << "' has unknown type " << atype;
+			mudlog->writeLog(errmsg.str().c_str());
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Header of an encoded entity state (see snapshotState)
+const char *state_magic = "AWST";
+const unsigned int state_version = 1;
+
+/*********************************************************************************************
+ * snapshotState/restoreState - encodes the entity's checkpointed state (see saveState) or puts
+ *										  it back
+ *
+ *		Returns: (restoreState) true if restored, false (logged) if the state couldn't be read
+ *
+ *********************************************************************************************/
+
+void Physical::snapshotState(std::string &state) const {
+	RecordWriter rec;
+	saveState(rec);
+	rec.finish(state_magic, state_version, state);
+}
+
+bool Physical::restoreState(EntityDB &edb, const std::string &state) {
+	std::stringstream errmsg;
+
+	RecordReader rec(state);
+	try {
+		unsigned int version = rec.open(state_magic);
+		if (version > state_version) {
+			errmsg << "Saved state for '" << getID() << "' is version " << version << 
+																		", newer than this server reads (" << state_version << ").";
+			mudlog->writeLog(errmsg.str().c_str());
+			return false;
+		}
+
+		loadState(rec, edb);
+		return true;
+	}
+	catch (record_error &e) {
+		errmsg << "Saved state for '" << getID() << "' is corrupted: " << e.what();
+		mudlog->writeLog(errmsg.str().c_str());
+	}
+	return false;
+}
+
+/*********************************************************************************************
+ * saveState/loadState - the state kept by world checkpoints. At this level it's where the
+ *								 entity is. Anything not inside a zone entity (carried by a player, or
+ *								 taken out of the world) is left wherever the zone files put it, since
+ *								 players don't keep what they carry.
+ *
+ *		Throws: record_error - (loadState) the state is cut short or corrupted
+ *
+ *********************************************************************************************/
+
+void Physical::saveState(RecordWriter &rec) const {
+	if ((_cur_loc != nullptr) && _cur_loc->isStateTracked())
+		rec.putString(_cur_loc->getID());
+	else
+		rec.putString(std::string());
+}
+
+void Physical::loadState(RecordReader &rec, EntityDB &edb) {
+	std::string loc;
+	rec.getString(loc);
+
+	if ((loc.size() == 0) || ((_cur_loc != nullptr) && (loc.compare(_cur_loc->getID()) == 0)))
+		return;
+
+	std::shared_ptr<Physical> new_loc = edb.getPhysical(loc.c_str());
+	if (new_loc == nullptr) {
+		std::stringstream msg;
+		msg << "WARNING: Saved location '" << loc << "' of '" << getID() << "' no longer exists.";
+		mudlog->writeLog(msg.str().c_str());
+		return;
+	}
+	movePhysical(new_loc, getPhysSelfPtr());
+}
+
+/*********************************************************************************************
+ * stateChanged - queues a tracked entity for the next world checkpoint. Each entity is queued
+ *					   once until the checkpoint picks it up.
+ *
+ *********************************************************************************************/
+
+void Physical::stateChanged() {
+	if (!_state_tracked || _state_dirty)
+		return;
+
+	_state_dirty = true;
+	engine.getEntityDB()->markDirty(getPhysSelfPtr());
+}
+
 /*********************************************************************************************
  * containsPhysical - Checks if the physical is contained within this physical's container
  *
@@ -144,9 +299,22 @@ bool Physical::addPhysical(std::shared_ptr<Physical> new_phys) {
 		return false;
 
 	_contained.push_back(new_phys);
+
+	if (isLitStatic(new_phys))
+		_lit_count++;
 	return true;
 }
 
+/*********************************************************************************************
+ * isLitStatic - returns true if the physical is a Static with the Lit flag set
+ *
+ *********************************************************************************************/
+
+bool Physical::isLitStatic(std::shared_ptr<Physical> phys_ptr) {
+	std::shared_ptr<Static> sptr = std::dynamic_pointer_cast<Static>(phys_ptr);
+	return ((sptr != nullptr) && (sptr->isStaticFlagSet(Static::Lit)));
+}
+
 /*********************************************************************************************
  * removePhysical - Removes the physical from the container
  *
@@ -161,6 +329,10 @@ bool Physical::removePhysical(std::shared_ptr<Physical> phys_ptr) {
       if (phys_ptr == *cptr){
          _contained.erase(cptr);
 			phys_ptr->_cur_loc = nullptr;
+			phys_ptr->stateChanged();
+
+			if (isLitStatic(phys_ptr))
+				_lit_count--;
 			return true;
 		}
    }
@@ -198,6 +370,7 @@ bool Physical::movePhysical(std::shared_ptr<Physical> new_phys, std::shared_ptr<
 	_cur_loc = new_phys;
 
 	results &= new_phys->addPhysical(self);
+	stateChanged();
 	return results;
 }
 
@@ -255,37 +428,18 @@ std::shared_ptr<Physical> Physical::getContainedByID(const char *name_alias) {
 
 std::shared_ptr<Physical> Physical::getContainedByName(const char *name, bool allow_abbrev) {
    std::string namebuf = name;
-	std::string ebuf;
 
    // Search through the contained for the object
    auto eit = _contained.begin();
    for ( ; eit != _contained.end(); eit++) {
-
-		// Get the Game name which might be Title or NameID
-		eit->get()->getGameName(ebuf);
-		lower(ebuf);
-
-      if ((!allow_abbrev) && (namebuf.compare(ebuf) == 0))
-         return *eit;
-		else if ((allow_abbrev) && equalAbbrev(namebuf, ebuf.c_str()))
+		if ((*eit)->matchesGameName(namebuf, allow_abbrev))
 			return *eit;
-
-		// See if the game name starts with "the " and try without it
-		if (ebuf.find("the ") != std::string::npos) {
-			std::string nothe = ebuf.substr(4, ebuf.size()-4);
-
-	      if ((!allow_abbrev) && (namebuf.compare(nothe) == 0))
-		      return *eit;
-			else if ((allow_abbrev) && equalAbbrev(namebuf, nothe.c_str()))
-				return *eit;
-
-		}
    }
 
    // Search by altnames next
    eit = _contained.begin();
    for ( ; eit != _contained.end(); eit++) {
-      if (eit->get()->hasAltName(name, allow_abbrev))
+      if ((*eit)->hasAltName(name, allow_abbrev))
          return *eit;
    }
 
@@ -293,6 +447,41 @@ std::shared_ptr<Physical> Physical::getContainedByName(const char *name, bool al
 
 }
 
+/*********************************************************************************************
+ * matchesGameName - compares the name against this physical's game name, with and without a
+ *						   leading "the"
+ *
+ *		Params:	namebuf - the name to match, should already be lowercase
+ *					allow_abbrev - if true, physical only needs to match up to sizeof(name)
+ *
+ *    Returns: true if it matches, false otherwise
+ *
+ *********************************************************************************************/
+
+bool Physical::matchesGameName(const std::string &namebuf, bool allow_abbrev) const {
+	std::string ebuf;
+
+	// Get the Game name which might be Title or NameID
+	getGameName(ebuf);
+	lower(ebuf);
+
+	if ((!allow_abbrev) && (namebuf.compare(ebuf) == 0))
+		return true;
+	else if ((allow_abbrev) && equalAbbrev(namebuf, ebuf.c_str()))
+		return true;
+
+	// See if the game name starts with "the " and try without it
+	if (ebuf.find("the ") != std::string::npos) {
+		std::string nothe = ebuf.substr(4, ebuf.size()-4);
+
+		if ((!allow_abbrev) && (namebuf.compare(nothe) == 0))
+			return true;
+		else if ((allow_abbrev) && equalAbbrev(namebuf, nothe.c_str()))
+			return true;
+	}
+	return false;
+}
+
 /*********************************************************************************************
  * containsLit - searches the contents of this Physical for anything with the Static::Lit flag.
  *
@@ -431,6 +620,16 @@ bool Physical::isFlagSetInternal(const char *flagname, bool &results) {
 }
 
 
+/*********************************************************************************************
+ * sendBroadcast - sends a message that is going out to many recipients. Classes that can
+ *					    share the pre-formatted buffer override this.
+ *
+ *********************************************************************************************/
+
+void Physical::sendBroadcast(Broadcast &bcast) {
+	sendMsg(bcast.getMsg());
+}
+
 /*********************************************************************************************
  * purgePhysical - Removes all references to the parameter from the Entities in the database so
  *               it can be safely removed
@@ -448,6 +647,9 @@ size_t Physical::purgePhysical(std::shared_ptr<Physical> item) {
 		if ((*c_it) == item) {
 			c_it = _contained.erase(c_it);
 			count++;
+
+			if (isLitStatic(item))
+				_lit_count--;
 		} else
 			c_it++;
 	}
@@ -518,7 +720,7 @@ bool Physical::setAttribute(const char *attrib, int value) {
 	if (m_it == _attributes.end())
 		return false;
 
-	*(m_it->second) = value;
+	writableAttribute(m_it->second) = value;
 	return true;
 }
 
@@ -527,7 +729,7 @@ bool Physical::setAttribute(const char *attrib, float value) {
    if (m_it == _attributes.end())
       return false;
 
-   *(m_it->second) = value;
+   writableAttribute(m_it->second) = value;
    return true;
 }
 
@@ -537,7 +739,7 @@ bool Physical::setAttribute(const char *attrib, const char *value) {
    if (m_it == _attributes.end())
       return false;
 
-   *(m_it->second) = value;
+   writableAttribute(m_it->second) = value;
    return true;
 }
 
@@ -547,7 +749,7 @@ bool Physical::setAttribute(const char *attrib, Attribute &value) {
    if (m_it == _attributes.end())
       return false;
 
-   *(m_it->second) = value;
+   writableAttribute(m_it->second) = value;
    return true;
 }
 
@@ -559,7 +761,7 @@ bool Physical::incrAttribute(const char *attrib, int increase, int max) {
 	
 	int value = m_it->second->getInt();
 	value = ((max > 0) && (value + increase > max)) ? max : value + increase;
-	*(m_it->second) = value;
+	writableAttribute(m_it->second) = value;
 	return true;
 }
 
@@ -589,6 +791,21 @@ const char *Physical::getAttribStr(const char *attrib, std::string &buf) {
 	return buf.c_str();
 }
 
+/*********************************************************************************************
+ * writableAttribute - gives this entity its own copy of an attribute it shares with the
+ *						     prototype it was spawned from (or with entities spawned from it) before
+ *						     the attribute is changed
+ *
+ *		Returns: the attribute, safe to change
+ *
+ *********************************************************************************************/
+
+Attribute &Physical::writableAttribute(std::shared_ptr<Attribute> &attr) {
+	if (attr.use_count() > 1)
+		attr.reset(copyAttribute(*attr));
+	return *attr;
+}
+
 /*********************************************************************************************
  * hasAttribute/hasAttributeInternal - simple boolean check to see if an attribute exists
  *
@@ -684,10 +901,10 @@ int Physical::execSpecial(const char *trigger,
 	ScriptEngine &se = *engine.getScriptEngine();
 
 	// Loop through all the specials attached to this object
-	for (unsigned int i=0; i<_specials.size(); i++) {
+	for (unsigned int i=0; i<_specials->size(); i++) {
 		
 		// Compare special against trigger
-		if (_specials[i].first.compare(trigger) == 0)
+		if ((*_specials)[i].first.compare(trigger) == 0)
 		{
 			for (unsigned int i=0; i<variables.size(); i++)
 				se.setVariable(variables[i].first.c_str(), variables[i].second);
@@ -709,10 +926,17 @@ int Physical::execSpecial(const char *trigger,
                se.setVariableConst((*variable_strs)[i].first.c_str(), (*variable_strs)[i].second.c_str());
          }
 
-			int results = se.execute(_specials[i].second);
+			int results = se.execute((*_specials)[i].second);
 			if (results == 1)
 				return 2;
 
+			if (results < 0) {
+				std::string subject(getID());
+				subject += ":";
+				subject += trigger;
+				engine.getEventLog()->writeEvent(EventLog::ScriptError, subject.c_str(), se.getErrMsg());
+			}
+
 			return 1;
 		}
 	}
@@ -2,11 +2,17 @@
 #include <sstream>
 #include <iostream>
 #include <bitset>
+#include <algorithm>
 #include <argon2.h>
 #include <string.h>
 #include <boost/algorithm/hex.hpp>
 #include <memory>
+#include <random>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "Player.h"
+#include "Broadcast.h"
 #include "LoginHandler.h"
 #include "GameHandler.h"
 #include "PageHandler.h"
@@ -17,11 +23,16 @@
 #include "global.h"
 #include "Getable.h"
 #include "Equipment.h"
+#include "BinRecord.h"
 
 // Defines the password hash/salt bytelength
 const unsigned int hashlen = 16;
 const unsigned int saltlen = 8;
 
+// Identifies a binary player file, and the newest format version written and read
+const char *record_magic = "APLR";
+const unsigned int record_version = 1;
+
 const char *pflag_list[] = {"nochat", NULL};
 
 /*********************************************************************************************
@@ -38,6 +49,7 @@ Player::Player(const char *id, std::unique_ptr<TCPConn> conn):
 																_handler_stack(),
 																_cmd_mutex(),
 																_commands(),
+																_cmd_bucket(),
 																_use_color(true),
 																_passwd_hash()
 {
@@ -54,6 +66,7 @@ Player::Player(const Player &copy_from):
 								_handler_stack(),
 								_cmd_mutex(),
 								_commands(copy_from._commands),
+								_cmd_bucket(copy_from._cmd_bucket),
 								_use_color(copy_from._use_color),
 								_passwd_hash(copy_from._passwd_hash)
 {
@@ -129,6 +142,22 @@ void Player::sendMsg(std::string &msg, std::shared_ptr<Physical> exclude, std::s
 	_conn->addOutput(formatted.c_str());	
 }
 
+/*********************************************************************************************
+ * sendBroadcast - sends a message shared with other recipients. If we are at the start of a
+ *					    line, the Broadcast's pre-formatted buffer for our profile is queued as-is.
+ *						 Otherwise wrapping depends on our column, so it is formatted just for us.
+ *
+ *********************************************************************************************/
+
+void Player::sendBroadcast(Broadcast &bcast) {
+	if (_last_wrap != 0) {
+		sendMsg(bcast.getMsg());
+		return;
+	}
+
+	_conn->addOutput(bcast.getFormatted(_use_color, _wrap_width, _last_wrap));
+}
+
 /*std::ostream &Player::operator << (std::ostream &out, const Player &p) {
 
 }*/
@@ -158,18 +187,25 @@ void Player::welcomeUser(libconfig::Config &mud_cfg, std::shared_ptr<Player> thi
 	// Now place a login handler on the stack
 	_handler_stack.push(std::unique_ptr<Handler>(new LoginHandler(thisplr, mud_cfg)));
 	_handler_stack.top()->postPush();
+	markPromptDirty();
 }
 
 /*********************************************************************************************
  * handleConnection - checks the connection for input and sends any output
  *
+ *		Returns: true if the game thread needs to look at this player (a command line arrived or
+ *					the connection changed status), false otherwise
  *
  *********************************************************************************************/
 
-void Player::handleConnection(time_t timeout) {
+bool Player::handleConnection(time_t timeout) {
+	TCPConn::conn_status old_status = _conn->getConnStatus();
+
 	// Send all data and receive data
 	_conn->handleConnection(timeout);
 
+	bool needs_attention = (_conn->getConnStatus() != old_status);
+
 	// Extract received data into a command queue
 	std::string buf, left, right;
 	if (_conn->getUserInput(buf) > 0) {
@@ -184,9 +220,21 @@ void Player::handleConnection(time_t timeout) {
 			// Push the commands onto the player's command queue
 			_commands.push(left);
 			buf = right;
+			needs_attention = true;
 		}
 		
 	}
+	return needs_attention;
+}
+
+/*********************************************************************************************
+ * hasCommands - returns true if there are commands waiting in the queue
+ *
+ *********************************************************************************************/
+
+bool Player::hasCommands() {
+	std::lock_guard<std::mutex> guard(_cmd_mutex);
+	return (_commands.size() > 0);
 }
 
 
@@ -241,194 +289,225 @@ const char color_table[] =
 
 #define colorcode(x) ( (x>=64) ? color_table[x-64] : 0 )
 
+/*********************************************************************************************
+ * findKeyChar - finds the next byte that formatForTelnet has to look at: '&', '\n', '\r' or a
+ *					  non-ASCII byte. Everything before it can be copied as-is. Uses SSE2 compares to
+ *					  check 16 bytes at a time where available.
+ *
+ *    Returns: index of the byte found, or len if there are none
+ *
+ *********************************************************************************************/
+
+static size_t findKeyChar(const char *buf, size_t pos, size_t len) {
+#ifdef __SSE2__
+	const __m128i amp = _mm_set1_epi8('&');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+
+	while (pos + 16 <= len) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + pos));
+		__m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lf)),
+																				_mm_cmpeq_epi8(chunk, cr));
+
+		// The movemask of the raw bytes is their high bits, which catches non-ASCII too
+		unsigned int mask = (unsigned int) (_mm_movemask_epi8(hits) | _mm_movemask_epi8(chunk));
+		if (mask != 0)
+			return pos + (size_t) __builtin_ctz(mask);
+		pos += 16;
+	}
+#endif
+
+	for ( ; pos < len; pos++) {
+		unsigned char c = (unsigned char) buf[pos];
+		if ((c == '&') || (c == '\n') || (c == '\r') || (c >= 0x80))
+			return pos;
+	}
+	return len;
+}
+
+/*********************************************************************************************
+ * attrEscape - returns the ANSI escape for a single-character text attribute code, or NULL if
+ *					 code is not one of them
+ *
+ *********************************************************************************************/
+
+static const char *attrEscape(char code) {
+	switch (code) {
+		case '*': return "\033[1;0m";		// All attributes off
+		case '^': return "\033[1;1m";		// Bold
+		case '~': return "\033[1;3m";		// Italics
+		case '_': return "\033[1;4m";		// Underline
+		case '@': return "\033[1;5m";		// Blinking
+		default: return NULL;
+	}
+}
+
+// Word-wrap state carried through a formatForTelnet call
+struct wrapstate {
+	unsigned int width;			// Wrap column, 0 for no wrapping
+	unsigned int col;				// Current column
+	size_t space_pos;				// Index in formatted of the last space on this line, or npos
+	unsigned int space_col;		// Column just past that space
+};
+
+/*********************************************************************************************
+ * appendWrapped - appends a run of plain ASCII text to formatted, wrapping at ws.width. Rather
+ *					    than stepping backwards to find a space when a line overflows, the position of
+ *						 the last space written on the line is kept and swapped for the line break.
+ *
+ *********************************************************************************************/
+
+static void appendWrapped(std::string &formatted, const char *run, size_t len, wrapstate &ws) {
+	if (ws.width == 0) {
+		formatted.append(run, len);
+		ws.col += (unsigned int) len;
+		return;
+	}
+
+	while (len > 0) {
+		// Past the wrap column--break at the last space, or chop the word if there wasn't one
+		if (ws.col >= ws.width) {
+			if (ws.space_pos != std::string::npos) {
+				formatted.replace(ws.space_pos, 1, "\r\n");
+				ws.col -= ws.space_col;
+			} else {
+				formatted.append("\r\n");
+				ws.col = 0;
+			}
+			ws.space_pos = std::string::npos;
+			continue;
+		}
+
+		// Copy as much as fits on this line, noting the last space in it
+		size_t chunk = std::min(len, (size_t) (ws.width - ws.col));
+		const char *space = static_cast<const char *>(memrchr(run, ' ', chunk));
+		if (space != NULL) {
+			ws.space_pos = formatted.size() + (size_t) (space - run);
+			ws.space_col = ws.col + (unsigned int) (space - run) + 1;
+		}
+
+		formatted.append(run, chunk);
+		ws.col += (unsigned int) chunk;
+		run += chunk;
+		len -= chunk;
+	}
+}
+
 /*********************************************************************************************
  * formatForTelnet - Converts the outgoing text from MUD format to a format meeting RFC5198
- *						   Telnet protocol specs w/ ANSI colorcodes, which should work for mud clients too
+ *						   Telnet protocol specs w/ ANSI colorcodes, which should work for mud clients too.
+ *							Works in a single forward pass, bulk copying the plain text between codes.
  *
  *    Params:  unformatted - string buffer with the unformatted text
  *					formatted - string buffer to contain the new formatted text (should not be the
  *                         same buffer as unformatted)
+ *					use_color - include ANSI color codes or strip them
+ *					wrap_width - the column to word-wrap at, 0 for no wrapping
+ *					last_wrap - the current column, updated to the column after this text
  *
  *********************************************************************************************/
 
 void Player::formatForTelnet(const std::string &unformatted, std::string &formatted) {
-	// Set up a bitset class to contain the characters we're looking for
-	std::bitset<256> keychars;
-	keychars['&'] = true;
-	keychars['\n'] = true;
+	formatForTelnet(unformatted, formatted, _use_color, _wrap_width, _last_wrap);
+}
 
-	// Keep track of the last colorcode so we can turn it off
-	
-	// Reserve some space in the formatted string, assuming 20% greater than unformatted
+void Player::formatForTelnet(const std::string &unformatted, std::string &formatted, bool use_color,
+														unsigned int wrap_width, unsigned int &last_wrap) {
+	// Reserve some space in the formatted string, assuming 25% greater than unformatted
 	formatted.clear();
-	formatted.reserve(unformatted.size() * 1.2);
+	formatted.reserve(unformatted.size() + unformatted.size() / 4);
 
-	std::string colorstr;
+	const char *buf = unformatted.data();
+	size_t len = unformatted.size();
 
-	unsigned int lastpos = 0;
-	for (unsigned int i=0; i<unformatted.size(); i++) {
+	wrapstate ws = {wrap_width, last_wrap, std::string::npos, 0};
 
-      // if we find a '\r', then restart our wrapping and check the next for a \n 
-      if ((unformatted[i] == '\r') || (unformatted[i] == '\n'))
-		{
-			_last_wrap = 0;
-			continue;
-		}
+	size_t pos = 0;
+	while (pos < len) {
+		size_t next = findKeyChar(buf, pos, len);
+		if (next > pos)
+			appendWrapped(formatted, buf + pos, next - pos, ws);
 
-		// If we're at our word-wrap location, wrap it
-		if ((_wrap_width != 0) && (_last_wrap >= _wrap_width)) {
-
-			// Step backwards to find a space
-			unsigned int j=i;
-			while ((j > 0) && (j > lastpos) && (j--)) {
-				if (unformatted[j] == ' ') {
-					formatted.append(unformatted, lastpos, j-lastpos);
-					formatted.append("\r\n");
-					lastpos = j+1;
-					_last_wrap = 0;
-					i = lastpos;
-					continue;
-				}
-			}
+		if (next == len)
+			break;
+		pos = next;
 
-			// We may have a situation where the colorcode was placed right before wrap		
-			if ((j == lastpos) && ((i - lastpos) < _wrap_width)) {
-				formatted.append("\r\n");
-				lastpos = j;
-				_last_wrap = 0;
-				i = j;
-				continue;
-			}
-	
-			// We did not find a space to wrap. Just chop it at wraplength
-			else if (j == lastpos) {
-				formatted.append(unformatted, lastpos, i-lastpos+1);
-				formatted.append("\r\n");
-				lastpos = i+1;
-				_last_wrap = 0;
-				i = lastpos;
-				continue;
-			}	
+		// Line endings go through as they are and restart the wrapping
+		if ((buf[pos] == '\r') || (buf[pos] == '\n')) {
+			formatted += buf[pos++];
+			ws.col = 0;
+			ws.space_pos = std::string::npos;
+			continue;
 		}
 
-		// Skip odd characters
-		if (unformatted[i] < 0)
+		// Odd characters are passed along but don't count toward the wrap
+		if (buf[pos] != '&') {
+			formatted += buf[pos++];
 			continue;
+		}
 
-		// Keep going while it's just a regular character
-		if (!keychars[(std::size_t) unformatted[i]]) {
-			_last_wrap++;
-			continue;
+		// An ampersand at the very end is just an ampersand
+		if (pos + 1 == len) {
+			appendWrapped(formatted, "&", 1, ws);
+			break;
 		}
 
-		// /n should be preceeded by a \r
-		if (unformatted[i] == '\n') {
-			_last_wrap = 0;
-			if ((i == 0) || (unformatted[i-1] != '\r')) {
-				if ((i - lastpos) > 1)
-					formatted.append(unformatted, lastpos, i-lastpos);
-				formatted.append("\r\n");
-				lastpos = i + 1;
-			} 
+		char code = buf[pos+1];
+		const char *attr = attrEscape(code);
+
+		// Bold, italics, underline, blinking or all off
+		if (attr != NULL) {
+			if (use_color)
+				formatted.append(attr);
+			pos += 2;
+		}
+		// Change double && to single &
+		else if (code == '&') {
+			appendWrapped(formatted, "&", 1, ws);
+			pos += 2;
 		}
-		// Ampersands could be a colorcode or an && 
-		else if (unformatted[i] == '&') {
-			if (i+1 == unformatted.size())
+		// A plus means set text color, negative background color
+		else if ((code == '+') || (code == '-')) {
+			if (pos + 2 >= len) {
+				appendWrapped(formatted, "&", 1, ws);
+				pos++;
 				continue;
-
-			// Change double && to single &
-			if (unformatted[i+1] == '&') {
-				formatted.append(unformatted, lastpos, i-lastpos);
-				lastpos = i + 2;
-				_last_wrap++;
 			}
-			// Turn off colorcodes
-			else if (unformatted[i+1] == '*') {
-				formatted.append(unformatted, lastpos, i-lastpos);
-				if (_use_color)
-					formatted.append("\033[1;0m");
-				lastpos = i+2;
+
+			char color = colorcode((int) buf[pos+2]);
+			if ((use_color) && (color != '\0')) {
+				char colorstr[] = "\033[1;30m";
+				if (code == '-')
+					colorstr[4] = '4';
+				colorstr[5] = color;
+				formatted.append(colorstr, sizeof(colorstr) - 1);
 			}
-         // Turn on bold
-         else if (unformatted[i+1] == '^') {
-            formatted.append(unformatted, lastpos, i-lastpos);
-            if (_use_color)
-               formatted.append("\033[1;1m");
-            lastpos = i+2;
-         }
-         // Turn on italics
-         else if (unformatted[i+1] == '~') {
-            formatted.append(unformatted, lastpos, i-lastpos);
-            if (_use_color)
-               formatted.append("\033[1;3m");
-            lastpos = i+2;
-         }
-         // Turn on underline
-         else if (unformatted[i+1] == '_') {
-            formatted.append(unformatted, lastpos, i-lastpos);
-            if (_use_color)
-               formatted.append("\033[1;4m");
-            lastpos = i+2;
-         }
-			// Blinking
-         else if (unformatted[i+1] == '@') {
-            formatted.append(unformatted, lastpos, i-lastpos);
-            if (_use_color)
-               formatted.append("\033[1;5m");
-            lastpos = i+2;
-         }
-
-			// A plus means set text color, negative background color
-			else if ((unformatted[i+1] == '+') || (unformatted[i+1] == '-')) {
-				if (i+2 == unformatted.size())
-					continue;
-
-				if (lastpos != i)
-					formatted.append(unformatted, lastpos, i-lastpos);
-
-				if ((_use_color) && (colorcode((int) unformatted[i+2]) != '\0')) {
-					// Foreground color?
-					colorstr = "\033[1;30m";
-
-					// No, background, change it!
-					if (unformatted[i+1] == '-')
-						colorstr[4] = '4';
-
-					colorstr[5] = colorcode((int) unformatted[i+2]);
-
-					formatted.append(colorstr);
-				}
-				lastpos = i+3;
-			} 
-			// '=' means both foreground and background colors
-			else if (unformatted[i+1] == '=') {
-				if (i+3 >= unformatted.size())
-					continue;
-
-				if (lastpos != i)
-					formatted.append(unformatted, lastpos, i-lastpos);
-				
-				if ((_use_color) && ((colorcode((int) unformatted[i+2]) != '\0') && 
-											(colorcode((int) unformatted[i+3]) != '\0'))) {
-					colorstr = "\033[1;40;30m";
-					colorstr[5] = colorcode((int) unformatted[i+2]);
-					colorstr[8] = colorcode((int) unformatted[i+3]);
-					formatted.append(colorstr);
-				}
-				lastpos = i+4;
-			} else { // Unrecognized, skip
-				if (lastpos != i)
-					formatted.append(unformatted, lastpos, i-lastpos);
-
-				lastpos = i + 1;
+			pos += 3;
+		}
+		// '=' means both background and foreground colors
+		else if (code == '=') {
+			if (pos + 3 >= len) {
+				appendWrapped(formatted, "&", 1, ws);
+				pos++;
+				continue;
 			}
-			i = lastpos-1;
 
+			char bgcolor = colorcode((int) buf[pos+2]);
+			char fgcolor = colorcode((int) buf[pos+3]);
+			if ((use_color) && (bgcolor != '\0') && (fgcolor != '\0')) {
+				char colorstr[] = "\033[1;40;30m";
+				colorstr[5] = bgcolor;
+				colorstr[8] = fgcolor;
+				formatted.append(colorstr, sizeof(colorstr) - 1);
+			}
+			pos += 4;
 		}
+		// Unrecognized, skip the ampersand
+		else
+			pos++;
 	}
-	if (lastpos < unformatted.size()) {
-		formatted.append(unformatted, lastpos, unformatted.size()-lastpos);
-	}
+
+	last_wrap = ws.col;
 }
 
 /*********************************************************************************************
@@ -467,27 +546,33 @@ void Player::clearPrompt() {
 }
 
 /**********************************************************************************************
- * updatePrompt - modifies dynamic prompts and updates the connection
+ * updatePrompt - rebuilds the prompt and updates the connection. Does nothing unless the prompt
+ *					   was marked dirty, and leaves the connection alone if the text didn't change.
  *
  **********************************************************************************************/
 
 void Player::updatePrompt() {
+	if (!_prompt_dirty)
+		return;
+	_prompt_dirty = false;
+
 	std::string prompt;
 
 	Handler &cur_handler = *(_handler_stack.top());
 
-	// Call the handler here to modify the prompt (todo)
-
 	// Get the new prompt
 	cur_handler.getPrompt(prompt);
+	if (prompt == _prompt)
+		return;
+	_prompt = prompt;
 
 	std::string clrprompt;
    clrprompt.assign(prompt.size(), ' ');
-   clrprompt[0] = '\r';
+	if (clrprompt.size() > 0)
+	   clrprompt[0] = '\r';
 	clrprompt += '\r';
 
-	_conn->setPreWrite(clrprompt.c_str());
-	_conn->setPostWrite(prompt.c_str());
+	_conn->swapPrompt(clrprompt, prompt);
 }
 
 
@@ -509,10 +594,8 @@ void Player::sendCurLocation() {
 		sendMsg("Darkness\n\nYou are unable to see anything.\n\n");
 		return;
 	}
-	sendMsg("\n");
-	sendMsg(locptr->getTitle());
-	sendMsg("\n");
-	sendMsg(locptr->getDesc());
+	// The room blocks come from the location's render cache
+	sendBroadcast(locptr->getHeaderRender());
 
 	sendLocContents();
 	sendMsg("\n");
@@ -535,8 +618,7 @@ void Player::sendExits() {
       return;
    }
 
-	std::string buf;
-	sendMsg(locptr->getExitsStr(buf));
+	sendBroadcast(locptr->getExitsRender());
 }
 
 
@@ -554,8 +636,15 @@ void Player::sendLocContents() {
       return;
    }
 
+	// Everything but the other players looks the same to everyone, so that part is cached
+	Broadcast &objects = locptr->getContentsRender();
+	if (objects.getMsg().size() > 0)
+		sendBroadcast(objects);
+
 	std::string buf;
-	sendMsg(locptr->listContents(buf, this));
+	locptr->listPlayers(buf, this);
+	if (buf.size() > 0)
+		sendMsg(buf);
 }
 
 /*********************************************************************************************
@@ -567,8 +656,9 @@ void Player::sendLocContents() {
 int Player::handleCommand(std::string &cmd) {
 
 
-	// Execute the command
+	// Execute the command--this may change the handler's state, and so its prompt
 	_handler_stack.top()->handleCommand(cmd);
+	markPromptDirty();
 
 	if (_handler_stack.top()->handler_state != Handler::Active)
 		return 1;
@@ -591,6 +681,7 @@ void Player::popHandler(std::vector<std::string> &results) {
 	_handler_stack.top()->prePop(results);
 
 	_handler_stack.pop();
+	markPromptDirty();
 
 	// Execute any code when this handler activates (like with the PageHandler)
 	if (_handler_stack.top()->activate())
@@ -600,82 +691,89 @@ void Player::popHandler(std::vector<std::string> &results) {
 
 
 /*********************************************************************************************
- * loadUser - attempts to load the user into the given Player object
+ * loadUser - populates this player from a record read out of the PlayerStore. Takes the binary
+ *				  record or a legacy XML save, which is written back as binary on the next save.
  *
- *    Params:  username - self-explanatory
- *             plr - an existing Player class that will be populated (note: id will not be
- *                   changed and should not be until authentication happens)
+ *    Params:  username - the player's name, for messages
+ *             record - the data from the store
  *
- *    Returns: 1 if loaded, 0 if not found
+ *    Returns: 1 if loaded, -1 if the record could not be read
  *
  *********************************************************************************************/
 
-int Player::loadUser(const char *userdir, const char *username) {
-   pugi::xml_document userfile;
+int Player::loadUser(const char *username, const std::string &record) {
 	std::stringstream errmsg;
 
-   std::string filename = userdir;
-   std::string user = username;
-   lower(user);
-	filename += "/";
-   filename += user;
-   filename += ".xml";
+	if (record.compare(0, 4, record_magic) != 0)
+		return loadUserXML(username, record);
 
-   pugi::xml_parse_result result = userfile.load_file(filename.c_str());
+	RecordReader rec(record);
+	try {
+		unsigned int version = rec.open(record_magic);
+		if (version > record_version) {
+			errmsg << "Player save for '" << username << "' is version " << version << 
+																		", newer than this server reads (" << record_version << ").";
+			mudlog->writeLog(errmsg.str().c_str());
+			return -1;
+		}
 
-   if (!result) {
-      return 0;
-   }
+		if (loadRecord(rec) == 1)
+			return 1;
+	}
+	catch (record_error &e) {
+		errmsg << "Player save for '" << username << "' is corrupted: " << e.what();
+		mudlog->writeLog(errmsg.str().c_str());
+	}
+
+	sendMsg("Your save file has been corrupted and cannot be loaded. Contact an admin.\n");
+	return -1;
+}
+
+/*********************************************************************************************
+ * loadUserXML - loads a user from an old XML save
+ *
+ *    Returns: 1 if loaded, -1 if the save could not be read
+ *
+ *********************************************************************************************/
+
+int Player::loadUserXML(const char *username, const std::string &record) {
+   pugi::xml_document userfile;
+	std::stringstream errmsg;
+
+   pugi::xml_parse_result result = userfile.load_buffer(record.data(), record.size());
 
 	pugi::xml_node pnode = userfile.child("player");
-	if (pnode == nullptr) {
-		errmsg << "Corrupted player file for player " << user;
+	if (!result || (pnode == nullptr)) {
+		errmsg << "Corrupted player file for player " << username;
 		mudlog->writeLog(errmsg.str().c_str());
 		return -1;
 	}
 	if (!loadData(pnode)) {
 		std::stringstream errmsg;
-		errmsg << "Player '" << user << "' save file not in the proper format.";
+		errmsg << "Player '" << username << "' save file not in the proper format.";
 		mudlog->writeLog(errmsg.str().c_str());
 
 		sendMsg("Your save file has been corrupted and cannot be loaded. Contact an admin.\n");
 		return -1; 
 	}
 
+	errmsg << "Loaded legacy XML save for '" << username << "', it will be converted on the next save.";
+	mudlog->writeLog(errmsg.str().c_str(), 2);
    return 1;
 }
 
 /*********************************************************************************************
- * saveUser - saves the user data to a file
+ * snapshotUser - encodes the player data to be saved. Cheap next to writing it, so it's done
+ *					   on the game thread and the record handed off to be written.
  *
- *    Params:  username - self-explanatory
- *
- *    Returns: 1 if loaded, 0 if not found
+ *    Params:  record - set to the encoded player
  *
  *********************************************************************************************/
 
-bool Player::saveUser(const char *userdir) const {
-
-	// Populate an XML document with player data, then save it to the file
-
-   pugi::xml_document userfile;
-	std::string buf;
-	
-	// Username needs to be accurately stored in the id field
-   std::string filename;
-	filename += userdir;
-	filename += "/";
-	filename += getNameID(buf);
-	filename += ".xml";
-
-	pugi::xml_node node = userfile.append_child("player");
-
-	saveData(node);	
-
-	if (!userfile.save_file(filename.c_str())) {
-		return false;
-	}
-   return true;
+void Player::snapshotUser(std::string &record) const {
+	RecordWriter rec;
+	saveRecord(rec);
+	rec.finish(record_magic, record_version, record);
 }
 
 /*********************************************************************************************
@@ -697,17 +795,18 @@ void Player::generatePasswdHash(const char *cleartext, std::vector<unsigned char
 {
    uint8_t hashbuf[hashlen];
 
-   srand(time(0));
-
-   // Generate a random salt string
+   // Generate a random salt string. Auth workers hash at the same time, so each thread gets
+   // its own generator
    uint8_t saltbuf[saltlen];
+   thread_local std::mt19937 salt_rng(std::random_device{}());
+   std::uniform_int_distribution<int> salt_chars(33, 125);
 
    // If the user provided a salt, use that...otherwise, randomly generate one
    if (salt.size() != saltlen) {
 		salt.clear();
 		salt.reserve(saltlen);
       for (unsigned int i=0; i<saltlen; i++) {
-         saltbuf[i] = ((rand() % 93)+33);  // ascii characters ! through ~
+         saltbuf[i] = (uint8_t) salt_chars(salt_rng);  // ascii characters ! through }
 			salt.push_back(saltbuf[i]);
 		}
    }
@@ -715,7 +814,7 @@ void Player::generatePasswdHash(const char *cleartext, std::vector<unsigned char
 		std::copy(salt.begin(), salt.end(), saltbuf);
 
    const uint32_t t_cost = 2;          // 1 pass computation
-   const uint32_t m_cost = (1<<16);    // 64 MB memory usage
+   const uint32_t m_cost = passwd_mem_kb;    // 64 MB memory usage
    const uint32_t parallelism = 1;     // number of threads and lanes
 
    // hash and place into the hashstr array
@@ -729,44 +828,79 @@ void Player::generatePasswdHash(const char *cleartext, std::vector<unsigned char
 }
 
 /*********************************************************************************************
- * createPassword - Creates a new password hash and saves it into this user's password field. 
+ * makePasswdHash - Hashes a password with a new random salt, producing the salt+hash stored
+ *						  in the user file. Safe to call from the auth workers.
  *
  *    Params:  cleartext - the cleartext password to hash
- *
+ *					passwd_hash - filled with the salt followed by the hash
  *
  *********************************************************************************************/
 
-void Player::createPassword(const char *cleartext)
+void Player::makePasswdHash(const char *cleartext, std::vector<unsigned char> &passwd_hash)
 {
 	std::vector<unsigned char> hash, salt;
 
 	generatePasswdHash(cleartext, hash, salt);
-	_passwd_hash.clear();
-	_passwd_hash.assign(salt.begin(), salt.end());
-	_passwd_hash.insert(std::end(_passwd_hash), std::begin(hash), std::end(hash));	
+	passwd_hash.clear();
+	passwd_hash.assign(salt.begin(), salt.end());
+	passwd_hash.insert(std::end(passwd_hash), std::begin(hash), std::end(hash));	
 }
 
 /*********************************************************************************************
- * checkPassword - Hashes a plaintext password and compares against the stored password hash
+ * matchPasswdHash - Hashes a password with the salt from a stored salt+hash and compares the
+ *						   results. Safe to call from the auth workers.
  *
  *    Params:  cleartext - the cleartext password to compare 
+ *					passwd_hash - the stored salt+hash
  *
  *		Returns: true for passwords match, false otherwise
  *
  *********************************************************************************************/
 
-bool Player::checkPassword(const char *cleartext)
+bool Player::matchPasswdHash(const char *cleartext, const std::vector<unsigned char> &passwd_hash)
 {
    std::vector<unsigned char> salt, hash, comparehash;
 
-   salt.assign(_passwd_hash.begin(), _passwd_hash.begin() + saltlen);
+	if (passwd_hash.size() < saltlen)
+		return false;
+
+   salt.assign(passwd_hash.begin(), passwd_hash.begin() + saltlen);
 
 	generatePasswdHash(cleartext, hash, salt);
-	comparehash.assign(_passwd_hash.begin() + saltlen, _passwd_hash.end());
+	comparehash.assign(passwd_hash.begin() + saltlen, passwd_hash.end());
 
 	return (hash == comparehash);
 }
 
+/*********************************************************************************************
+ * createPassword - Creates a new password hash and saves it into this user's password field. 
+ *						  Blocks for the length of the hash--logins go through the AuthPool instead
+ *
+ *    Params:  cleartext - the cleartext password to hash
+ *
+ *
+ *********************************************************************************************/
+
+void Player::createPassword(const char *cleartext)
+{
+	makePasswdHash(cleartext, _passwd_hash);
+}
+
+/*********************************************************************************************
+ * checkPassword - Hashes a plaintext password and compares against the stored password hash.
+ *						 Blocks for the length of the hash--logins go through the AuthPool instead
+ *
+ *    Params:  cleartext - the cleartext password to compare 
+ *
+ *		Returns: true for passwords match, false otherwise
+ *
+ *********************************************************************************************/
+
+bool Player::checkPassword(const char *cleartext)
+{
+	return matchPasswdHash(cleartext, _passwd_hash);
+}
+
 /*********************************************************************************************
  * saveData - Called by a child class to save Player-specific data into the XML tree
  *
@@ -836,6 +970,37 @@ int Player::loadData(pugi::xml_node &entnode) {
 	return 1;
 }
 
+/*********************************************************************************************
+ * saveRecord/loadRecord - binary versions of saveData/loadData
+ *
+ *    Returns: (loadRecord) 1 for success, 0 for failure
+ *
+ *********************************************************************************************/
+
+void Player::saveRecord(RecordWriter &rec) const {
+   Organism::saveRecord(rec);
+
+	rec.putBytes(_passwd_hash);
+	rec.putVarint(_wrap_width);
+}
+
+int Player::loadRecord(RecordReader &rec) {
+   int results = 0;
+   if ((results = Organism::loadRecord(rec)) != 1)
+      return results;
+
+	rec.getBytes(_passwd_hash);
+	if (_passwd_hash.size() != hashlen + saltlen) {
+		std::stringstream errmsg;
+		errmsg << "Player '" << getID() << "' save file has a bad password hash.";
+		mudlog->writeLog(errmsg.str().c_str());
+		return 0;
+	}
+
+	setWrapWidth((unsigned int) rec.getVarint());
+	return 1;
+}
+
 /*********************************************************************************************
  * setFlagInternal - given the flag string, first checks the parent for the flag, then checks
  *							this class' flags
@@ -892,6 +1057,18 @@ bool Player::isFlagSetInternal(const char *flagname, bool &results) {
 	
 }
 
+/*********************************************************************************************
+ * lookupPFlag - finds the index of a Player-level flag so callers can resolve a flag name once
+ *					  and then test getPFlags() directly
+ *
+ *    Returns: the index into the pflags bitset, or UINT_MAX if not a Player flag
+ *
+ *********************************************************************************************/
+
+unsigned int Player::lookupPFlag(const char *flagname) {
+	return locateInTable(flagname, pflag_list);
+}
+
 /*********************************************************************************************
  * listContents - preps a string with a list of visible items in this player's container (inventory)
  *
@@ -980,11 +1157,13 @@ void Player::quit() {
  *********************************************************************************************/
 
 void Player::exitMUD() {
+	engine.getUserMgr()->saveUser(*this);
 	getCurLoc()->removePhysical(std::dynamic_pointer_cast<Physical>(_self));
 
 	LoginHandler *lhptr = new LoginHandler(std::dynamic_pointer_cast<Player>(_self),
 													*(engine.getConfig()), LoginHandler::LoginMenu);
 	_handler_stack.push(std::unique_ptr<Handler>(lhptr));
+	markPromptDirty();
 	lhptr->sendLoginMenu();
 
 }
@@ -0,0 +1,20 @@
+#include "PlayerStore.h"
+
+PlayerStore::PlayerStore() {
+
+}
+
+PlayerStore::~PlayerStore() {
+
+}
+
+/*********************************************************************************************
+ * save - saves a single record
+ *
+ *********************************************************************************************/
+
+bool PlayerStore::save(const std::string &name, const std::string &record) {
+	std::vector<store_record> records;
+	records.push_back(store_record{name, record});
+	return saveBatch(records);
+}
@@ -2,6 +2,7 @@
 #include "PythonInterface.h"
 #include "Organism.h"
 #include "exceptions.h"
+#include "misc.h"
 #include "global.h"
 #include "Static.h"
 #include "Door.h"
@@ -29,6 +30,7 @@ IMUD::~IMUD() {
  *********************************************************************************************/
 
 IPhysical IMUD::getPhysical(const char *id) {
+	WorldLock world;
 	EntityDB &edb = *(engine.getEntityDB());
 	std::shared_ptr<Physical> eptr = edb.getPhysical(id);
 
@@ -50,6 +52,7 @@ IPhysical IMUD::getPhysical(const char *id) {
  *********************************************************************************************/
 
 IScript IMUD::getScript(const char *id) {
+	WorldLock world;
    EntityDB &edb = *(engine.getEntityDB());
    std::shared_ptr<Script> sptr = edb.getScript(id);
 
@@ -67,15 +70,30 @@ IScript IMUD::getScript(const char *id) {
  * sendMsgAll - sends the given message to everyone in the MUD
  *	sendMsgExc - sends given message to the MUD, excluding the second parameter
  *
- * Throws: 
+ *		When called from the script worker, the message is buffered and 0 is returned
  *
  *********************************************************************************************/
 
 int IMUD::sendMsgAll(const char *msg) {
+	WorldLock world;
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::string msgstr(msg);
+		se.bufferCommand([msgstr](){ engine.getUserMgr()->sendMsg(msgstr.c_str(), NULL, NULL, nullptr); });
+		return 0;
+	}
 	return engine.getUserMgr()->sendMsg(msg, NULL, NULL, nullptr);
 }
 
 int IMUD::sendMsgExc(const char *msg, IPhysical &exclude) {
+	WorldLock world;
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::string msgstr(msg);
+		std::shared_ptr<Physical> exc_ptr = exclude._eptr;
+		se.bufferCommand([msgstr, exc_ptr](){ engine.getUserMgr()->sendMsg(msgstr.c_str(), NULL, NULL, exc_ptr); });
+		return 0;
+	}
    return engine.getUserMgr()->sendMsg(msg, NULL, NULL, exclude._eptr);
 }
 
@@ -87,13 +105,42 @@ int IMUD::sendMsgExc(const char *msg, IPhysical &exclude) {
  *********************************************************************************************/
 
 int IMUD::addScript(IScript &the_script) {
+	WorldLock world;
 	// Make a copy as this will be destroyed when complete
 	std::shared_ptr<Script> new_script(new Script(*the_script._sptr));
 
 	// Clear the old copy of things specific to this instance
 	the_script._sptr->clearVariables();
 
-	return engine.getActionMgr()->addScript(new_script);
+	engine.getScriptEngine()->runCommand([new_script](){ engine.getActionMgr()->addScript(new_script); });
+	return 1;
+}
+
+/*********************************************************************************************
+ * spawn - creates a new entity from a prototype in the given location
+ *
+ * Throws: script_error if the prototype is not found
+ *
+ *********************************************************************************************/
+
+int IMUD::spawn(const char *proto_id, IPhysical &loc) {
+	WorldLock world;
+	checkNull(loc._eptr);
+
+	// Prototypes are only added while loading, so it's safe to look from the worker
+	if (engine.getEntityDB()->getPrototype(proto_id) == nullptr) {
+		std::stringstream errmsg;
+
+		errmsg << "spawn could not find prototype '" << proto_id << "'. It may not exist.";
+		throw script_error(errmsg.str().c_str());
+	}
+
+	std::string proto_str(proto_id);
+	std::shared_ptr<Physical> loc_ptr = loc._eptr;
+	engine.getScriptEngine()->runCommand([proto_str, loc_ptr](){
+		engine.getEntityDB()->spawn(proto_str.c_str(), loc_ptr);
+	});
+	return 1;
 }
 
 IPhysical::IPhysical(std::shared_ptr<Physical> eptr):
@@ -114,6 +161,7 @@ IPhysical::IPhysical(const IPhysical &copy_from):
  *********************************************************************************************/
 
 std::string IPhysical::getCurLocID() {
+	WorldLock world;
 	checkNull(_eptr);
 
 	if (_eptr->getCurLoc() == nullptr)
@@ -123,11 +171,13 @@ std::string IPhysical::getCurLocID() {
 }
 
 IPhysical IPhysical::getCurLoc() {
+	WorldLock world;
 	return IPhysical(_eptr->getCurLoc());
 }
 
 // For the other side of the door
 IPhysical IPhysical::getCurLoc2() {
+	WorldLock world;
 	checkNull(_eptr);
 
 	std::shared_ptr<Door> dptr = std::dynamic_pointer_cast<Door>(_eptr);
@@ -145,6 +195,7 @@ IPhysical IPhysical::getCurLoc2() {
  *********************************************************************************************/
 
 std::string IPhysical::getTitle() {
+	WorldLock world;
 	checkNull(_eptr);
 
 	std::string buf;
@@ -158,6 +209,7 @@ std::string IPhysical::getTitle() {
  *********************************************************************************************/
 
 std::string IPhysical::getID() {
+	WorldLock world;
 	if (_eptr == nullptr)
 		return std::string("none");
 
@@ -170,6 +222,7 @@ std::string IPhysical::getID() {
  *********************************************************************************************/
 
 bool IPhysical::isFlagSet(const char *flagname) {
+	WorldLock world;
    checkNull(_eptr);
 
    bool results = false;
@@ -188,20 +241,23 @@ bool IPhysical::isFlagSet(const char *flagname) {
  *********************************************************************************************/
 
 void IPhysical::sendMsg(const char *msg) {
+	WorldLock world;
    checkNull(_eptr);
 
 	std::shared_ptr<Organism> optr = std::dynamic_pointer_cast<Organism>(_eptr);
 
+	std::string msgstr(msg);
+
 	// Send to an organism?
 	if (optr != NULL) {
-		optr->sendMsg(msg);
+		engine.getScriptEngine()->runCommand([optr, msgstr](){ optr->sendMsg(msgstr.c_str()); });
 		return;
 	}
 
 	// Send to a location?
 	std::shared_ptr<Location> lptr = std::dynamic_pointer_cast<Location>(_eptr);
 	if (lptr != NULL) {
-		lptr->sendMsg(msg);
+		engine.getScriptEngine()->runCommand([lptr, msgstr](){ lptr->sendMsg(msgstr.c_str()); });
 		return;
 	}
 
@@ -210,6 +266,7 @@ void IPhysical::sendMsg(const char *msg) {
 }
 
 void IPhysical::sendMsgExc(const char *msg, IPhysical &exclude) {
+	WorldLock world;
    checkNull(_eptr);
 
 	// This function only works for location, hence the exclude function
@@ -219,7 +276,9 @@ void IPhysical::sendMsgExc(const char *msg, IPhysical &exclude) {
 		throw script_error("sendMsg special function with exclude called on a non-location.");
    }
 
-   lptr->sendMsg(msg, exclude._eptr);
+	std::string msgstr(msg);
+	std::shared_ptr<Physical> exc_ptr = exclude._eptr;
+   engine.getScriptEngine()->runCommand([lptr, msgstr, exc_ptr](){ lptr->sendMsg(msgstr.c_str(), exc_ptr); });
 }
 
 /*********************************************************************************************
@@ -228,14 +287,19 @@ void IPhysical::sendMsgExc(const char *msg, IPhysical &exclude) {
  *********************************************************************************************/
 
 void IPhysical::moveTo(IPhysical &new_loc) {
+	WorldLock world;
    checkNull(_eptr);
 
-	if (!_eptr->movePhysical(new_loc._eptr, _eptr)) {
-      std::stringstream errmsg;
+	std::shared_ptr<Physical> eptr = _eptr;
+	std::shared_ptr<Physical> loc_ptr = new_loc._eptr;
+	engine.getScriptEngine()->runCommand([eptr, loc_ptr](){
+		if (!eptr->movePhysical(loc_ptr, eptr)) {
+			std::stringstream errmsg;
 
-      errmsg << "moveTo special function failed for some reason moving: " << _eptr->getID();
-      throw script_error(errmsg.str().c_str());
-	}
+			errmsg << "moveTo special function failed for some reason moving: " << eptr->getID();
+			throw script_error(errmsg.str().c_str());
+		}
+	});
 }
 
 /*********************************************************************************************
@@ -244,6 +308,7 @@ void IPhysical::moveTo(IPhysical &new_loc) {
  *********************************************************************************************/
 
 void IPhysical::destroy() {
+	WorldLock world;
    checkNull(_eptr);
 
 	std::shared_ptr<Physical> cur_loc = _eptr->getCurLoc();
@@ -251,36 +316,43 @@ void IPhysical::destroy() {
 		throw script_error("destroy function called on object with null location.");
 	}
 
-	if (!cur_loc->removePhysical(_eptr)) {
-      std::stringstream errmsg;
+	std::shared_ptr<Physical> eptr = _eptr;
+	engine.getScriptEngine()->runCommand([cur_loc, eptr](){
+		if (!cur_loc->removePhysical(eptr)) {
+			std::stringstream errmsg;
 
-      errmsg << "destroy special function failed for some reason with: " << _eptr->getID();
-      throw script_error(errmsg.str().c_str());
-   }
+			errmsg << "destroy special function failed for some reason with: " << eptr->getID();
+			throw script_error(errmsg.str().c_str());
+		}
+	});
 	_eptr = nullptr;
 }
 
 /*********************************************************************************************
- * showLocation - displays the location to the player, usually used after teleporting them
+ * showLocation - displays the location to the player, usually used after teleporting them.
+ *					   Goes through the command buffer so it shows where a buffered moveTo put them
  *
  *********************************************************************************************/
 
 void IPhysical::showLocation() {
+	WorldLock world;
    checkNull(_eptr);
 
 	std::shared_ptr<Organism> optr = std::dynamic_pointer_cast<Organism>(_eptr);
 	if (optr == nullptr)
 		throw script_error("showLocation called on non-organism.");
 
-	optr->sendCurLocation();
+	engine.getScriptEngine()->runCommand([optr](){ optr->sendCurLocation(); });
 }
 
 /*********************************************************************************************
- * damage - damages the organism, killing them if health reaches zero
+ * damage - damages the organism, killing them if health reaches zero. From the script worker
+ *				the damage is buffered and the return value predicts whether it will be fatal
  *
  *********************************************************************************************/
 
 bool IPhysical::damage(int amount) {
+	WorldLock world;
    checkNull(_eptr);
 
 	if (amount <= 0) {
@@ -293,16 +365,25 @@ bool IPhysical::damage(int amount) {
 		throw script_error("damage function called on non-Organism.\n");
 	}
 
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		se.bufferCommand([optr, amount](){ optr->damage((unsigned int) amount); });
+		return (optr->getAttribInt("health") <= amount);
+	}
+
 	return optr->damage((unsigned int) amount);
 }
 
 
 /*********************************************************************************************
- * getDoorState/setDoorState - gets and sets the door state. Options: open, closed, locked, magic
+ * getDoorState/setDoorState - gets and sets the door state. Options: open, closed, locked, special
  *
  *********************************************************************************************/
 
+const char *doorstate_list[] = {"open", "closed", "locked", "special", NULL};
+
 std::string IPhysical::getDoorState() {
+	WorldLock world;
    checkNull(_eptr);
 
 	std::shared_ptr<Static> sptr = std::dynamic_pointer_cast<Static>(_eptr);
@@ -311,11 +392,11 @@ std::string IPhysical::getDoorState() {
 		throw script_error("getDoorState special function called on nonStatic");
 	}
 	
-	const char *doorstate[] = {"open", "closed", "locked", "special"};
-	return std::string(doorstate[sptr->getDoorState()]);
+	return std::string(doorstate_list[sptr->getDoorState()]);
 }
 
 void IPhysical::setDoorState(const char *state) {
+	WorldLock world;
    checkNull(_eptr);
 
 	std::shared_ptr<Static> sptr = std::dynamic_pointer_cast<Static>(_eptr);
@@ -323,11 +404,20 @@ void IPhysical::setDoorState(const char *state) {
       throw script_error("setDoorState special function called on nonStatic");
    }
 
-	if (!sptr->setDoorState(state)) {
+	// Checked here so a bad state is still an error in the script when the change is buffered
+	std::string statestr(state);
+	lower(statestr);
+	unsigned int i=0;
+	while ((doorstate_list[i] != NULL) && (statestr.compare(doorstate_list[i]) != 0))
+		i++;
+
+	if (doorstate_list[i] == NULL) {
 		std::string errmsg("setDoorState special function called with improper state: ");
 		errmsg += state;
       throw script_error(errmsg.c_str());
 	}
+
+	engine.getScriptEngine()->runCommand([sptr, statestr](){ sptr->setDoorState(statestr.c_str()); });
 }
 
 /*********************************************************************************************
@@ -337,6 +427,7 @@ void IPhysical::setDoorState(const char *state) {
  *********************************************************************************************/
 
 bool IPhysical::isContained(IPhysical &target) {
+	WorldLock world;
    checkNull(_eptr);
 	return _eptr->containsPhysical(target._eptr);	
 }
@@ -344,6 +435,7 @@ bool IPhysical::isContained(IPhysical &target) {
 
 
 bool IPhysical::isContainedID(const char *id) {
+	WorldLock world;
    checkNull(_eptr);
    EntityDB &edb = *(engine.getEntityDB());
    std::shared_ptr<Physical> eptr = edb.getPhysical(id);
@@ -361,22 +453,53 @@ bool IPhysical::isContainedID(const char *id) {
 
 /*********************************************************************************************
  * addInt/Float/StrAttribute - Adds the specified type of attribute by the given name to the
- *						physical entity
+ *						physical entity. From the script worker the change is buffered and the return
+ *						value predicts whether it will be added (the attribute isn't there yet)
  *
  *********************************************************************************************/
 
 bool IPhysical::addIntAttribute(const char *attr, int value) {
+	WorldLock world;
    checkNull(_eptr);
+
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::shared_ptr<Physical> eptr = _eptr;
+		std::string attrstr(attr);
+		se.bufferCommand([eptr, attrstr, value](){ eptr->addAttribute(attrstr.c_str(), value); });
+		return !_eptr->hasAttribute(attr);
+	}
+
 	return _eptr->addAttribute(attr, value);
 }
 
 bool IPhysical::addFloatAttribute(const char *attr, float value) {
+	WorldLock world;
    checkNull(_eptr);
+
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::shared_ptr<Physical> eptr = _eptr;
+		std::string attrstr(attr);
+		se.bufferCommand([eptr, attrstr, value](){ eptr->addAttribute(attrstr.c_str(), value); });
+		return !_eptr->hasAttribute(attr);
+	}
+
    return _eptr->addAttribute(attr, value);
 }
 
 bool IPhysical::addStrAttribute(const char *attr, const char *value) {
+	WorldLock world;
    checkNull(_eptr);
+
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::shared_ptr<Physical> eptr = _eptr;
+		std::string attrstr(attr), valuestr(value);
+		se.bufferCommand([eptr, attrstr, valuestr](){ eptr->addAttribute(attrstr.c_str(), valuestr.c_str()); });
+		return !_eptr->hasAttribute(attr);
+	}
+
    return _eptr->addAttribute(attr, value);
 }
 
@@ -387,16 +510,19 @@ bool IPhysical::addStrAttribute(const char *attr, const char *value) {
  *********************************************************************************************/
 
 int IPhysical::getIntAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->getAttribInt(attr);
 }
 
 float IPhysical::getFloatAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->getAttribFloat(attr);
 }
 
 std::string IPhysical::getStrAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
 	std::string buf;
    return std::string(_eptr->getAttribStr(attr, buf));
@@ -408,6 +534,7 @@ std::string IPhysical::getStrAttribute(const char *attr) {
  *********************************************************************************************/
 
 bool IPhysical::hasAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->hasAttribute(attr);
 }
@@ -418,6 +545,7 @@ bool IPhysical::hasAttribute(const char *attr) {
  *********************************************************************************************/
 
 bool IPhysical::isEquipped(const char *name, const char *group, IPhysical &equip_ptr) {
+	WorldLock world;
    checkNull(_eptr);
 	if ((group == NULL) && (name == NULL)) {
 		throw script_error("isEquipped body part group and name both null not supported yet.");
@@ -436,6 +564,7 @@ bool IPhysical::isEquipped(const char *name, const char *group, IPhysical &equip
 }
 
 bool IPhysical::isEquippedContained(const char *name, const char *group, IContained &equip_ptr) {
+	WorldLock world;
    checkNull(_eptr);
    if ((group == NULL) && (name == NULL)) {
       throw script_error("isCEquipped body part group and name both null not supported yet.");
@@ -455,11 +584,13 @@ bool IPhysical::isEquippedContained(const char *name, const char *group, IContai
 
 
 /*********************************************************************************************
- * set/clrExit - Links a location exit to a new entity or removes an exit
+ * set/clrExit - Links a location exit to a new entity or removes an exit. From the script
+ *				worker the change is buffered and true is returned.
  *
  *********************************************************************************************/
 
 bool IPhysical::setExit(const char *exit, IPhysical &new_exit) {
+	WorldLock world;
    checkNull(_eptr);
    std::shared_ptr<Location> locptr = std::dynamic_pointer_cast<Location>(_eptr);
 
@@ -472,10 +603,19 @@ bool IPhysical::setExit(const char *exit, IPhysical &new_exit) {
 		throw script_error("addExit new_exit parameter is not a Location or Door. Cannot set exit.");
 	}
 
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::string exitstr(exit);
+		std::shared_ptr<Physical> exit_ptr = new_exit._eptr;
+		se.bufferCommand([locptr, exitstr, exit_ptr](){ locptr->setExit(exitstr.c_str(), exit_ptr); });
+		return true;
+	}
+
 	return locptr->setExit(exit, new_exit._eptr);
 }
 
 bool IPhysical::clrExit(const char *exit) {
+	WorldLock world;
    checkNull(_eptr);
    std::shared_ptr<Location> locptr = std::dynamic_pointer_cast<Location>(_eptr);
 
@@ -483,6 +623,13 @@ bool IPhysical::clrExit(const char *exit) {
       throw script_error("addExit special function called on non-Location.");
    }
 
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (se.isWorkerThread()) {
+		std::string exitstr(exit);
+		se.bufferCommand([locptr, exitstr](){ locptr->clrExit(exitstr.c_str()); });
+		return true;
+	}
+
 	return locptr->clrExit(exit);
 }
 
@@ -499,64 +646,17 @@ bool IPhysical::operator != (const IPhysical &comp) {
    return !(_eptr == comp._eptr);
 }
 
-IPhysical::iterator IPhysical::begin() 
-{ 
-   checkNull(_eptr);
-	return IPhysical::iterator(_eptr->begin()); 
-}
+/*********************************************************************************************
+ * getContents - copies the list of what this physical contains
+ *
+ *********************************************************************************************/
 
-IPhysical::iterator IPhysical::end() 
-{ 
+void IPhysical::getContents(std::vector<std::shared_ptr<Physical>> &contents) {
+	WorldLock world;
    checkNull(_eptr);
-	return IPhysical::iterator(_eptr->end()); 
-}
-
-IPhysical::iterator::iterator(std::list<std::shared_ptr<Physical>>::iterator ptr):
-																			_iptr(ptr),
-																			_cptr(nullptr)
-{
-}
-
-IPhysical::iterator::iterator(const IPhysical::iterator &copy_from):
-                                                         _iptr(copy_from._iptr),
-                                                         _cptr(copy_from._cptr)
-{
+	contents.assign(_eptr->begin(), _eptr->end());
 }
 
-IPhysical::iterator IPhysical::iterator::operator++()
-{ 
-	_iptr++; 
-	return *this; 
-};
-
-IPhysical::iterator IPhysical::iterator::operator++(int junk) 
-{ 
-	(void) junk; 
-	iterator i = *this;
-	_iptr++; 
-	return i; 
-};
-
-IContained &IPhysical::iterator::operator*() 
-{ 
-	return (_cptr = IContained(*_iptr)); 
-};
-
-IContained *IPhysical::iterator::operator->() 
-{ 
-	return &(_cptr = IContained(*_iptr)); 
-};
-
-bool IPhysical::iterator::operator == (const iterator &rhs) 
-{ 
-	return _iptr == rhs._iptr; 
-};
-
-bool IPhysical::iterator::operator != (const iterator &rhs) 
-{ 
-	return _iptr != rhs._iptr; 
-};
-
 
 /*********************************************************************************************
  * getInt/Float/StrAttribute - Returns the specified type of attribute by the given name to the
@@ -565,16 +665,19 @@ bool IPhysical::iterator::operator != (const iterator &rhs)
  *********************************************************************************************/
 
 int IContained::getIntAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->getAttribInt(attr);
 }
 
 float IContained::getFloatAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->getAttribFloat(attr);
 }
 
 std::string IContained::getStrAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
 	std::string buf;
    return std::string(_eptr->getAttribStr(attr, buf));
@@ -586,6 +689,7 @@ std::string IContained::getStrAttribute(const char *attr) {
  *********************************************************************************************/
 
 std::string IContained::getTitle() {
+	WorldLock world;
    checkNull(_eptr);
    std::string buf;
    _eptr->getGameName(buf);
@@ -598,6 +702,7 @@ std::string IContained::getTitle() {
  *********************************************************************************************/
 
 std::string IContained::getID() {
+	WorldLock world;
    checkNull(_eptr);
    return std::string(_eptr->getID());
 }
@@ -608,6 +713,7 @@ std::string IContained::getID() {
  *********************************************************************************************/
 
 bool IContained::isFlagSet(const char *flagname) {
+	WorldLock world;
    checkNull(_eptr);
 
 	bool results = false;
@@ -625,6 +731,7 @@ bool IContained::isFlagSet(const char *flagname) {
  *********************************************************************************************/
 
 bool IContained::hasAttribute(const char *attr) {
+	WorldLock world;
    checkNull(_eptr);
    return _eptr->hasAttribute(attr);
 }
@@ -650,6 +757,7 @@ IScript::IScript(const IScript &copy_from):
  *********************************************************************************************/
 
 void IScript::loadVariable(const char *varname, IPhysical &variable) {
+	WorldLock world;
 	if (!_sptr->addVariable(varname, variable._eptr)) {
 		throw script_error("Attempt to add variable to script that is already there.");		
 	}
@@ -663,6 +771,7 @@ void IScript::loadVariable(const char *varname, IPhysical &variable) {
  *********************************************************************************************/
 
 void IScript::setInterval(float interval) {
+	WorldLock world;
 	if (interval < 0) {
 		throw script_error("Attempt to set interval to a value < 0");
 	}
@@ -0,0 +1,253 @@
+#include <chrono>
+#include <algorithm>
+#include "SaveMgr.h"
+#include "TickProfiler.h"
+#include "global.h"
+
+SaveMgr::SaveMgr():
+						_writer(),
+						_pending(),
+						_writing()
+{
+
+}
+
+// The thread and queued snapshots are not copied
+SaveMgr::SaveMgr(const SaveMgr &copy_from):
+						_what(copy_from._what),
+						_writer(),
+						_pending(),
+						_writing()
+{
+
+}
+
+SaveMgr::~SaveMgr() {
+	stop();
+}
+
+/*********************************************************************************************
+ * start - launches the writer thread
+ *
+ *		Throws: runtime_error - the writer is already running
+ *
+ *********************************************************************************************/
+
+void SaveMgr::start() {
+	if (_writer != nullptr) {
+		throw std::runtime_error("SaveMgr::start - attempted to start the save writer. It is already running");
+	}
+
+	_exit_writer = false;
+	_writer.reset(new std::thread([this](){ runWriter(); }));
+}
+
+/*********************************************************************************************
+ * stop - signals the writer to exit once the queue is empty and waits for it. Unlike the auth
+ *			 workers, nothing queued is dropped--these are players' files.
+ *
+ *********************************************************************************************/
+
+void SaveMgr::stop() {
+	if (_writer == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		_exit_writer = true;
+	}
+	_queue_cond.notify_all();
+
+	_writer->join();
+	_writer.reset();
+}
+
+/*********************************************************************************************
+ * queueSave - hands a snapshot to the writer. If the player already has a snapshot waiting,
+ *				   this one replaces it since it's newer.
+ *
+ *		Params:	name - the player's name
+ *					snapshot - the data to write, encoded on the game thread
+ *
+ *		Returns: false if written right away (no writer) and that failed, otherwise true
+ *
+ *********************************************************************************************/
+
+bool SaveMgr::queueSave(const std::string &name, std::string &&snapshot) {
+	// No writer (not started or shutting down), so write it now
+	if (_writer == nullptr)
+		return writeBatch(std::vector<PlayerStore::store_record>{{name, snapshot}});
+
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+
+		auto pend_it = _pending.find(name);
+		if (pend_it != _pending.end()) {
+			pend_it->second = std::move(snapshot);
+			_coalesced_metric.add();
+			return true;
+		}
+
+		_pending.emplace(name, std::move(snapshot));
+		_pending_metric.set((int64_t) _pending.size());
+	}
+	_queue_cond.notify_one();
+	return true;
+}
+
+/*********************************************************************************************
+ * saveNow - writes a snapshot straight to the store, for saves that must be done before going
+ *				 on (a new account). Waits for any queued save of the player first so this one
+ *				 isn't overwritten by an older one.
+ *
+ *		Returns: true if saved, false (logged by the store) otherwise
+ *
+ *********************************************************************************************/
+
+bool SaveMgr::saveNow(const std::string &name, const std::string &snapshot) {
+	waitFor(name);
+
+	// A save still waiting here is one the store failed to write. This one is newer
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		if (_pending.erase(name) > 0)
+			_pending_metric.set((int64_t) _pending.size());
+	}
+	return writeBatch(std::vector<PlayerStore::store_record>{{name, snapshot}});
+}
+
+/*********************************************************************************************
+ * waitFor - waits for the writer to finish any save of the player, so it can be read back.
+ *			    Returns right away if nothing for them is queued, or if the store is failing and
+ *				 their save is waiting to be tried again, so the game doesn't hang on an outage.
+ *
+ *********************************************************************************************/
+
+void SaveMgr::waitFor(const std::string &name) {
+	std::unique_lock<std::mutex> lock(_queue_mutex);
+	_written_cond.wait(lock, [this, &name](){
+				return ((_pending.count(name) == 0) || _failing) && (_writing.count(name) == 0); });
+}
+
+/*********************************************************************************************
+ * writeBatch - saves a batch to the store, keeping the metrics
+ *
+ *********************************************************************************************/
+
+bool SaveMgr::writeBatch(const std::vector<PlayerStore::store_record> &records) {
+	auto write_start = std::chrono::steady_clock::now();
+	bool results = _store->saveBatch(records);
+	_write_metric.record(TickProfiler::elapsedUsecs(write_start, std::chrono::steady_clock::now()));
+
+	if (results)
+		_written_metric.add(records.size());
+	else
+		_failed_metric.add(records.size());
+	return results;
+}
+
+/*********************************************************************************************
+ * runWriter - the writer's loop. Takes everything waiting and saves it to the store as one
+ *				   batch, then goes back for more. Saves queued during a batch land in the next
+ *				   one, replacing each other as they come in.
+ *
+ *				   If a batch fails, its snapshots go back in the queue unless a newer one of the
+ *				   player is already there, and the writer waits before trying again, longer each
+ *				   time up to max_retry_ms. When stopping, it gives up after exit_retries more tries
+ *				   and logs who was not saved.
+ *
+ *********************************************************************************************/
+
+const unsigned int min_retry_ms = 500;
+const unsigned int max_retry_ms = 30000;
+const unsigned int exit_retries = 3;
+
+void SaveMgr::runWriter() {
+	unsigned int retry_ms = 0;
+	unsigned int exit_fails = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(_queue_mutex);
+
+			// After a failure, wait before the next try. Stopping cuts the wait short
+			if (retry_ms > 0)
+				_queue_cond.wait_for(lock, std::chrono::milliseconds(retry_ms), 
+																	[this](){ return _exit_writer; });
+
+			_queue_cond.wait(lock, [this](){ return (_exit_writer || !_pending.empty()); });
+			if (_pending.empty())
+				return;
+
+			if (_exit_writer && (exit_fails >= exit_retries)) {
+				std::string msg("SaveMgr: giving up on ");
+				msg += _what;
+				msg += " that could not be written. Not saved:";
+				for (auto pend_it = _pending.begin(); pend_it != _pending.end(); pend_it++) {
+					msg += " ";
+					msg += pend_it->first;
+				}
+				mudlog->writeLog(msg.c_str());
+				_pending.clear();
+				_pending_metric.set(0);
+				_failing = false;
+				_written_cond.notify_all();
+				return;
+			}
+
+			_writing.swap(_pending);
+			_pending_metric.set(0);
+		}
+
+		std::vector<PlayerStore::store_record> records;
+		records.reserve(_writing.size());
+		for (auto batch_it = _writing.begin(); batch_it != _writing.end(); batch_it++)
+			records.push_back(PlayerStore::store_record{batch_it->first, batch_it->second});
+		bool results = writeBatch(records);
+
+		{
+			std::lock_guard<std::mutex> lock(_queue_mutex);
+			if (!results) {
+				// Put them back, unless the player has saved again since
+				for (auto batch_it = _writing.begin(); batch_it != _writing.end(); batch_it++) {
+					if (_pending.count(batch_it->first) == 0)
+						_pending.emplace(batch_it->first, std::move(batch_it->second));
+				}
+				_pending_metric.set((int64_t) _pending.size());
+
+				retry_ms = std::min(std::max(retry_ms * 2, min_retry_ms), max_retry_ms);
+				if (_exit_writer)
+					exit_fails++;
+
+				std::string msg("SaveMgr: failed to write ");
+				msg += std::to_string(_writing.size());
+				msg += " ";
+				msg += _what;
+				msg += ", trying again in ";
+				msg += std::to_string(retry_ms);
+				msg += "ms.";
+				mudlog->writeLog(msg.c_str());
+			} else
+				retry_ms = 0;
+
+			_failing = !results;
+			_writing.clear();
+		}
+		_written_cond.notify_all();
+	}
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the save queue figures to the registry
+ *
+ *********************************************************************************************/
+
+void SaveMgr::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_saves_pending", "Player saves waiting for the save writer", _pending_metric);
+	metrics.addCounter("aime_saves_written_total", "Player saves written to the player store", _written_metric);
+	metrics.addCounter("aime_saves_coalesced_total", "Player saves replaced by a newer one before being written",
+																											_coalesced_metric);
+	metrics.addCounter("aime_save_failures_total", "Player saves that could not be written", _failed_metric);
+	metrics.addSummary("aime_save_write_usecs", "Time taken to write each batch of player saves to the store",
+																											_write_metric);
+}
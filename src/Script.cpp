@@ -162,8 +162,11 @@ int Script::execute() {
 	se.setVariableConst("interval", _interval);
 
 	// If the script exited with code 1, don't execute this script anymore
-	if (se.execute(_code.c_str()) == 1)
+	int results = se.execute(_code.c_str());
+	if (results == 1)
 		_count = 0;
+	else if (results < 0)
+		engine.getEventLog()->writeEvent(EventLog::ScriptError, getID(), se.getErrMsg());
 
 	// Needs to execute a few more times
 	if (_count > 0) {
@@ -1,10 +1,30 @@
 #include <boost/python.hpp>
 #include <iostream>
+#include <sstream>
 #include "ScriptEngine.h"
 #include "Organism.h"
+#include "Script.h"
+#include "exceptions.h"
+#include "global.h"
 
 using namespace boost::python;
 
+/*********************************************************************************************
+ * iterContents - Python's iterator over a physical's contents. It walks a copy so a script on
+ *					   the worker never holds an iterator into a list the game thread is changing
+ *
+ *********************************************************************************************/
+
+static object iterContents(IPhysical &phys) {
+	std::vector<std::shared_ptr<Physical>> contents;
+	phys.getContents(contents);
+
+	list contained;
+	for (unsigned int i=0; i<contents.size(); i++)
+		contained.append(IContained(contents[i]));
+	return contained.attr("__iter__")();
+}
+
 ScriptEngine::ScriptEngine() {
 	Py_Initialize();
 
@@ -20,11 +40,12 @@ ScriptEngine::ScriptEngine() {
 											.def("getScript", &IMUD::getScript)
 											.def("sendMsgAll", &IMUD::sendMsgAll)
 											.def("sendMsgExc", &IMUD::sendMsgExc)
-											.def("addScript", &IMUD::addScript);
+											.def("addScript", &IMUD::addScript)
+											.def("spawn", &IMUD::spawn);
    (*_main_namespace)["Physical"] = class_<IPhysical>("Physical", init<const IPhysical &>())
 											.def("__eq__", &IPhysical::operator ==)
 											.def("__ne__", &IPhysical::operator !=)
-											.def("__iter__", range(&IPhysical::begin, &IPhysical::end))
+											.def("__iter__", &iterContents)
                                  .def("sendMsg", &IPhysical::sendMsg)
                                  .def("sendMsgExc", &IPhysical::sendMsgExc)
                                  .def("damage", &IPhysical::damage)
@@ -106,29 +127,71 @@ int ScriptEngine::execute(const char *script) {
  
 int ScriptEngine::execute(std::string &script) {
 
-	initialize();
+	// Either thread may run Python once the worker is up, so always grab the GIL first
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	int results = runScript(script);
+	PyGILState_Release(gstate);
+
+	_exec_metric.add();
+	if (results < 0)
+		_error_metric.add();
+
+	return results;
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds script execution figures to the registry
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addCounter("aime_script_executions_total", "Python scripts and specials executed", _exec_metric);
+	metrics.addCounter("aime_script_errors_total", "Python scripts and specials that raised an error",
+																										_error_metric);
+}
+
+/*********************************************************************************************
+ * runScript - sets up the namespace and executes the script. The caller must hold the GIL.
+ *
+ *		Returns: 0 for success, 1 if the script exited with SystemExit(1), -1 for error
+ *
+ *********************************************************************************************/
+
+int ScriptEngine::runScript(std::string &script) {
+	script_vars &sv = vars();
+
+	// The worker runs in its own copy of the namespace. The GIL can switch threads partway
+	// through a script, so a special on the game thread must not swap out its variables
+	object ns;
+	if (isWorkerThread()) {
+		ns = dict(import("__main__").attr("__dict__"));
+		ns["MUD"] = ptr(&_access);
+	} else {
+		initialize();
+		ns = (*_main_namespace);
+	}
 
 	// Initialize some specific elements to this call 
 
-	for (unsigned int i=0; i<_variables.size(); i++) {
-		(*_main_namespace)[_variables[i].first.c_str()] = ptr(&(_variables[i].second));
+	for (unsigned int i=0; i<sv.variables.size(); i++) {
+		ns[sv.variables[i].first.c_str()] = ptr(&(sv.variables[i].second));
 	}
 
-   for (unsigned int i=0; i<_variable_ints.size(); i++) {
-      (*_main_namespace)[_variable_ints[i].first.c_str()] = _variable_ints[i].second;
+   for (unsigned int i=0; i<sv.variable_ints.size(); i++) {
+      ns[sv.variable_ints[i].first.c_str()] = sv.variable_ints[i].second;
    }
 
-   for (unsigned int i=0; i<_variable_floats.size(); i++) {
-      (*_main_namespace)[_variable_floats[i].first.c_str()] = _variable_floats[i].second;
+   for (unsigned int i=0; i<sv.variable_floats.size(); i++) {
+      ns[sv.variable_floats[i].first.c_str()] = sv.variable_floats[i].second;
    }
 
-   for (unsigned int i=0; i<_variable_strs.size(); i++) {
-      (*_main_namespace)[_variable_strs[i].first.c_str()] = _variable_strs[i].second;
+   for (unsigned int i=0; i<sv.variable_strs.size(); i++) {
+      ns[sv.variable_strs[i].first.c_str()] = sv.variable_strs[i].second;
    }
 
 	// Execute the script and handle any exceptions
 	try {
-		object ignored = exec(script.c_str(), (*_main_namespace));
+		object ignored = exec(script.c_str(), ns);
 	} catch (error_already_set &e) {
 		PyObject *type, *value, *traceback;
 		PyErr_Fetch(&type, &value, &traceback);
@@ -149,16 +212,16 @@ int ScriptEngine::execute(std::string &script) {
 		}
 
  		object formatted = str("").join(formatted_list);
-		_errmsg = extract<std::string>(formatted);
+		sv.errmsg = extract<std::string>(formatted);
 
 		// An exit telling the command to stop executing. I'm sure there's a better way
 		// to catch this exception. Unfortunately don't know it yet.
-		if (_errmsg.find("SystemExit: 1") != std::string::npos) {
+		if (sv.errmsg.find("SystemExit: 1") != std::string::npos) {
 			clearVariables();
 			return 1;
 		}
 
-		std::cout << "Err2: " << _errmsg << "\n";
+		std::cout << "Err2: " << sv.errmsg << "\n";
 		
 		PyErr_Restore(type, value, traceback);
 		clearVariables();
@@ -178,27 +241,201 @@ int ScriptEngine::execute(std::string &script) {
  *********************************************************************************************/
 
 void ScriptEngine::setVariable(const char *varname, std::shared_ptr<Physical> variable) {
-	_variables.push_back(std::pair<std::string, IPhysical>(varname, IPhysical(variable)));
+	vars().variables.push_back(std::pair<std::string, IPhysical>(varname, IPhysical(variable)));
 }
 
 void ScriptEngine::setVariableConst(const char *varname, int variable) {
 
-	_variable_ints.push_back(std::pair<std::string, int>(varname, variable));
+	vars().variable_ints.push_back(std::pair<std::string, int>(varname, variable));
 }
 
 void ScriptEngine::setVariableConst(const char *varname, float variable) {
 
-	_variable_floats.push_back(std::pair<std::string, float>(varname, variable));
+	vars().variable_floats.push_back(std::pair<std::string, float>(varname, variable));
 }
 
 void ScriptEngine::setVariableConst(const char *varname, const char *variable) {
 
-	_variable_strs.push_back(std::pair<std::string, std::string>(varname, variable));
+	vars().variable_strs.push_back(std::pair<std::string, std::string>(varname, variable));
 }
 
 void ScriptEngine::clearVariables() {
-	_variables.clear();
-	_variable_ints.clear();
-	_variable_floats.clear();
-	_variable_strs.clear();
+	script_vars &sv = vars();
+	sv.variables.clear();
+	sv.variable_ints.clear();
+	sv.variable_floats.clear();
+	sv.variable_strs.clear();
+}
+
+/*********************************************************************************************
+ * startWorker - launches the scripting thread. Once running, Script entities that come due in
+ *					  the action queue are handed to the worker instead of executing on the game
+ *					  thread. The game thread gives up the GIL here and reacquires it per script.
+ *
+ *		Throws: runtime_error - worker thread is already running
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::startWorker() {
+	if (_worker_thread != nullptr) {
+		throw std::runtime_error("ScriptEngine::startWorker - attempted to start a worker thread. One is already running");
+	}
+
+	_exit_worker = false;
+	_worker_thread = std::unique_ptr<std::thread>(new std::thread([this](){ runWorker(); }));
+
+	_main_tstate = PyEval_SaveThread();
+}
+
+/*********************************************************************************************
+ * stopWorker - signals the worker to exit, waits for it, then returns the GIL to this thread.
+ *					 Commands still sitting in the buffer are applied so nothing is lost.
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::stopWorker() {
+	if (_worker_thread == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		_exit_worker = true;
+	}
+	_queue_cond.notify_all();
+
+	// Will block until the current script finishes
+	_worker_thread->join();
+	_worker_thread.reset();
+
+	PyEval_RestoreThread(_main_tstate);
+	_main_tstate = NULL;
+
+	applyCommands();
+}
+
+/*********************************************************************************************
+ * isWorkerThread - returns true if the calling thread is the script worker
+ *
+ *********************************************************************************************/
+
+bool ScriptEngine::isWorkerThread() {
+	return ((_worker_thread != nullptr) && (_worker_thread->get_id() == std::this_thread::get_id()));
+}
+
+/*********************************************************************************************
+ * queueScript - hands a script that has come due to the worker thread
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::queueScript(std::shared_ptr<Script> sptr) {
+	{
+		std::lock_guard<std::mutex> lock(_queue_mutex);
+		_script_queue.push(sptr);
+	}
+	_queue_cond.notify_one();
+}
+
+/*********************************************************************************************
+ * runWorker - the worker thread's loop. Scripts run alongside the heartbeat without holding
+ *				   the world mutex. Each call they make into the world takes it just for that call
+ *				   (WorldLock) and their mutations go into the command buffer, which only the game
+ *				   thread applies to the world.
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::runWorker() {
+	while (true) {
+		std::shared_ptr<Script> sptr;
+		{
+			std::unique_lock<std::mutex> lock(_queue_mutex);
+			_queue_cond.wait(lock, [this](){ return (_exit_worker || !_script_queue.empty()); });
+			if (_exit_worker)
+				return;
+
+			sptr = _script_queue.front();
+			_script_queue.pop();
+		}
+
+		auto exec_start = std::chrono::steady_clock::now();
+		int results = sptr->execute();
+		uint64_t exec_usecs = TickProfiler::elapsedUsecs(exec_start, std::chrono::steady_clock::now());
+
+		// Return the script to the action queue (or let it expire) on the game thread, which
+		// owns the profiler too
+		bufferCommand([sptr, results, exec_usecs](){
+			engine.getProfiler()->recordScript(sptr->getID(), exec_usecs);
+			engine.getActionMgr()->finishScript(sptr, results);
+		});
+	}
+}
+
+/*********************************************************************************************
+ * runCommand - runs a world mutation requested by a script. On the game thread it runs right
+ *				    away, on the worker it is buffered until the game thread applies it.
+ *
+ *********************************************************************************************/
+
+void ScriptEngine::runCommand(std::function<void()> cmd) {
+	if (isWorkerThread()) {
+		bufferCommand(cmd);
+		return;
+	}
+
+	cmd();
+}
+
+void ScriptEngine::bufferCommand(std::function<void()> cmd) {
+	std::lock_guard<std::mutex> lock(_cmd_mutex);
+	_cmd_buffer.push_back(cmd);
+}
+
+/*********************************************************************************************
+ * applyCommands - called by the game thread at the start of each heartbeat to apply the
+ *					    mutations buffered by the script worker, in the order they were made
+ *
+ *		Returns: number of commands applied
+ *
+ *********************************************************************************************/
+
+unsigned int ScriptEngine::applyCommands() {
+	std::vector<std::function<void()>> commands;
+	{
+		std::lock_guard<std::mutex> lock(_cmd_mutex);
+		commands.swap(_cmd_buffer);
+	}
+
+	for (unsigned int i=0; i<commands.size(); i++) {
+		try {
+			commands[i]();
+		} catch (const script_error &e) {
+			std::stringstream errmsg;
+			errmsg << "Buffered script command failed: " << e.what();
+			mudlog->writeLog(errmsg.str().c_str());
+		}
+	}
+
+	return (unsigned int) commands.size();
+}
+
+/*********************************************************************************************
+ * WorldLock (constructor) - on the script worker, takes the world mutex. If the game thread is
+ *									  in a heartbeat, the GIL is released while waiting so the heartbeat
+ *									  can run specials, and taken back once the mutex is held.
+ *
+ *********************************************************************************************/
+
+WorldLock::WorldLock():
+						_lock()
+{
+	ScriptEngine &se = *engine.getScriptEngine();
+	if (!se.isWorkerThread())
+		return;
+
+	_lock = std::unique_lock<std::mutex>(se.getWorldMutex(), std::try_to_lock);
+	if (_lock.owns_lock())
+		return;
+
+	PyThreadState *tstate = PyEval_SaveThread();
+	_lock.lock();
+	PyEval_RestoreThread(tstate);
 }
@@ -7,6 +7,8 @@
 #include "global.h"
 #include "Getable.h"
 #include "Door.h"
+#include "Location.h"
+#include "BinRecord.h"
 
 const char *sflag_list[] = {"container", "lockable", "notcloseable", "lightable", "magiclit", "nosummon", 
 							"extinguish", "lit", "canlight", NULL};
@@ -17,15 +19,19 @@ const char *sflag_list[] = {"container", "lockable", "notcloseable", "lightable"
  *
  *********************************************************************************************/
 Static::Static(const char *id):
-								Physical(id)
+								Physical(id),
+								_desc(std::make_shared<static_desc>())
 {
 	_typename = "Static";
 
 }
 
-// Copy constructor
+// Copy constructor - the descriptions are shared until one of the two changes them
 Static::Static(const Static &copy_from):
-								Physical(copy_from)
+								Physical(copy_from),
+								_desc(copy_from._desc),
+								_staticflags(copy_from._staticflags),
+								_state(copy_from._state)
 {
 
 }
@@ -111,7 +117,7 @@ int Static::loadData(pugi::xml_node &entnode) {
          mudlog->writeLog(errmsg.str().c_str());
          return 0;
       }		
-		_altnames.push_back(attr.value());
+		addAltName(attr.value());
    }
 
    // Get the Static Flags (if any)
@@ -154,7 +160,7 @@ int Static::loadData(pugi::xml_node &entnode) {
          return 0;
       }
 
-      _keys.push_back(attr.value());
+      writableCopy(_desc).keys.push_back(attr.value());
 
    }
  
@@ -168,19 +174,19 @@ int Static::loadData(pugi::xml_node &entnode) {
  *********************************************************************************************/
 
 void Static::setExamine(const char *newexamine) {
-	_examine = newexamine;
+	writableCopy(_desc).examine = newexamine;
 }
 
 void Static::setStartLoc(const char *newloc) {
-   _startloc = newloc;
+   writableCopy(_desc).startloc = newloc;
 }
 
 void Static::addAltName(const char *names) {
-   _altnames.push_back(names);
+   writableCopy(_desc).altnames.push_back(names);
 }
 
 void Static::setTitle(const char *newtitle) {
-	_title = newtitle;
+	writableCopy(_desc).title = newtitle;
 }
 
 
@@ -205,6 +211,11 @@ bool Static::setFlagInternal(const char *flagname, bool newval) {
    if (sflag_list[i] == NULL)
       return false;
 
+	if (i == Lit) {
+		setLit(true);
+		return true;
+	}
+
    _staticflags[i] = true;
    return true;
 }
@@ -250,10 +261,11 @@ bool Static::isFlagSetInternal(const char *flagname, bool &results) {
 bool Static::hasAltName(const char *str, bool allow_abbrev) {
 	std::string buf = str;
 
-	for (unsigned int i=0; i<_altnames.size(); i++) {
-		if ((!allow_abbrev) && (buf.compare(_altnames[i]) == 0))
+	const std::vector<std::string> &altnames = _desc->altnames;
+	for (unsigned int i=0; i<altnames.size(); i++) {
+		if ((!allow_abbrev) && (buf.compare(altnames[i]) == 0))
 			return true;
-		else if ((allow_abbrev) && equalAbbrev(buf, _altnames[i].c_str()))
+		else if ((allow_abbrev) && equalAbbrev(buf, altnames[i].c_str()))
 			return true;
 	}
 	return false;
@@ -270,15 +282,15 @@ void Static::addLinks(EntityDB &edb, std::shared_ptr<Physical> self) {
    std::stringstream msg;
 
 	// If startloc == "none", then it starts in limbo
-	if (_startloc.compare("none") == 0) {
+	if (_desc->startloc.compare("none") == 0) {
 		return;
 	}
 
 	// Place this at its start location
-   std::shared_ptr<Physical> entptr = edb.getPhysical(_startloc.c_str());
+   std::shared_ptr<Physical> entptr = edb.getPhysical(_desc->startloc.c_str());
 
 	if (entptr == nullptr) {
-		msg << "WARNING: Object '" << getID() << "' startloc '" << _startloc << "' doesn't appear to exist.";
+		msg << "WARNING: Object '" << getID() << "' startloc '" << _desc->startloc << "' doesn't appear to exist.";
       mudlog->writeLog(msg.str().c_str());
 		return;
    } 
@@ -312,6 +324,20 @@ const char *Static::listContents(std::string &buf, const Physical *exclude) cons
    return buf.c_str();
 }
 
+/*********************************************************************************************
+ * setDoorState - changes the door state, letting the room know its description changed
+ *
+ *********************************************************************************************/
+
+void Static::setDoorState(doorstate new_state) {
+	if (_state == new_state)
+		return;
+
+	_state = new_state;
+	renderChanged();
+	stateChanged();
+}
+
 /*********************************************************************************************
  * setDoorState - changes the door state given a string as the parameter
  *
@@ -409,7 +435,7 @@ bool Static::light(std::string &errmsg) {
 		return false;
 	}
 
-	_staticflags[Lit] = true;
+	setLit(true);
 	return true;	
 }
 
@@ -425,10 +451,62 @@ bool Static::extinguish(std::string &errmsg) {
 		return false;
 	}
 
-	_staticflags[Lit] = false;
+	setLit(false);
 	return true;
 }
 
+/*********************************************************************************************
+ * setLit - sets or clears the Lit flag. Whatever contains this object tracks how many lit
+ *				things it holds, so it is told when the state changes.
+ *
+ *********************************************************************************************/
+
+void Static::setLit(bool lit) {
+	if (_staticflags[Lit] == lit)
+		return;
+
+	_staticflags[Lit] = lit;
+
+	std::shared_ptr<Physical> cur_loc = getCurLoc();
+	if (cur_loc != nullptr)
+		cur_loc->changeLitCount(lit ? 1 : -1);
+	renderChanged();
+	stateChanged();
+}
+
+/*********************************************************************************************
+ * renderChanged - drops the cached description blocks of the location this is sitting in
+ *
+ *********************************************************************************************/
+
+void Static::renderChanged() {
+	std::shared_ptr<Location> locptr = std::dynamic_pointer_cast<Location>(getCurLoc());
+	if (locptr != nullptr)
+		locptr->invalidateRender(Location::RenderExits | Location::RenderContents);
+}
+
+
+/*********************************************************************************************
+ * saveState/loadState - adds the door/container state and whether it's lit to what world
+ *								 checkpoints keep
+ *
+ *********************************************************************************************/
+
+void Static::saveState(RecordWriter &rec) const {
+	Physical::saveState(rec);
+	rec.putVarint((uint64_t) _state);
+	rec.putVarint(_staticflags[Lit] ? 1 : 0);
+}
+
+void Static::loadState(RecordReader &rec, EntityDB &edb) {
+	Physical::loadState(rec, edb);
+
+	uint64_t state = rec.getVarint();
+	if (state > (uint64_t) Special)
+		throw record_error("door state out of range");
+	setDoorState((doorstate) state);
+	setLit(rec.getVarint() != 0);
+}
 
 /*********************************************************************************************
  * getGameName - fills the buffer with the primary name that the game refers to this entity.
@@ -7,10 +7,13 @@
 #include "TCPConn.h"
 #include "misc.h"
 
+MetricCounter TCPConn::_total_in_metric;
+MetricCounter TCPConn::_total_out_metric;
+
 TCPConn::TCPConn():
 					_connfd(),
 					_inputbuf(""),
-					_outputbuf("")
+					_outputbuf()
 {
 
 }
@@ -69,7 +72,16 @@ int TCPConn::sendText(const char *msg) {
 
 void TCPConn::addOutput(const char *msg) {
 	std::lock_guard<std::mutex> guard(_conn_mutex);
-	_outputbuf += msg;
+
+	if ((_outputbuf.size() > 0) && (_outputbuf.back().use_count() == 1))
+		*(_outputbuf.back()) += msg;
+	else
+		_outputbuf.push_back(std::make_shared<std::string>(msg));
+}
+
+void TCPConn::addOutput(std::shared_ptr<std::string> msg) {
+	std::lock_guard<std::mutex> guard(_conn_mutex);
+	_outputbuf.push_back(msg);
 }
 
 
@@ -90,8 +102,9 @@ ssize_t TCPConn::handleConnection(time_t timeout) {
 
 	// If the connection is marked as closing, flush the buffers and mark as closed
 	if (_status == Closing) {
-		if (_outputbuf.size() > 0)
-			_connfd.writeFD(_outputbuf);
+		for (unsigned int i=0; i<_outputbuf.size(); i++)
+			_connfd.writeFD(*(_outputbuf[i]));
+		_outputbuf.clear();
 		_connfd.closeFD();
 		_status = Closed;
 		return 0;
@@ -108,6 +121,7 @@ ssize_t TCPConn::handleConnection(time_t timeout) {
 	}
 
 	ssize_t count = 0;
+	ssize_t written = 0;
 	std::string readbuf;
 
 	if (_status != Active)
@@ -128,12 +142,16 @@ ssize_t TCPConn::handleConnection(time_t timeout) {
 
 	// Now write any data in the outputbuf to the connection
 	if (hasOutput()) {
-		_connfd.writeFD(_prewrite);
-		_connfd.writeFD(_outputbuf);
-		_connfd.writeFD(_postwrite);
+		written += std::max(_connfd.writeFD(_prewrite), (ssize_t) 0);
+		for (unsigned int i=0; i<_outputbuf.size(); i++)
+			written += std::max(_connfd.writeFD(*(_outputbuf[i])), (ssize_t) 0);
+		written += std::max(_connfd.writeFD(_postwrite), (ssize_t) 0);
 		_outputbuf.clear();
 	}
 
+	_total_in_metric.add((uint64_t) count);
+	_total_out_metric.add((uint64_t) written);
+
 	return count;
 }
 
@@ -217,3 +235,27 @@ void TCPConn::setPostWrite(const char *str) {
 	_postwrite = str;
 }
 
+/**********************************************************************************************
+ * swapPrompt - installs new pre/post write strings together so output never goes out with a
+ *					 mismatched pair. The parameters are swapped with the old values.
+ *
+ **********************************************************************************************/
+
+void TCPConn::swapPrompt(std::string &prewrite, std::string &postwrite) {
+	std::lock_guard<std::mutex> guard(_conn_mutex);
+
+	_prewrite.swap(prewrite);
+	_postwrite.swap(postwrite);
+}
+
+/**********************************************************************************************
+ * registerMetrics - adds the network traffic totals to the metrics registry
+ *
+ **********************************************************************************************/
+
+void TCPConn::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addCounter("aime_net_bytes_in_total", "Bytes received from player connections", 
+																									_total_in_metric);
+	metrics.addCounter("aime_net_bytes_out_total", "Bytes sent to player connections", 
+																									_total_out_metric);
+}
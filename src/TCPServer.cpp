@@ -16,13 +16,22 @@
 
 TCPServer::TCPServer():
 								_sockfd(),
-								_use_accesslist(false),
-								_whitelist(false),
-								_whitelist_file("")
+								_accesslist(),
+								_connect_throttle()
 {
 }
 
 
+TCPServer::TCPServer(const TCPServer &copy_from):
+								_sockfd(copy_from._sockfd),
+								_accesslist(),
+								_connect_throttle(copy_from._connect_throttle)
+{
+	if (copy_from._accesslist != nullptr)
+		_accesslist.reset(new ALMgr(*copy_from._accesslist));
+}
+
+
 TCPServer::~TCPServer() {
 
 }
@@ -82,6 +91,7 @@ TCPConn *TCPServer::handleSocket() {
       TCPConn *new_conn = new TCPConn();
       if (!new_conn->accept(_sockfd)) {
          mudlog->strerrLog("Data received on listening socket but accept failed.");
+         delete new_conn;
          return NULL;
       }
 
@@ -91,17 +101,19 @@ TCPConn *TCPServer::handleSocket() {
 
 	
 		// If we need to check this IP address for validity	
-		if (_use_accesslist) {
-			// Check the whitelist
-			ALMgr al(_whitelist_file.c_str(), _whitelist);
+		if (_accesslist != nullptr) {
+			// Pick up any edits to the list
+			_accesslist->checkReload();
 
 			// TODO: Need to also add DNS lookup for the whitelist
 
 			// Check the IP address to see if it's allowed
-			if (!al.isAllowed(new_conn->getIPAddr()))
+			if (!_accesslist->isAllowed(new_conn->getIPAddr()))
 			{
 				// Disconnect the user
 				new_conn->startDisconnect();
+				new_conn->handleConnection(0);
+				delete new_conn;
 
 				// Log their attempted connection
 				std::string msg = "Connection by IP address '";
@@ -113,6 +125,20 @@ TCPConn *TCPServer::handleSocket() {
 			}
 		}
 
+		// Turn away addresses opening connections faster than allowed
+		if (!_connect_throttle.allow(new_conn->getIPAddr())) {
+			new_conn->startDisconnect();
+			new_conn->handleConnection(0);
+			delete new_conn;
+
+			std::string msg = "Connection by IP address '";
+			msg += ipaddr_str;
+			msg += "' refused, connecting too fast.";
+			mudlog->writeLog(msg, 2);
+
+			return NULL;
+		}
+
       std::string msg = "Connection from IP address '";
       msg += ipaddr_str;
       msg += "'.";
@@ -125,6 +151,27 @@ TCPConn *TCPServer::handleSocket() {
    return NULL;
 }
 
+/**********************************************************************************************
+ * setAccessList - compiles the access list file and starts checking new connections against it
+ *
+ *    Params:  al_file - the list file, re-read whenever it changes
+ *             is_whitelist - true to only allow listed addresses, false to block them
+ **********************************************************************************************/
+
+void TCPServer::setAccessList(const char *al_file, bool is_whitelist) {
+	_accesslist.reset(new ALMgr(al_file, is_whitelist));
+	_accesslist->loadList();
+}
+
+/**********************************************************************************************
+ * setConnectLimit - sets how many connections per second each IP address may open, with burst
+ *                   the most it can open at once
+ **********************************************************************************************/
+
+void TCPServer::setConnectLimit(float rate, float burst) {
+	_connect_throttle.configure(rate, burst);
+}
+
 /**********************************************************************************************
  * handleConnections - Loops through the list of clients, running their functions to handle the
  *                     clients input/output.
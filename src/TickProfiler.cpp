@@ -0,0 +1,186 @@
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include "TickProfiler.h"
+#include "LogMgr.h"
+#include "global.h"
+
+const char *phase_names[] = {"apply cmds", "auth results", "users", "npcs", "actions", "checkpoint", "heartbeat", NULL};
+
+TickProfiler::TickProfiler():
+								_actions(),
+								_scripts(),
+								_window_start(std::chrono::steady_clock::now())
+{
+
+}
+
+TickProfiler::TickProfiler(const TickProfiler &copy_from):
+								_actions(copy_from._actions),
+								_scripts(copy_from._scripts),
+								_window_overruns(copy_from._window_overruns),
+								_worst_overrun(copy_from._worst_overrun),
+								_total_overruns(copy_from._total_overruns),
+								_report_secs(copy_from._report_secs),
+								_window_start(copy_from._window_start)
+{
+	for (unsigned int i=0; i<NumPhases; i++)
+		_phases[i] = copy_from._phases[i];
+}
+
+TickProfiler::~TickProfiler() {
+
+}
+
+/*********************************************************************************************
+ * recordPhase/recordAction/recordScript - add a timing to the matching histogram
+ *
+ *    Params:  phase/id - what was timed
+ *             usecs - how long it took in microseconds
+ *
+ *********************************************************************************************/
+
+void TickProfiler::recordPhase(tick_phases phase, uint64_t usecs) {
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	_phases[phase].record(usecs);
+}
+
+void TickProfiler::recordAction(const std::string &id, uint64_t usecs) {
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	_actions[id].record(usecs);
+}
+
+void TickProfiler::recordScript(const std::string &id, uint64_t usecs) {
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	_scripts[id].record(usecs);
+}
+
+/*********************************************************************************************
+ * recordTick - records the length of a whole heartbeat and tracks overruns
+ *
+ *    Params:  usecs - how long the heartbeat's work took
+ *             allowed_usecs - the time between heartbeats
+ *
+ *********************************************************************************************/
+
+void TickProfiler::recordTick(uint64_t usecs, uint64_t allowed_usecs) {
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	_phases[Tick].record(usecs);
+
+	if (usecs <= allowed_usecs)
+		return;
+
+	_window_overruns++;
+	_total_overruns++;
+	if (usecs - allowed_usecs > _worst_overrun)
+		_worst_overrun = usecs - allowed_usecs;
+}
+
+/*********************************************************************************************
+ * checkReport - once the report interval has passed, logs the report and starts a new window
+ *
+ *********************************************************************************************/
+
+void TickProfiler::checkReport() {
+	if (_report_secs == 0)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - _window_start < std::chrono::seconds(_report_secs))
+		return;
+
+	std::string buf;
+	getReport(buf);
+	mudlog->writeLog(buf, 1);
+
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	resetWindow();
+}
+
+/*********************************************************************************************
+ * resetWindow - clears the window figures. The overall overrun count is kept.
+ *
+ *********************************************************************************************/
+
+void TickProfiler::resetWindow() {
+	for (unsigned int i=0; i<NumPhases; i++)
+		_phases[i].reset();
+	_actions.clear();
+	_scripts.clear();
+	_window_overruns = 0;
+	_worst_overrun = 0;
+	_window_start = std::chrono::steady_clock::now();
+}
+
+/*********************************************************************************************
+ * getReport - formats the timings for the current window: each phase, then the actions and
+ *				   scripts that used the most total time
+ *
+ *    Params:  buf - populated with the report
+ *             max_entries - the most actions and scripts to list
+ *
+ *		Returns: pointer to the string in buf
+ *
+ *********************************************************************************************/
+
+const char *TickProfiler::getReport(std::string &buf, unsigned int max_entries) {
+	std::lock_guard<std::mutex> guard(_prof_mutex);
+	std::stringstream report;
+
+	auto window = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - 
+																										_window_start);
+	report << "Tick profile for the last " << window.count() << "s: " << _phases[Tick].getCount() 
+			 << " heartbeats, " << _window_overruns << " overruns (worst by " << _worst_overrun 
+			 << "us), " << _total_overruns << " overruns since boot\n";
+
+	report << std::left << std::setw(24) << "   phase" << std::right << std::setw(10) << "count" 
+			 << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" 
+			 << std::setw(10) << "max" << "  (usec)\n";
+	for (unsigned int i=0; i<NumPhases; i++) {
+		const Histogram &h = _phases[i];
+		report << "   " << std::left << std::setw(21) << phase_names[i] << std::right 
+				 << std::setw(10) << h.getCount() << std::setw(10) << h.getPercentile(50) 
+				 << std::setw(10) << h.getPercentile(90) << std::setw(10) << h.getPercentile(99) 
+				 << std::setw(10) << h.getMax() << "\n";
+	}
+	buf = report.str();
+
+	formatEntries(buf, "actions", _actions, max_entries);
+	formatEntries(buf, "scripts", _scripts, max_entries);
+	return buf.c_str();
+}
+
+/*********************************************************************************************
+ * formatEntries - appends the entries with the most total time to the report
+ *
+ *********************************************************************************************/
+
+void TickProfiler::formatEntries(std::string &buf, const char *heading,
+								const std::map<std::string, Histogram> &entries, unsigned int max_entries) {
+	if (entries.size() == 0)
+		return;
+
+	std::vector<std::map<std::string, Histogram>::const_iterator> sorted;
+	for (auto it = entries.begin(); it != entries.end(); it++)
+		sorted.push_back(it);
+
+	std::sort(sorted.begin(), sorted.end(), [](std::map<std::string, Histogram>::const_iterator a,
+																std::map<std::string, Histogram>::const_iterator b) {
+		return a->second.getTotal() > b->second.getTotal();
+	});
+
+	std::stringstream report;
+	report << std::left << std::setw(24) << (std::string("   ") + heading) << std::right 
+			 << std::setw(10) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" 
+			 << std::setw(10) << "max" << std::setw(10) << "total" << "  (usec)\n";
+
+	for (unsigned int i=0; (i<sorted.size()) && (i<max_entries); i++) {
+		const Histogram &h = sorted[i]->second;
+		report << "   " << std::left << std::setw(21) << sorted[i]->first << std::right 
+				 << std::setw(10) << h.getCount() << std::setw(10) << h.getPercentile(50) 
+				 << std::setw(10) << h.getPercentile(99) << std::setw(10) << h.getMax() 
+				 << std::setw(10) << h.getTotal() << "\n";
+	}
+	buf += report.str();
+}
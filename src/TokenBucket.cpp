@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "TokenBucket.h"
+
+TokenBucket::TokenBucket(float rate, float burst):
+								_rate(rate),
+								_burst(burst),
+								_tokens(burst),
+								_last_refill(std::chrono::steady_clock::now())
+{
+
+}
+
+TokenBucket::TokenBucket(const TokenBucket &copy_from):
+								_rate(copy_from._rate),
+								_burst(copy_from._burst),
+								_tokens(copy_from._tokens),
+								_last_refill(copy_from._last_refill)
+{
+
+}
+
+TokenBucket::~TokenBucket() {
+
+}
+
+/*********************************************************************************************
+ * configure - sets the limits of this bucket and starts it off full
+ *
+ *    Params:  rate - tokens added per second. 0 turns the limiting off
+ *             burst - the most tokens the bucket can hold
+ *
+ *********************************************************************************************/
+
+void TokenBucket::configure(float rate, float burst) {
+	_rate = rate;
+	_burst = burst;
+	_tokens = burst;
+	_last_refill = std::chrono::steady_clock::now();
+}
+
+/*********************************************************************************************
+ * available - tops up the bucket for the time passed since the last check
+ *
+ *    Returns: true if the balance is positive (or there is no limit), false otherwise
+ *
+ *********************************************************************************************/
+
+bool TokenBucket::available() {
+	if (_rate <= 0.0)
+		return true;
+
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<float> elapsed = now - _last_refill;
+	_last_refill = now;
+
+	_tokens = std::min(_burst, _tokens + (elapsed.count() * _rate));
+	return (_tokens > 0.0);
+}
@@ -1,8 +1,14 @@
 #include <libconfig.h++>
 #include <iostream>
+#include <climits>
+#include <algorithm>
+#include <unordered_set>
 #include <boost/lexical_cast.hpp>
 #include "UserMgr.h"
+#include "FileStore.h"
+#include "LogStore.h"
 #include "EntityDB.h"
+#include "Broadcast.h"
 #include "MUD.h"
 #include "misc.h"
 #include "global.h"
@@ -15,6 +21,9 @@ namespace lc = libconfig;
  *********************************************************************************************/
 UserMgr::UserMgr():
 					_db(),
+					_net_players(),
+					_ready(),
+					_incoming(),
 					_listen_sock(),
 					_newuser_idx(0),
 					_listening_thread(nullptr),
@@ -28,6 +37,9 @@ UserMgr::UserMgr():
 
 UserMgr::UserMgr(const UserMgr &copy_from):
 					_db(copy_from._db),
+					_net_players(),
+					_ready(),
+					_incoming(),
 					_listen_sock(copy_from._listen_sock),
 					_newuser_idx(copy_from._newuser_idx),
 					_listening_thread(nullptr),
@@ -60,6 +72,84 @@ void UserMgr::initialize(lc::Config &cfg_info) {
 	cfg_info.lookupValue("network.conn_timeout", timeval);
 	_conn_timeout = (time_t) timeval;
 
+	cfg_info.lookupValue("gameplay.cmd_rate", _cmd_rate);
+	cfg_info.lookupValue("gameplay.cmd_burst", _cmd_burst);
+	if (_cmd_burst < 1.0) {
+		mudlog->writeLog("ERROR - Config setting cmd_burst is less than 1 and invalid. Defaulting to 1.\n");
+		_cmd_burst = 1.0;
+	}
+
+	// Who may connect, and how fast any one address may connect and try passwords
+	bool whitelist = false;
+	std::string al_file;
+	cfg_info.lookupValue("network.whitelist", whitelist);
+	cfg_info.lookupValue("network.accesslist_file", al_file);
+	if (al_file.size() > 0)
+		_listen_sock.setAccessList(al_file.c_str(), whitelist);
+
+	float connect_rate = 0.0, connect_burst = 1.0;
+	cfg_info.lookupValue("network.connect_rate", connect_rate);
+	cfg_info.lookupValue("network.connect_burst", connect_burst);
+	_listen_sock.setConnectLimit(connect_rate, std::max(connect_burst, 1.0f));
+
+	float auth_rate = 0.0, auth_burst = 1.0;
+	cfg_info.lookupValue("network.auth_rate", auth_rate);
+	cfg_info.lookupValue("network.auth_burst", auth_burst);
+	_auth_throttle.configure(auth_rate, std::max(auth_burst, 1.0f));
+
+	// Where accounts are kept. The log store falls back on the user directory for players it
+	// doesn't have yet, so switching over needs no conversion
+	std::string store_type("file");
+	cfg_info.lookupValue("datadir.userstore", store_type);
+	if (store_type == "log") {
+		std::string userdb;
+		cfg_info.lookupValue("datadir.userdb", userdb);
+
+		int compact_mb = 1, compact_dead = 50;
+		cfg_info.lookupValue("datadir.userdb_compact_mb", compact_mb);
+		cfg_info.lookupValue("datadir.userdb_compact_dead", compact_dead);
+
+		LogStore *logstore = new LogStore(userdb.c_str(), new FileStore(_userdir.c_str()));
+		logstore->setCompaction((uint64_t) std::max(compact_mb, 0) << 20, 
+																	(unsigned int) std::min(std::max(compact_dead, 1), 100));
+		_store.reset(logstore);
+	} else {
+		if (store_type != "file") {
+			std::string msg("Unknown datadir.userstore '");
+			msg += store_type;
+			msg += "', using the file store.";
+			mudlog->writeLog(msg);
+		}
+		_store.reset(new FileStore(_userdir.c_str()));
+	}
+
+	// Carrying on without the store would make every account look new
+	if (!_store->open())
+		throw std::runtime_error("UserMgr::initialize - unable to open the player store. See the log for details.");
+	_saves.setStore(_store.get());
+
+	cfg_info.lookupValue("misc.autosave_secs", _autosave_secs);
+	cfg_info.lookupValue("misc.heartbeat_per_sec", _heartbeat_per_sec);
+	_heartbeat_per_sec = std::max(_heartbeat_per_sec, 1U);
+
+	if (!_saves.isRunning())
+		_saves.start();
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds this class's metrics (and the network totals) to the registry
+ *
+ *********************************************************************************************/
+
+void UserMgr::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_players_connected", "Players connected, including those logging in",
+																									_players_metric);
+	metrics.addCounter("aime_connections_total", "Connections accepted", _connects_metric);
+	metrics.addCounter("aime_commands_total", "Player commands handled", _commands_metric);
+	TCPConn::registerMetrics(metrics);
+	_saves.registerMetrics(metrics);
+	if (_store != nullptr)
+		_store->registerMetrics(metrics);
 }
 
 /*********************************************************************************************
@@ -112,6 +202,24 @@ void UserMgr::startListeningThread(lc::Config &cfg_info) {
 
 	_exit_listening_thread = false;
 
+	// The metrics endpoint, if configured, is polled along with the player connections
+	int metrics_port = 0;
+	cfg_info.lookupValue("network.metrics_port", metrics_port);
+	if ((metrics_port > 0) && (metrics_port <= 65535)) {
+		std::string metrics_ip("127.0.0.1");
+		cfg_info.lookupValue("network.metrics_ip_addr", metrics_ip);
+
+		_metrics_svr.reset(new MetricsServer(*engine.getMetrics()));
+		try {
+			_metrics_svr->bindSvr(metrics_ip.c_str(), (unsigned short) metrics_port);
+		} catch (const socket_error &e) {
+			std::string msg("Metrics endpoint disabled: ");
+			msg += e.what();
+			mudlog->writeLog(msg);
+			_metrics_svr.reset();
+		}
+	}
+
 	// ******* Lambda function for launching the thread ********
 	_listening_thread = std::unique_ptr<std::thread>(new std::thread(
 									[this, listening_loop, &cfg_info](){
@@ -124,11 +232,22 @@ void UserMgr::startListeningThread(lc::Config &cfg_info) {
 
 			// Check the listening socket for new connections
 			checkNewUsers(cfg_info);
+
+			if (_metrics_svr != nullptr)
+				_metrics_svr->handleRequests();
 	
-			// Loop through our players, handling their connection data	
-			auto user_it = _db.begin();
-			for (; user_it != _db.end(); user_it++) {
-				user_it->second->handleConnection(_conn_timeout);		
+			// Loop through our connections, handing players with new commands or a changed
+			// connection to the game thread. Closed connections are dropped from our list once
+			// they have been handed over.
+			auto user_it = _net_players.begin();
+			while (user_it != _net_players.end()) {
+				if ((*user_it)->handleConnection(_conn_timeout))
+					markActive(*user_it);
+
+				if ((*user_it)->getConnStatus() == TCPConn::Closed)
+					user_it = _net_players.erase(user_it);
+				else
+					user_it++;
 			}
 			
 			// Sleep the appropriate interval
@@ -151,6 +270,7 @@ void UserMgr::stopListeningThread() {
 	// Will block until the thread exits
 	_listening_thread->join();
 	_listening_thread.reset();
+	_metrics_svr.reset();
 }
 
 
@@ -168,6 +288,11 @@ void UserMgr::checkNewUsers(libconfig::Config &mud_cfg){
 
 	// While there's a new connection on the socket
 	while ((new_conn = _listen_sock.handleSocket()) != NULL) {
+		std::string ipaddr;
+		new_conn->getIPAddrStr(ipaddr);
+		engine.getEventLog()->writeEvent(EventLog::Connect, ipaddr.c_str());
+		_connects_metric.add();
+
 		// Assign a rolling number for new users as userID
 		std::string userid("player:newuser" + boost::lexical_cast<std::string>(_newuser_idx++));
 	
@@ -175,41 +300,86 @@ void UserMgr::checkNewUsers(libconfig::Config &mud_cfg){
 		std::shared_ptr<Player> new_plr(new Player(userid.c_str(), std::unique_ptr<TCPConn>{new_conn}));
 		new_plr->setSelfPtr(new_plr);
 
-		_db.insert(std::pair<std::string, std::shared_ptr<Player>>(userid, new_plr));
-
 		new_plr->welcomeUser(mud_cfg, new_plr);
 
+		// We service the connection, the game thread adds them to the player list
+		_net_players.push_back(new_plr);
+
+		std::lock_guard<std::mutex> guard(_ready_mutex);
+		_incoming.push_back(new_plr);
+		_ready.push_back(new_plr);
+
 	}
 }
 
 
 /*********************************************************************************************
- * handleUsers - Loops through all users, performing maintenance and executing their next
- *					  command via their handler
+ * handleUsers - Visits the users that have pending work (a command or a connection change),
+ *					  performing maintenance and executing their next command via their handler.
+ *					  Idle players are not touched.
  *
- *		Params:	actions - used to lookup Actions and place new ones in the queue based on user
- *							    input.
+ *		Params:	cfg_info - the MUD config, for the start location
+ *					edb - used to look up the start location of players who just logged in
+ *					deadline - when this heartbeat's time for players runs out. Players not reached
+ *								  by then are first in line next heartbeat.
  *
  *********************************************************************************************/
 
-void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb){
+void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb,
+												std::chrono::system_clock::time_point deadline){
+	std::vector<std::shared_ptr<Player>> ready;
+	std::vector<std::shared_ptr<Player>> incoming;
 
-	// Loop through the players
-	auto plr_it = _db.begin();
-	while (plr_it != _db.end()) {
-		Player &plr = (*plr_it->second);
+	// Grab the work the listening thread has queued up
+	{
+		std::lock_guard<std::mutex> guard(_ready_mutex);
+		ready.swap(_ready);
+		incoming.swap(_incoming);
+	}
 
-		// If the connection is closed, remove the player
-		if (plr_it->second->getConnStatus() == TCPConn::Closed) {
-			plr_it = _db.erase(plr_it);
+	for (unsigned int i=0; i<incoming.size(); i++) {
+		incoming[i]->getCmdBucket().configure(_cmd_rate, _cmd_burst);
+		_db.insert(std::pair<std::string, std::shared_ptr<Player>>(incoming[i]->getID(), incoming[i]));
+	}
+
+	// A player may have been queued more than once--keep the first, preserving the order
+	std::unordered_set<Player *> seen;
+	auto dup_it = std::remove_if(ready.begin(), ready.end(), 
+							[&seen](const std::shared_ptr<Player> &p) { return !seen.insert(p.get()).second; });
+	ready.erase(dup_it, ready.end());
+
+	for (unsigned int i=0; i<ready.size(); i++) {
+
+		// Out of time this heartbeat, put whoever is left at the front of the line
+		if (std::chrono::system_clock::now() >= deadline) {
+			std::lock_guard<std::mutex> guard(_ready_mutex);
+			_ready.insert(_ready.begin(), ready.begin() + i, ready.end());
+			break;
 		}
 
-		// Update the player prompts
-		plr.updatePrompt();
+		std::shared_ptr<Player> pptr = ready[i];
+		Player &plr = *pptr;
+
+		// If the connection is closed, save them if they were in the game and remove the player
+		if (plr.getConnStatus() == TCPConn::Closed) {
+			if (plr.getCurLoc() != nullptr)
+				saveUser(plr);
+			engine.getEventLog()->writeEvent(EventLog::Disconnect, plr.getID());
+			removeOnline(plr);
+			_db.erase(plr.getID());
+			continue;
+		}
+
+		// Used up their command allowance--the command stays queued until they earn more
+		if (!plr.getCmdBucket().available()) {
+			markActive(pptr);
+			continue;
+		}
 
 		std::string cmd;
 		if (plr.popCommand(cmd)) {
 			int results;
+			_commands_metric.add();
 
 			// If the handler returns other than 0, then we need to do something
 			if ((results = plr.handleCommand(cmd)) > 0) {
@@ -226,15 +396,14 @@ void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb){
 						std::string userkey("player:");
 						userkey += hresults[1];
 
-						// Make sure this doesn't get destroyed
-						std::shared_ptr<Player> pptr = plr_it->second;
-
 						// Erase this player from the user list
-						plr_it = _db.erase(plr_it);
+						_db.erase(plr.getID());
 		
 						// Now re-add the player with their actual name
 						plr.setID(userkey.c_str());
-						auto newplr_it = _db.insert(std::pair<std::string, std::shared_ptr<Player>>(userkey, pptr));
+						_db.insert(std::pair<std::string, std::shared_ptr<Player>>(userkey, pptr));
+						addOnline(pptr);
+						engine.getEventLog()->writeEvent(EventLog::Login, userkey.c_str());
 
 						std::string startloc;
 						cfg_info.lookupValue("gameplay.startloc", startloc);
@@ -248,15 +417,10 @@ void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb){
 							
 							// Add code to boot the player
 							plr.sendMsg("Unable to assign you to a start location. Login failed.\n");
-							continue;	
+						} else {
+							plr.movePhysical(curloc, pptr);
+							plr.sendCurLocation();
 						}
-			
-						plr.movePhysical(curloc, newplr_it.first->second);
-
-
-						plr.sendCurLocation();
-//						plr.sendPrompt();
-						continue;	
 					}
 				}
 				else {
@@ -266,13 +430,64 @@ void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb){
 				}
 
 			}
-
-			
 		}
-		plr_it++;
+
+		// Update the player prompt if the command marked it dirty
+		plr.updatePrompt();
+
+		// One command per player per pass--come back next time if there are more
+		if (plr.hasCommands())
+			markActive(pptr);
+	}
+
+	autosave();
+	_players_metric.set((int64_t) _db.size());
+}
+
+/*********************************************************************************************
+ * autosave - saves this heartbeat's share of the players so a full pass through everyone in
+ *				  the game takes autosave_secs, rather than saving them all on the same heartbeat.
+ *				  Players still logging in are skipped.
+ *
+ *********************************************************************************************/
+
+void UserMgr::autosave() {
+	if ((_autosave_secs == 0) || (_db.size() == 0))
+		return;
+
+	_autosave_credit += (float) _db.size() / (float) (_autosave_secs * _heartbeat_per_sec);
+
+	// Never more than one pass in a heartbeat
+	_autosave_credit = std::min(_autosave_credit, (float) _db.size());
+
+	while (_autosave_credit >= 1.0) {
+		_autosave_credit -= 1.0;
+
+		// Pick up after whoever was saved last, wrapping around to the start
+		auto plr_it = _db.lower_bound(_autosave_next);
+		if (plr_it == _db.end())
+			plr_it = _db.begin();
+
+		if (plr_it->second->getCurLoc() != nullptr)
+			saveUser(*(plr_it->second));
+
+		auto next_it = std::next(plr_it);
+		_autosave_next = (next_it == _db.end()) ? std::string() : next_it->first;
 	}
 }
 
+/*********************************************************************************************
+ * markActive - queues a player to be visited by the next handleUsers pass. Called by the
+ *					 listening thread when commands arrive or the connection changes, and by anything
+ *					 else that changes a player outside of their own commands.
+ *
+ *********************************************************************************************/
+
+void UserMgr::markActive(std::shared_ptr<Player> plr) {
+	std::lock_guard<std::mutex> guard(_ready_mutex);
+	_ready.push_back(plr);
+}
+
 
 /*********************************************************************************************
  * loadUser - attempts to load the user into the given Player object
@@ -281,20 +496,31 @@ void UserMgr::handleUsers(libconfig::Config &cfg_info, EntityDB &edb){
  *					plr - an existing Player class that will be populated (note: id will not be
  *						   changed and should not be until authentication happens)
  *
- *		Returns:	1 if loaded, 0 if not found
+ *		Returns:	1 if loaded, 0 if not found, -1 if their save could not be read
  *
  *********************************************************************************************/
 
 int UserMgr::loadUser(const char *username, Player &plr) {
-	return plr.loadUser(_userdir.c_str(), username);
+	std::string name(username);
+	lower(name);
+
+	// A player back right after quitting may still have their save waiting to be written
+	_saves.waitFor(name);
+
+	std::string record;
+	int results = _store->load(name, record);
+	if (results != 1)
+		return results;
+
+	return plr.loadUser(username, record);
 }
 
 /*********************************************************************************************
- * saveUser - saves the user data to a file
+ * saveUser - snapshots the user data and queues it for the save writer
  *
  *    Params:  username - self-explanatory
  *
- *    Returns: 1 if loaded, 0 if not found
+ *    Returns: false if the user wasn't found or the file could not be written, true otherwise
  *
  *********************************************************************************************/
 
@@ -309,13 +535,48 @@ bool UserMgr::saveUser(const char *username) {
 }
 
 bool UserMgr::saveUser(const Player &plr) {
-	return plr.saveUser(_userdir.c_str());
+	std::string snapshot;
+	std::string buf;
+
+	plr.snapshotUser(snapshot);
+	return _saves.queueSave(plr.getNameID(buf), std::move(snapshot));
+}
+
+/*********************************************************************************************
+ * saveUserNow - saves the player to the store before returning, for new accounts
+ *
+ *    Returns: true if saved, false otherwise
+ *
+ *********************************************************************************************/
+
+bool UserMgr::saveUserNow(const Player &plr) {
+	std::string snapshot;
+	std::string buf;
+
+	plr.snapshotUser(snapshot);
+	return _saves.saveNow(plr.getNameID(buf), snapshot);
+}
+
+/*********************************************************************************************
+ * stopSaves - saves everyone in the game and waits for the save writer to write it all out
+ *				   before stopping it. Called at shutdown.
+ *
+ *********************************************************************************************/
+
+void UserMgr::stopSaves() {
+	for (auto plr_it = _db.begin(); plr_it != _db.end(); plr_it++) {
+		if (plr_it->second->getCurLoc() != nullptr)
+			saveUser(*(plr_it->second));
+	}
+
+	_saves.stop();
 }
 
 /*********************************************************************************************
- * getPlayer - gets the player based off the parameter
+ * getPlayer - gets a logged in player by name. Exact names are a hash lookup and abbreviations
+ *				   a search of the sorted names, so neither walks the player list.
  *
- *    Params:  name - the name to search for
+ *    Params:  name - the name to search for, with or without the "player:" prefix
  *             allow_abbrev - if true, search will return the first match to an abbreviated name
  *
  *    Returns: pointer to the player if found, nullptr if not
@@ -323,46 +584,108 @@ bool UserMgr::saveUser(const Player &plr) {
  *********************************************************************************************/
 
 std::shared_ptr<Player> UserMgr::getPlayer(const char *name, bool allow_abbrev) {
-   std::string namestr = name;
-
-   auto plr_it = _db.begin();
-   for ( ; plr_it != _db.end(); plr_it++) {
-      if ((allow_abbrev) && (namestr.compare(0, namestr.size(), plr_it->second->getID()) == 0))
-         return plr_it->second;
-      else if (!allow_abbrev && (namestr.compare(plr_it->second->getID()) == 0))
-         return plr_it->second;
-   }
-   return nullptr;
+	std::string key;
+	foldName(name, key);
+
+	auto online_it = _online.find(key);
+	if (online_it != _online.end())
+		return online_it->second;
+
+	if (!allow_abbrev || (key.size() == 0))
+		return nullptr;
+
+	// lower_bound gives the alphabetically first name with this prefix if there is one, and
+	// that's the one to match, so it's the only candidate that needs checking
+	auto name_it = _online_names.lower_bound(key);
+	if ((name_it == _online_names.end()) || (name_it->compare(0, key.size(), key) != 0))
+		return nullptr;
+	return _online[*name_it];
 }
 
 /*********************************************************************************************
- * showUsers - displays the list of logged on users
+ * listOccupiedZones - adds the zone of each logged in player's location to zones
+ *
+ *********************************************************************************************/
+
+void UserMgr::listOccupiedZones(std::set<std::string> &zones) {
+	std::string zonename;
+	for (auto online_it = _online.begin(); online_it != _online.end(); online_it++) {
+		std::shared_ptr<Physical> loc = online_it->second->getCurLoc();
+		if (loc != nullptr)
+			zones.insert(loc->getZoneID(zonename));
+	}
+}
+
+/*********************************************************************************************
+ * foldName - turns a player name or ID into the key for the online indexes: lowercase with
+ *				  no "player:" prefix
+ *
+ *********************************************************************************************/
+
+void UserMgr::foldName(const char *name, std::string &key) {
+	key = name;
+	if (key.compare(0, 7, "player:") == 0)
+		key.erase(0, 7);
+	lower(key);
+}
+
+/*********************************************************************************************
+ * addOnline/removeOnline - adds a player who just logged in to the online indexes, or takes
+ *									 one who is leaving out of them
+ *
+ *********************************************************************************************/
+
+void UserMgr::addOnline(std::shared_ptr<Player> plr) {
+	std::string key;
+	foldName(plr->getID(), key);
+
+	_online[key] = plr;
+	_online_names.insert(key);
+	_who_list.clear();
+}
+
+void UserMgr::removeOnline(Player &plr) {
+	std::string key;
+	foldName(plr.getID(), key);
+
+	// Only if it's this player--a second login under the same name may have replaced them
+	auto online_it = _online.find(key);
+	if ((online_it == _online.end()) || (online_it->second.get() != &plr))
+		return;
+
+	_online.erase(online_it);
+	_online_names.erase(key);
+	_who_list.clear();
+}
+
+/*********************************************************************************************
+ * showUsers - displays the list of logged on users. The list is built once and kept until
+ *				   someone logs in or out.
  *
  *********************************************************************************************/
 
 const char *UserMgr::showUsers(std::string &buf) {
 
-	int count = 0;
-	std::string name;
-	std::stringstream str;
-	buf.clear();
+	if (_who_list.size() == 0) {
+		_who_list.reserve(64 + (_online_names.size() * 16));
+		_who_list = "Users: \n-----------------------\n";
 
-	str << "Users: \n-----------------------\n";
+		for (auto name_it = _online_names.begin(); name_it != _online_names.end(); name_it++) {
+			size_t start = _who_list.size();
+			_who_list += *name_it;
+			_who_list[start] = (char) toupper(_who_list[start]);
+			_who_list += '\n';
+		}
 
-	auto plr_it = _db.begin();
-	for ( ; plr_it != _db.end(); plr_it++) {
-		  plr_it->second->getNameID(name);
-		
-		name[0] = toupper(name[0]);
-		str << name << "\n";
-		count++;
+		_who_list += "-----------------------\n";
+		_who_list += std::to_string(_online_names.size());
+		if (_online_names.size() == 1)
+			_who_list += " user logged on\n\n"; 
+		else
+			_who_list += " users logged on\n\n";
 	}
-	str << "-----------------------\n" << count;
-	if (count == 1)
-		str << " user logged on\n\n"; 
-	else
-		str << " users logged on\n\n";
-	buf = str.str();
+
+	buf = _who_list;
 	return buf.c_str();	
 }
 
@@ -377,35 +700,81 @@ int UserMgr::sendMsg(const char *msg, std::vector<std::string> *exclude_flags,
 
 	int count = 0;
 
+	// Resolve the flag names up front. Player flags become bitmasks, anything else still
+	// has to be checked by name
+	std::bitset<32> exclude_mask, require_mask;
+	std::vector<std::string> exclude_other, require_other;
+	resolveFlags(exclude_flags, exclude_mask, exclude_other);
+	resolveFlags(required_flags, require_mask, require_other);
+
+	// Formatted once per output profile and shared by all recipients
+	Broadcast bcast(msg);
+
 	// Loop through all connected users
 	auto p_it = _db.begin();
 	for ( ; p_it != _db.end(); p_it++) {
+		Player &plr = *(p_it->second);
+
 		// Exclude the person if they're exclude_ind
 		if (exclude_ind == (*p_it).second)
 			continue;
 
-		// Check exclude flags
-		if (exclude_flags != NULL) {
-			// Loop through our flags, checking the player's flags
-			for (unsigned int i=0; i<exclude_flags->size(); i++) {
-				if (p_it->second->isFlagSet((*exclude_flags)[i].c_str()))
-					continue;	// skip this player
-			}
-		}
+		// Skip players with any of the exclude flags or missing any of the required flags
+		if ((plr.getPFlags() & exclude_mask).any() || ((plr.getPFlags() & require_mask) != require_mask))
+			continue;
 
-		// Check required flags
-		if (required_flags != NULL) {
-         // Loop through our flags, checking the player's flags
-         for (unsigned int i=0; i<required_flags->size(); i++) {
-            if (!p_it->second->isFlagSet((*required_flags)[i].c_str()))
-               continue;   // skip this player
+		if (!checkFlags(plr, exclude_other, require_other))
+			continue;
 
-			}
-		}
-		p_it->second->sendMsg(msg);
+		plr.sendBroadcast(bcast);
 		count++;
 	}
 	return count;
 }
 
+/*********************************************************************************************
+ * resolveFlags - splits a list of flag names into a mask of Player flags and a list of the
+ *					   flags that belong to parent classes
+ *
+ *    Params:  flags - the flag names, may be NULL
+ *					mask - bits set for each Player flag found
+ *					others - populated with the names that are not Player flags
+ *
+ *********************************************************************************************/
+
+void UserMgr::resolveFlags(std::vector<std::string> *flags, std::bitset<32> &mask, 
+																		std::vector<std::string> &others) {
+	if (flags == NULL)
+		return;
+
+	for (unsigned int i=0; i<flags->size(); i++) {
+		unsigned int idx = Player::lookupPFlag((*flags)[i].c_str());
+		if (idx == UINT_MAX)
+			others.push_back((*flags)[i]);
+		else
+			mask[idx] = true;
+	}
+}
+
+/*********************************************************************************************
+ * checkFlags - checks the flags that could not be resolved to a bitmask by name
+ *
+ *    Returns: true if the player has none of the exclude flags and all of the required flags
+ *
+ *********************************************************************************************/
+
+bool UserMgr::checkFlags(Player &plr, std::vector<std::string> &exclude_other, 
+																				std::vector<std::string> &require_other) {
+	for (unsigned int i=0; i<exclude_other.size(); i++) {
+		if (plr.isFlagSet(exclude_other[i].c_str()))
+			return false;
+	}
+
+	for (unsigned int i=0; i<require_other.size(); i++) {
+		if (!plr.isFlagSet(require_other[i].c_str()))
+			return false;
+	}
+	return true;
+}
+
 
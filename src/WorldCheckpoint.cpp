@@ -0,0 +1,218 @@
+#include <sstream>
+#include <algorithm>
+#include "WorldCheckpoint.h"
+#include "EntityDB.h"
+#include "Physical.h"
+#include "TickProfiler.h"
+#include "global.h"
+
+WorldCheckpoint::WorldCheckpoint():
+						_store(),
+						_writer(),
+						_baseline(),
+						_saved()
+{
+
+}
+
+// The store and writer are not copied
+WorldCheckpoint::WorldCheckpoint(const WorldCheckpoint &copy_from):
+						_store(),
+						_writer(),
+						_baseline(copy_from._baseline),
+						_saved(copy_from._saved),
+						_checkpoint_secs(copy_from._checkpoint_secs)
+{
+
+}
+
+WorldCheckpoint::~WorldCheckpoint() {
+
+}
+
+/*********************************************************************************************
+ * initialize - opens the checkpoint store, records the zones' starting state and replays the
+ *				    saved changes onto them. If the store can't be opened the MUD runs without
+ *				    checkpoints and the zones start as the zone files have them.
+ *
+ *		Params:	cfg_info - the MUD's config
+ *					edb - the entities, already loaded and linked
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::initialize(libconfig::Config &cfg_info, EntityDB &edb) {
+	std::string worlddb;
+	cfg_info.lookupValue("datadir.worlddb", worlddb);
+
+	int checkpoint_secs = 60;
+	cfg_info.lookupValue("misc.checkpoint_secs", checkpoint_secs);
+	if ((worlddb.size() == 0) || (checkpoint_secs <= 0))
+		return;
+	_checkpoint_secs = (unsigned int) checkpoint_secs;
+
+	int compact_mb = 1, compact_dead = 50;
+	cfg_info.lookupValue("datadir.worlddb_compact_mb", compact_mb);
+	cfg_info.lookupValue("datadir.worlddb_compact_dead", compact_dead);
+
+	_store.reset(new LogStore(worlddb.c_str()));
+	_store->setDescription("world checkpoint");
+	_store->setCompaction((uint64_t) std::max(compact_mb, 0) << 20,
+																(unsigned int) std::min(std::max(compact_dead, 1), 100));
+	if (!_store->open()) {
+		mudlog->writeLog("World checkpoints are off, the zones will reset on every restart.");
+		_store.reset();
+		return;
+	}
+
+	setBaseline(edb);
+	replay(edb);
+
+	_writer.setStore(_store.get());
+	_writer.setDescription("world states");
+	_writer.start();
+	_next_checkpoint = std::chrono::steady_clock::now() + std::chrono::seconds(_checkpoint_secs);
+}
+
+/*********************************************************************************************
+ * setBaseline - records the state of every entity as the zone files set it up, which is what
+ *					  the saved changes are measured against
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::setBaseline(EntityDB &edb) {
+	std::vector<std::shared_ptr<Physical>> physicals;
+	edb.listPhysicals(physicals);
+
+	_baseline.clear();
+	_baseline.reserve(physicals.size());
+
+	std::string state;
+	for (unsigned int i=0; i<physicals.size(); i++) {
+		physicals[i]->snapshotState(state);
+		_baseline.emplace(physicals[i]->getID(), state);
+	}
+}
+
+/*********************************************************************************************
+ * replay - puts every saved change back. Changes to entities that are no longer in the zone
+ *			   files are dropped from the store.
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::replay(EntityDB &edb) {
+	std::vector<std::string> names;
+	_store->listNames(names);
+
+	std::vector<PlayerStore::store_record> stale;
+	unsigned int restored = 0;
+	std::string state;
+
+	for (unsigned int i=0; i<names.size(); i++) {
+		std::shared_ptr<Physical> pptr = edb.getPhysical(names[i].c_str());
+		if ((pptr == nullptr) || (_store->load(names[i], state) != 1) || !pptr->restoreState(edb, state)) {
+			stale.push_back(PlayerStore::store_record{names[i], std::string()});
+			continue;
+		}
+		_saved[names[i]] = state;
+		restored++;
+	}
+
+	// Restoring marked everything it touched, but the store already has it
+	std::vector<std::shared_ptr<Physical>> dirty;
+	edb.takeDirty(dirty);
+
+	if (stale.size() > 0)
+		_store->saveBatch(stale);
+	_changed_metric.set((int64_t) _saved.size());
+
+	std::stringstream msg;
+	msg << "Restored the saved state of " << restored << " entities";
+	if (stale.size() > 0)
+		msg << ", dropped " << stale.size() << " that no longer exist or could not be read";
+	msg << ".";
+	mudlog->writeLog(msg.str().c_str(), 2);
+}
+
+/*********************************************************************************************
+ * checkpoint - once the interval has passed, queues the entities changed since the last
+ *				    checkpoint to be written. Called on the game thread every heartbeat.
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::checkpoint(EntityDB &edb) {
+	if (_store == nullptr)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (now < _next_checkpoint)
+		return;
+
+	saveChanges(edb);
+	_next_checkpoint = now + std::chrono::seconds(_checkpoint_secs);
+	_snapshot_metric.record(TickProfiler::elapsedUsecs(now, std::chrono::steady_clock::now()));
+}
+
+/*********************************************************************************************
+ * saveChanges - encodes each entity that changed and queues it for the writer if it differs
+ *					  from what's saved. An entity back to how the zone files have it is queued as
+ *					  an empty record, which removes it from the store.
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::saveChanges(EntityDB &edb) {
+	std::vector<std::shared_ptr<Physical>> dirty;
+	edb.takeDirty(dirty);
+
+	std::string state;
+	for (unsigned int i=0; i<dirty.size(); i++) {
+		std::string id(dirty[i]->getID());
+		dirty[i]->snapshotState(state);
+
+		auto base_it = _baseline.find(id);
+		if ((base_it != _baseline.end()) && (base_it->second == state))
+			state.clear();
+
+		auto saved_it = _saved.find(id);
+		if (state.size() == 0) {
+			if (saved_it == _saved.end())
+				continue;
+			_saved.erase(saved_it);
+		} else if ((saved_it != _saved.end()) && (saved_it->second == state))
+			continue;
+		else
+			_saved[id] = state;
+
+		_writer.queueSave(id, std::string(state));
+		_written_metric.add();
+	}
+	_changed_metric.set((int64_t) _saved.size());
+}
+
+/*********************************************************************************************
+ * stop - queues whatever changed since the last checkpoint, waits for the writer to finish
+ *		    and closes the store
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::stop(EntityDB &edb) {
+	if (_store == nullptr)
+		return;
+
+	saveChanges(edb);
+	_writer.stop();
+	_store->close();
+}
+
+/*********************************************************************************************
+ * registerMetrics - adds the checkpoint figures to the registry
+ *
+ *********************************************************************************************/
+
+void WorldCheckpoint::registerMetrics(MetricsRegistry &metrics) {
+	metrics.addGauge("aime_world_changed_entities", "Entities whose saved state differs from the zone files",
+																										_changed_metric);
+	metrics.addCounter("aime_world_states_written_total", "Entity states queued by world checkpoints",
+																										_written_metric);
+	metrics.addSummary("aime_world_checkpoint_usecs", "Heartbeat time spent encoding each world checkpoint",
+																										_snapshot_metric);
+}
@@ -0,0 +1,239 @@
+#include <libconfig.h++>
+#include <sstream>
+#include "ZoneReset.h"
+#include "EntityDB.h"
+#include "Physical.h"
+#include "global.h"
+
+ZoneReset::ZoneReset(const char *zonename):
+								Action("reset:zone"),
+								_zonename(zonename),
+								_members(),
+								_rules()
+{
+	_typename = "ZoneReset";
+
+	std::string id("reset:");
+	id += zonename;
+	setID(id.c_str());
+}
+
+ZoneReset::ZoneReset(const ZoneReset &copy_from):
+								Action(copy_from),
+								_zonename(copy_from._zonename),
+								_interval(copy_from._interval),
+								_budget(copy_from._budget),
+								_members(copy_from._members),
+								_rules(copy_from._rules)
+{
+
+}
+
+ZoneReset::~ZoneReset() {
+
+}
+
+/*********************************************************************************************
+ * loadZone - reads the reset interval (seconds) and the spawn rules from the zone's <zone> node
+ *
+ *    Params:  zonenode - the <zone> node of the zone file
+ *
+ *    Returns: true if it read correctly, false (logged) if something was missing or wrong
+ *
+ *********************************************************************************************/
+
+bool ZoneReset::loadZone(pugi::xml_node &zonenode) {
+	std::stringstream errmsg;
+
+	_interval = zonenode.attribute("reset").as_float(0.0);
+	if (_interval <= 0.0) {
+		errmsg << "Zone '" << _zonename << "' missing or bad reset interval.";
+		mudlog->writeLog(errmsg.str().c_str());
+		return false;
+	}
+
+	for (pugi::xml_node spawn = zonenode.child("spawn"); spawn; spawn = spawn.next_sibling("spawn")) {
+		spawn_rule rule;
+		rule.proto_id = spawn.attribute("prototype").value();
+		rule.loc_id = spawn.attribute("location").value();
+		rule.count = spawn.attribute("count").as_uint(1);
+
+		if ((rule.proto_id.size() == 0) || (rule.loc_id.size() == 0) || (rule.count == 0)) {
+			errmsg << "Zone '" << _zonename << "' spawn rule needs a prototype, location and count of at least 1.";
+			mudlog->writeLog(errmsg.str().c_str());
+			return false;
+		}
+		_rules.push_back(rule);
+	}
+	return true;
+}
+
+/*********************************************************************************************
+ * checkRules - drops any spawn rule whose prototype or location doesn't exist
+ *
+ *********************************************************************************************/
+
+void ZoneReset::checkRules(EntityDB &edb) {
+	auto rule_it = _rules.begin();
+	while (rule_it != _rules.end()) {
+		if ((edb.getPrototype(rule_it->proto_id.c_str()) != nullptr) &&
+													(edb.getPhysical(rule_it->loc_id.c_str()) != nullptr)) {
+			rule_it++;
+			continue;
+		}
+
+		std::stringstream msg;
+		msg << "Zone '" << _zonename << "' spawn rule for prototype '" << rule_it->proto_id <<
+					"' in '" << rule_it->loc_id << "' refers to something that doesn't exist. Dropped.";
+		mudlog->writeLog(msg.str().c_str());
+		rule_it = _rules.erase(rule_it);
+	}
+}
+
+/*********************************************************************************************
+ * start - sets up the first pass, which skips the members and runs right away
+ *
+ *********************************************************************************************/
+
+void ZoneReset::start() {
+	_in_progress = true;
+	_next_member = _members.size();
+	_next_rule = 0;
+	_placed = 0;
+	setExecuteNow();
+}
+
+/*********************************************************************************************
+ * execute - works through the reset. Each member or spawn rule checked and each entity
+ *				 restored or spawned uses one unit of budget. If the budget runs out first, it's
+ *				 queued to carry on next heartbeat; otherwise it's queued for the next reset.
+ *
+ *    Returns: 2 so the action queue keeps it
+ *
+ *********************************************************************************************/
+
+int ZoneReset::execute() {
+	EntityDB &edb = *engine.getEntityDB();
+
+	if (!_in_progress) {
+		_in_progress = true;
+		_next_member = 0;
+		_next_rule = 0;
+		_placed = 0;
+	}
+
+	unsigned int budget_left = _budget;
+	while ((budget_left > 0) && (_next_member < _members.size())) {
+		budget_left--;
+		if (restoreMember(edb, _members[_next_member++]))
+			_placed++;
+	}
+
+	// Checking a rule only costs budget once it's done, so a budget of 1 still makes progress
+	while ((budget_left > 0) && (_next_rule < _rules.size())) {
+		if (!applyRule(edb, _rules[_next_rule], budget_left))
+			break;
+		_next_rule++;
+		if (budget_left > 0)
+			budget_left--;
+	}
+
+	// Out of budget, carry on next heartbeat
+	if ((_next_member < _members.size()) || (_next_rule < _rules.size())) {
+		setExecuteNow();
+		return 2;
+	}
+
+	_in_progress = false;
+	if (_placed > 0) {
+		std::stringstream msg;
+		msg << "Zone '" << _zonename << "' reset, " << _placed << " entities restored or spawned.";
+		mudlog->writeLog(msg.str().c_str(), 3);
+	}
+
+	setExecute(_interval);
+	return 2;
+}
+
+/*********************************************************************************************
+ * restoreMember - puts a zone entity that has left the world back at its startloc, with its
+ *					    attributes (health and so on) as the zone file set them
+ *
+ *    Returns: true if it was restored
+ *
+ *********************************************************************************************/
+
+bool ZoneReset::restoreMember(EntityDB &edb, zone_member &member) {
+	std::shared_ptr<Physical> entity = member.entity;
+	if (entity->getCurLoc() != nullptr)
+		return false;
+
+	// Members taken out of the database are gone for good
+	if (edb.getPhysical(entity->getID()) != entity)
+		return false;
+
+	entity->resetAttributes(member.attributes);
+	entity->addLinks(edb, entity);
+	return (entity->getCurLoc() != nullptr);
+}
+
+/*********************************************************************************************
+ * applyRule - brings the number of the rule's spawned entities at its location up to its
+ *				   count. Instances found somewhere else are let go, since whoever has them keeps
+ *				   them. Ones that left the world are reused first, with the prototype's attributes
+ *				   put back, and then new ones are spawned.
+ *
+ *    Params:  budget_left - entities that can still be placed this heartbeat. Reduced by the
+ *									 number placed
+ *
+ *    Returns: true if the rule is satisfied, false if it ran out of budget first
+ *
+ *********************************************************************************************/
+
+bool ZoneReset::applyRule(EntityDB &edb, spawn_rule &rule, unsigned int &budget_left) {
+	std::shared_ptr<Physical> loc = edb.getPhysical(rule.loc_id.c_str());
+	std::shared_ptr<Physical> proto = edb.getPrototype(rule.proto_id.c_str());
+	if ((loc == nullptr) || (proto == nullptr))
+		return true;
+
+	unsigned int live = 0;
+	auto inst_it = rule.instances.begin();
+	while (inst_it != rule.instances.end()) {
+		std::shared_ptr<Physical> cur_loc = (*inst_it)->getCurLoc();
+		if (cur_loc == loc)
+			live++;
+		else if (cur_loc != nullptr) {
+			inst_it = rule.instances.erase(inst_it);
+			continue;
+		}
+		inst_it++;
+	}
+
+	for (unsigned int i=0; (i<rule.instances.size()) && (live < rule.count); i++) {
+		if (budget_left == 0)
+			return false;
+		if (rule.instances[i]->getCurLoc() != nullptr)
+			continue;
+
+		rule.instances[i]->resetAttributes(proto->getAttributes());
+		rule.instances[i]->movePhysical(loc, rule.instances[i]);
+		budget_left--;
+		live++;
+		_placed++;
+	}
+
+	while (live < rule.count) {
+		if (budget_left == 0)
+			return false;
+
+		std::shared_ptr<Physical> newptr = edb.spawn(rule.proto_id.c_str(), loc);
+		if (newptr == nullptr)
+			return true;
+
+		rule.instances.push_back(newptr);
+		budget_left--;
+		live++;
+		_placed++;
+	}
+	return true;
+}
@@ -647,6 +647,28 @@ int statscom(MUD &engine, Action &act_used) {
    return 1;
 }
 
+/*******************************************************************************************
+ * tickstatscom - shows the game loop timings collected since the last profile report
+ *******************************************************************************************/
+
+int tickstatscom(MUD &engine, Action &act_used) {
+   std::shared_ptr<Organism> actor = act_used.getActor();
+
+	std::string buf;
+	engine.getProfiler()->getReport(buf);
+	buf += "\n";
+
+	// Keep the report's ampersands from being read as color codes
+	std::string msg;
+	for (unsigned int i=0; i<buf.size(); i++) {
+		msg += buf[i];
+		if (buf[i] == '&')
+			msg += '&';
+	}
+	actor->sendMsg(msg.c_str());
+   return 1;
+}
+
 /*******************************************************************************************
  * equipcom - Wear or wield equipment
  *******************************************************************************************/
@@ -1104,14 +1126,26 @@ int hitcom(MUD &engine, Action &act_used) {
    std::shared_ptr<Organism> optr = std::dynamic_pointer_cast<Organism>(act_used.getTarget1());
 
 	if (optr != nullptr) {
+		std::string actorname, targetname, with("your fists"), with_other("their fists");
+		actor->getGameName(actorname);
+		optr->getGameName(targetname);
 		if (act_used.getTarget2() != nullptr) {
-			msg << "You strike " << optr->getGameName(buf) << " hard with the " << act_used.getTarget2()->getGameName(buf) << "! They look like they're about to attack, but then realize combat isn't coded yet. They sigh and shrug.\n";
-			actor->sendMsg(msg.str().c_str());
-		} else { 
-         msg << "You strike " << optr->getGameName(buf) << " hard with your fists! They look like they're about to attack, but then realize combat isn't coded yet. They sigh and shrug.\n";
-         actor->sendMsg(msg.str().c_str());
-
+			with = "the ";
+			with += act_used.getTarget2()->getGameName(buf);
+			with_other = with;
 		}
+
+		msg << "You strike " << targetname << " hard with " << with << "! They look like they're about to attack, but then realize combat isn't coded yet. They sigh and shrug.\n";
+		actor->sendMsg(msg.str().c_str());
+
+		// The target and everyone watching see it too, so an NPC's attack isn't silent
+		msg.str("");
+		msg << actorname << " strikes you hard with " << with_other << "!\n";
+		optr->sendMsg(msg.str().c_str());
+
+		msg.str("");
+		msg << actorname << " strikes " << targetname << " hard with " << with_other << "!\n";
+		actor->getCurLoc()->sendMsg(msg.str().c_str(), actor, optr);
 		return 1;
 	}
 
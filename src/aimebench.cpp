@@ -0,0 +1,642 @@
+/****************************************************************************************
+ * aimebench - Microbenchmarks for the engine's hot paths (command lookup and parsing,
+ *					name matching, entity lookups, text formatting, scripts, player saves and
+ *					zone loading).
+ *					Runs against the shipped world in data/ plus a generated world of about
+ *					100k entities. Run it from the same directory as the server.
+ *
+ *
+ ****************************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <bitset>
+#include <getopt.h>
+#include <stdlib.h>
+#include <boost/filesystem.hpp>
+#include <benchmark/benchmark.h>
+#include "MUD.h"
+#include "ActionMgr.h"
+#include "Action.h"
+#include "EntityDB.h"
+#include "Location.h"
+#include "Player.h"
+#include "TCPConn.h"
+#include "ScriptEngine.h"
+#include "StrFormatter.h"
+#include "BinRecord.h"
+#include "global.h"
+
+// The main mud engine, accessible via extern global defines
+MUD engine;
+
+// Rooms in the generated world get this many items each, except the first which is crowded
+const unsigned int items_per_room = 9;
+const unsigned int crowded_items = 1000;
+
+// Set up in main before any benchmarks run
+std::string synth_dir;
+unsigned int synth_entities = 100000;
+std::unique_ptr<EntityDB> synth_db;
+std::shared_ptr<Physical> crowded_room;
+std::shared_ptr<Physical> sparse_room;
+std::shared_ptr<Player> bench_plr;
+std::string zone_text;
+
+/*****************************************************************************************
+ * displayHelp - Shows command line parameters to the user.
+ *****************************************************************************************/
+
+void displayHelp(const char *execname) {
+   std::cout << execname << " [OPTIONS] [--benchmark_filter=<regex>] [other benchmark options]\n";
+	std::cout << "Run the AIME3 engine microbenchmarks.\n\n";
+	std::cout << "  -c, --config    Override the default config file location\n";
+	std::cout << "  -s, --size      Entities in the generated world (default: 100000)\n";
+	std::cout << "  -h, --help      Display this message\n";
+}
+
+/*****************************************************************************************
+ * loadZones - loads the zone files in zonedir into edb by pointing the config at them for
+ *				   the duration of the load
+ *
+ *		Returns: the number of entities loaded
+ *****************************************************************************************/
+
+int loadZones(EntityDB &edb, const std::string &zonedir) {
+	libconfig::Setting &setting = engine.getConfig()->lookup("datadir.zonedir");
+	std::string saved = setting.c_str();
+
+	setting = zonedir;
+	int count = edb.loadPhysicals(*engine.getConfig());
+	setting = saved;
+	return count;
+}
+
+/*****************************************************************************************
+ * writeSynthWorld - generates zone files in dirname with num_entities entities. One in ten
+ *						   is a location, linked east-west into a chain, and the rest are getables
+ *						   and statics spread over them. A few statics are lit, and the first room
+ *						   holds crowded_items items with a lamp sorted to the very end.
+ *****************************************************************************************/
+
+void writeSynthWorld(const std::string &dirname, unsigned int num_entities) {
+	const char *names[] = {"sword", "shield", "rope", "lantern", "barrel", "crate", "coin", "bone", NULL};
+	const unsigned int num_files = 10;
+
+	unsigned int num_rooms = std::max(num_entities / (items_per_room + 1), 2U);
+	unsigned int num_items = num_entities - num_rooms;
+
+	std::vector<std::unique_ptr<std::ofstream>> files;
+	for (unsigned int i=0; i<num_files; i++) {
+		std::stringstream filename;
+		filename << dirname << "/bench" << i << ".zone";
+		files.emplace_back(new std::ofstream(filename.str().c_str()));
+		*(files[i]) << "<?xml version=\"1.0\"?>\n";
+	}
+
+	for (unsigned int i=0; i<num_rooms; i++) {
+		std::ofstream &zone = *(files[i % num_files]);
+		zone << "<location id=\"bench:room" << i << "\" title=\"Room " << i << "\">\n";
+		if (i > 0)
+			zone << "<exit name=\"west\" location=\"bench:room" << i-1 << "\"/>\n";
+		if (i+1 < num_rooms)
+			zone << "<exit name=\"east\" location=\"bench:room" << i+1 << "\"/>\n";
+		zone << "<desc>A plain room generated for benchmarking, one of " << num_rooms << ".</desc>\n";
+		zone << "</location>\n\n";
+	}
+
+	for (unsigned int i=0; i<num_items; i++) {
+		std::ofstream &zone = *(files[i % num_files]);
+		unsigned int room = (i < crowded_items) ? 0 : 1 + (i % (num_rooms - 1));
+		const char *name = names[i % 8];
+		bool is_static = ((i % 5) == 0);
+
+		zone << (is_static ? "<static" : "<getable") << " id=\"bench:item" << std::setw(6) <<
+					std::setfill('0') << i << std::setfill(' ') << "\" title=\"a " << name << "\" startloc=\"bench:room" <<
+					room << "\">\n";
+		zone << "<altname name=\"" << name << i << "\" />\n";
+		zone << "<examine>Item " << i << ", a " << name << ".</examine>\n";
+		if (is_static) {
+			if ((room != 0) && ((i % 97) == 0))
+				zone << "<flag name=\"Lit\" />\n";
+			zone << "</static>\n\n";
+		} else {
+			zone << "<roomdesc state=\"pristine\">A " << name << " lies here.</roomdesc>\n";
+			zone << "</getable>\n\n";
+		}
+	}
+
+	// Sorts after all the items, so containsLit has to look through the whole room
+	*(files[0]) << "<static id=\"bench:zlamp\" title=\"a lamp\" startloc=\"bench:room0\">\n";
+	*(files[0]) << "<examine>A lamp.</examine>\n<flag name=\"Lit\" />\n</static>\n";
+}
+
+/*****************************************************************************************
+ * readZoneText - concatenates the shipped zone files, used as sample text for formatting
+ *****************************************************************************************/
+
+void readZoneText(std::string &text) {
+	std::string zonedir;
+	engine.getConfig()->lookupValue("datadir.zonedir", zonedir);
+
+	boost::filesystem::directory_iterator start(zonedir), end;
+	for ( ; start != end; start++) {
+		std::ifstream zfile(start->path().string().c_str());
+		std::stringstream buf;
+		buf << zfile.rdbuf();
+		text += buf.str();
+	}
+}
+
+/*****************************************************************************************
+ * Command lookup and parsing
+ *****************************************************************************************/
+
+void BM_FindAction(benchmark::State &state, const char *cmd) {
+	ActionMgr *actions = engine.getActionMgr();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(actions->findAction(cmd));
+}
+BENCHMARK_CAPTURE(BM_FindAction, exact, "look");
+BENCHMARK_CAPTURE(BM_FindAction, abbrev, "inv");
+BENCHMARK_CAPTURE(BM_FindAction, miss, "xyzzy");
+
+void BM_PreAction(benchmark::State &state, const char *cmd) {
+	ActionMgr *actions = engine.getActionMgr();
+	std::string errmsg;
+
+	for (auto _ : state) {
+		Action *new_act = actions->preAction(cmd, errmsg, bench_plr);
+		benchmark::DoNotOptimize(new_act);
+		delete new_act;
+	}
+}
+BENCHMARK_CAPTURE(BM_PreAction, look, "look");
+BENCHMARK_CAPTURE(BM_PreAction, go_east, "east");
+BENCHMARK_CAPTURE(BM_PreAction, get_hit, "get shield");
+BENCHMARK_CAPTURE(BM_PreAction, get_missing, "get unicorn");
+
+/*****************************************************************************************
+ * Contents searches, on the crowded room and a typical one
+ *****************************************************************************************/
+
+void BM_GetContainedByName(benchmark::State &state, const char *name, bool crowded) {
+	Physical &room = crowded ? *crowded_room : *sparse_room;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(room.getContainedByName(name));
+}
+BENCHMARK_CAPTURE(BM_GetContainedByName, crowded_hit, "shield", true);
+BENCHMARK_CAPTURE(BM_GetContainedByName, crowded_abbrev, "lant", true);
+BENCHMARK_CAPTURE(BM_GetContainedByName, crowded_miss, "unicorn", true);
+BENCHMARK_CAPTURE(BM_GetContainedByName, sparse_miss, "unicorn", false);
+
+void BM_ContainsLit(benchmark::State &state, bool crowded) {
+	Physical &room = crowded ? *crowded_room : *sparse_room;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(room.containsLit());
+}
+BENCHMARK_CAPTURE(BM_ContainsLit, crowded, true);
+BENCHMARK_CAPTURE(BM_ContainsLit, sparse, false);
+
+void BM_HasLitContents(benchmark::State &state) {
+	for (auto _ : state)
+		benchmark::DoNotOptimize(crowded_room->hasLitContents());
+}
+BENCHMARK(BM_HasLitContents);
+
+/*****************************************************************************************
+ * Entity lookups in the generated world
+ *****************************************************************************************/
+
+void BM_GetPhysical(benchmark::State &state, const char *id) {
+	for (auto _ : state)
+		benchmark::DoNotOptimize(synth_db->getPhysical(id));
+}
+BENCHMARK_CAPTURE(BM_GetPhysical, hit, "bench:item045000");
+BENCHMARK_CAPTURE(BM_GetPhysical, miss, "bench:nothere");
+
+/*****************************************************************************************
+ * Text formatting
+ *****************************************************************************************/
+
+void BM_FormatStr(benchmark::State &state) {
+	StrFormatter formatter;
+	formatter.addMap('n', "Asmodeus");
+	formatter.addMap('t', "the guard");
+	std::string output;
+
+	for (auto _ : state) {
+		formatter.formatStr("%n smiles warmly at %t, and %t nods back at %n.", output);
+		benchmark::DoNotOptimize(output.data());
+	}
+}
+BENCHMARK(BM_FormatStr);
+
+/*****************************************************************************************
+ * baselineFormatForTelnet - the formatter as it was before the single-pass rewrite, kept
+ *									 here so BM_FormatForTelnetBaseline can run it next to the
+ *									 current one on the same text. Its output on the shipped
+ *									 zone text is the same as Player::formatForTelnet's.
+ *****************************************************************************************/
+
+const char baseline_color_table[] =
+{        
+     '\0',   '\0',   '4',    '6',
+     '\0',   '\0',   '\0',   '2',
+     '\0',   '\0',   '\0',   '\0',
+     '0',    '5',    '\0',   '\0',
+     '\0',   '\0',   '1',    '\0',
+     '\0',   '\0',   '\0',   '7',
+     '\0',   '3',    '\0',   '\0',
+     '\0',   '\0',   '\0',   '\0',
+     '\0',   '\0',   '4',    '6',
+     '\0',   '\0',   '\0',   '2',
+     '\0',   '\0',   '\0',   '\0',
+     '0',    '5',    '\0',   '\0',
+     '\0',   '\0',   '1',    '\0',
+     '\0',   '\0',   '\0',   '7',
+     '\0',   '3',    '\0',   '\0',
+     '\0',   '\0',   '\0',   '\0',
+};
+
+#define baselinecolor(x) ( (x>=64) ? baseline_color_table[x-64] : 0 )
+
+void baselineFormatForTelnet(const std::string &unformatted, std::string &formatted, bool use_color,
+														unsigned int wrap_width, unsigned int &last_wrap) {
+	std::bitset<256> keychars;
+	keychars['&'] = true;
+	keychars['\n'] = true;
+
+	formatted.clear();
+	formatted.reserve(unformatted.size() * 1.2);
+
+	std::string colorstr;
+
+	unsigned int lastpos = 0;
+	for (unsigned int i=0; i<unformatted.size(); i++) {
+
+		if ((unformatted[i] == '\r') || (unformatted[i] == '\n'))
+		{
+			last_wrap = 0;
+			continue;
+		}
+
+		if ((wrap_width != 0) && (last_wrap >= wrap_width)) {
+
+			// Step backwards to find a space
+			unsigned int j=i;
+			while ((j > 0) && (j > lastpos) && (j--)) {
+				if (unformatted[j] == ' ') {
+					formatted.append(unformatted, lastpos, j-lastpos);
+					formatted.append("\r\n");
+					lastpos = j+1;
+					last_wrap = 0;
+					i = lastpos;
+					continue;
+				}
+			}
+
+			if ((j == lastpos) && ((i - lastpos) < wrap_width)) {
+				formatted.append("\r\n");
+				lastpos = j;
+				last_wrap = 0;
+				i = j;
+				continue;
+			}
+			else if (j == lastpos) {
+				formatted.append(unformatted, lastpos, i-lastpos+1);
+				formatted.append("\r\n");
+				lastpos = i+1;
+				last_wrap = 0;
+				i = lastpos;
+				continue;
+			}	
+		}
+
+		if (unformatted[i] < 0)
+			continue;
+
+		if (!keychars[(std::size_t) unformatted[i]]) {
+			last_wrap++;
+			continue;
+		}
+
+		if (unformatted[i] == '\n') {
+			last_wrap = 0;
+			if ((i == 0) || (unformatted[i-1] != '\r')) {
+				if ((i - lastpos) > 1)
+					formatted.append(unformatted, lastpos, i-lastpos);
+				formatted.append("\r\n");
+				lastpos = i + 1;
+			} 
+		}
+		else if (unformatted[i] == '&') {
+			if (i+1 == unformatted.size())
+				continue;
+
+			if (unformatted[i+1] == '&') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				lastpos = i + 2;
+				last_wrap++;
+			}
+			else if (unformatted[i+1] == '*') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				if (use_color)
+					formatted.append("\033[1;0m");
+				lastpos = i+2;
+			}
+			else if (unformatted[i+1] == '^') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				if (use_color)
+					formatted.append("\033[1;1m");
+				lastpos = i+2;
+			}
+			else if (unformatted[i+1] == '~') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				if (use_color)
+					formatted.append("\033[1;3m");
+				lastpos = i+2;
+			}
+			else if (unformatted[i+1] == '_') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				if (use_color)
+					formatted.append("\033[1;4m");
+				lastpos = i+2;
+			}
+			else if (unformatted[i+1] == '@') {
+				formatted.append(unformatted, lastpos, i-lastpos);
+				if (use_color)
+					formatted.append("\033[1;5m");
+				lastpos = i+2;
+			}
+			else if ((unformatted[i+1] == '+') || (unformatted[i+1] == '-')) {
+				if (i+2 == unformatted.size())
+					continue;
+
+				if (lastpos != i)
+					formatted.append(unformatted, lastpos, i-lastpos);
+
+				if ((use_color) && (baselinecolor((int) unformatted[i+2]) != '\0')) {
+					colorstr = "\033[1;30m";
+					if (unformatted[i+1] == '-')
+						colorstr[4] = '4';
+					colorstr[5] = baselinecolor((int) unformatted[i+2]);
+					formatted.append(colorstr);
+				}
+				lastpos = i+3;
+			} 
+			else if (unformatted[i+1] == '=') {
+				if (i+3 >= unformatted.size())
+					continue;
+
+				if (lastpos != i)
+					formatted.append(unformatted, lastpos, i-lastpos);
+				
+				if ((use_color) && ((baselinecolor((int) unformatted[i+2]) != '\0') && 
+											(baselinecolor((int) unformatted[i+3]) != '\0'))) {
+					colorstr = "\033[1;40;30m";
+					colorstr[5] = baselinecolor((int) unformatted[i+2]);
+					colorstr[8] = baselinecolor((int) unformatted[i+3]);
+					formatted.append(colorstr);
+				}
+				lastpos = i+4;
+			} else {
+				if (lastpos != i)
+					formatted.append(unformatted, lastpos, i-lastpos);
+
+				lastpos = i + 1;
+			}
+			i = lastpos-1;
+		}
+	}
+	if (lastpos < unformatted.size()) {
+		formatted.append(unformatted, lastpos, unformatted.size()-lastpos);
+	}
+}
+
+void BM_FormatForTelnet(benchmark::State &state, bool use_color, unsigned int wrap_width) {
+	std::string formatted;
+	for (auto _ : state) {
+		unsigned int last_wrap = 0;
+		Player::formatForTelnet(zone_text, formatted, use_color, wrap_width, last_wrap);
+		benchmark::DoNotOptimize(formatted.data());
+	}
+	state.SetBytesProcessed(state.iterations() * (int64_t) zone_text.size());
+}
+BENCHMARK_CAPTURE(BM_FormatForTelnet, color_wrap80, true, 80);
+BENCHMARK_CAPTURE(BM_FormatForTelnet, nocolor_nowrap, false, 0);
+
+// The same text through the old formatter, for comparison
+void BM_FormatForTelnetBaseline(benchmark::State &state, bool use_color, unsigned int wrap_width) {
+	std::string formatted;
+	for (auto _ : state) {
+		unsigned int last_wrap = 0;
+		baselineFormatForTelnet(zone_text, formatted, use_color, wrap_width, last_wrap);
+		benchmark::DoNotOptimize(formatted.data());
+	}
+	state.SetBytesProcessed(state.iterations() * (int64_t) zone_text.size());
+}
+BENCHMARK_CAPTURE(BM_FormatForTelnetBaseline, color_wrap80, true, 80);
+BENCHMARK_CAPTURE(BM_FormatForTelnetBaseline, nocolor_nowrap, false, 0);
+
+/*****************************************************************************************
+ * Scripts
+ *****************************************************************************************/
+
+void BM_ScriptExecute(benchmark::State &state) {
+	ScriptEngine *scripts = engine.getScriptEngine();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(scripts->execute("bench_x = 2 + 3"));
+}
+BENCHMARK(BM_ScriptExecute);
+
+/*****************************************************************************************
+ * Player saves, the old XML file against the binary record
+ *****************************************************************************************/
+
+void BM_SavePlayer(benchmark::State &state, bool binary) {
+	std::string saved;
+	for (auto _ : state) {
+		if (binary) {
+			RecordWriter rec;
+			bench_plr->saveRecord(rec);
+			rec.finish("APLR", 1, saved);
+		} else {
+			pugi::xml_document userfile;
+			pugi::xml_node node = userfile.append_child("player");
+			bench_plr->saveData(node);
+
+			std::ostringstream text;
+			userfile.save(text);
+			saved = text.str();
+		}
+		benchmark::DoNotOptimize(saved.data());
+	}
+	state.counters["bytes"] = (double) saved.size();
+}
+BENCHMARK_CAPTURE(BM_SavePlayer, xml, false);
+BENCHMARK_CAPTURE(BM_SavePlayer, binary, true);
+
+void BM_LoadPlayer(benchmark::State &state, bool binary) {
+	std::string saved;
+	if (binary) {
+		RecordWriter rec;
+		bench_plr->saveRecord(rec);
+		rec.finish("APLR", 1, saved);
+	} else {
+		pugi::xml_document userfile;
+		pugi::xml_node node = userfile.append_child("player");
+		bench_plr->saveData(node);
+
+		std::ostringstream text;
+		userfile.save(text);
+		saved = text.str();
+	}
+
+	Player loaded("player:benchload", std::unique_ptr<TCPConn>(new TCPConn()));
+	for (auto _ : state) {
+		if (binary) {
+			RecordReader rec(saved);
+			rec.open("APLR");
+			benchmark::DoNotOptimize(loaded.loadRecord(rec));
+		} else {
+			pugi::xml_document userfile;
+			userfile.load_string(saved.c_str());
+			pugi::xml_node node = userfile.child("player");
+			benchmark::DoNotOptimize(loaded.loadData(node));
+		}
+	}
+}
+BENCHMARK_CAPTURE(BM_LoadPlayer, xml, false);
+BENCHMARK_CAPTURE(BM_LoadPlayer, binary, true);
+
+/*****************************************************************************************
+ * Zone loading, shipped and generated
+ *****************************************************************************************/
+
+void BM_LoadPhysicals(benchmark::State &state, bool synthetic) {
+	std::string zonedir;
+	if (synthetic)
+		zonedir = synth_dir;
+	else
+		engine.getConfig()->lookupValue("datadir.zonedir", zonedir);
+
+	int count = 0;
+	for (auto _ : state) {
+		std::unique_ptr<EntityDB> edb(new EntityDB());
+		count = loadZones(*edb, zonedir);
+
+		state.PauseTiming();
+		edb.reset();
+		state.ResumeTiming();
+	}
+	state.counters["entities"] = count;
+}
+BENCHMARK_CAPTURE(BM_LoadPhysicals, shipped, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_LoadPhysicals, synthetic, true)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+
+int main(int argc, char *argv[]) {
+
+	// Takes out the --benchmark_ options, leaving ours
+	benchmark::Initialize(&argc, argv);
+
+	std::string configfile = "data/mud.conf";
+
+	static struct option long_options[] = {
+		{"config", required_argument, 0, 'c'},
+		{"size", required_argument, 0, 's'},
+		{"help", no_argument, 0, 'h'},
+		{0,0,0,0}
+		};
+
+   int c = 0;
+	int option_index = 0;
+   while ((c = getopt_long(argc, argv, "c:s:h", long_options, &option_index)) != -1) {
+      switch (c) {
+		case 'c':
+			configfile = optarg;
+			break;
+
+		case 's':
+			synth_entities = (unsigned int) strtoul(optarg, NULL, 10);
+			if (synth_entities < crowded_items * 2) {
+				std::cerr << "Generated world needs at least " << crowded_items * 2 << " entities.\n";
+				return EXIT_FAILURE;
+			}
+			break;
+
+      case 'h':
+			displayHelp(argv[0]);
+			return EXIT_SUCCESS;
+
+      default:
+			displayHelp(argv[0]);
+			return EXIT_FAILURE;
+      }
+   }
+
+	engine.initConfig();
+	try {
+		engine.loadConfig(configfile.c_str());
+	}
+	catch (const libconfig::FileIOException &fioex)
+	{
+		std::cerr << "I/O error reading config file: " << configfile << std::endl;
+		return(EXIT_FAILURE);
+	}
+	catch (const libconfig::ParseException &pex)
+	{
+		std::cerr << "Parse error in " << pex.getFile() << ", line: " << pex.getLine()
+								<< " - " << pex.getError() << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// Benchmark runs aren't game sessions, keep them out of the event log
+	if (engine.getConfig()->exists("misc.eventlog"))
+		engine.getConfig()->lookup("misc.eventlog") = "";
+
+	engine.startLog();
+	engine.initialize();
+
+	std::cout << "Generating a world of " << synth_entities << " entities..." << std::flush;
+	char dirtemplate[] = "/tmp/aimebench.XXXXXX";
+	if (mkdtemp(dirtemplate) == NULL) {
+		std::cerr << "Unable to create a temp directory for the generated world.\n";
+		return EXIT_FAILURE;
+	}
+	synth_dir = dirtemplate;
+	writeSynthWorld(synth_dir, synth_entities);
+
+	synth_db.reset(new EntityDB());
+	int count = loadZones(*synth_db, synth_dir);
+	std::cout << "loaded " << count << ".\n";
+
+	crowded_room = synth_db->getPhysical("bench:room0");
+	sparse_room = synth_db->getPhysical("bench:room1");
+	if ((crowded_room == nullptr) || (sparse_room == nullptr)) {
+		std::cerr << "Generated world failed to load, see the MUD log.\n";
+		boost::filesystem::remove_all(synth_dir);
+		return EXIT_FAILURE;
+	}
+
+	// A player standing in the crowded room to issue commands
+	bench_plr.reset(new Player("player:benchbot", std::unique_ptr<TCPConn>(new TCPConn())));
+	bench_plr->setSelfPtr(bench_plr);
+	bench_plr->movePhysical(crowded_room, bench_plr);
+
+	// Stand-in salt+hash so the save benchmarks write a full record
+	bench_plr->setPasswdHash(std::vector<unsigned char>(24, 0x5A));
+
+	readZoneText(zone_text);
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	boost::filesystem::remove_all(synth_dir);
+	engine.cleanup();
+	return EXIT_SUCCESS;
+}
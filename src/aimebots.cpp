@@ -0,0 +1,610 @@
+/****************************************************************************************
+ * aimebots - Load generator. Connects a crowd of bots to a running server, walks each one
+ *				  through the LoginHandler (creating the account the first time), then has them
+ *				  send a weighted mix of commands and times how long each takes to come back.
+ *				  Results are written as JSON so runs can be compared between releases.
+ *
+ *				  A command counts as answered when the next game prompt arrives. Room messages
+ *				  from other bots also end in a prompt, so chatty mixes read a little fast.
+ *
+ ****************************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cerrno>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "Histogram.h"
+
+typedef std::chrono::steady_clock bot_clock;
+
+// What the server sends when it wants something from us, and what we answer, during login
+const char *game_prompt = "TempPrompt> ";
+const char *bot_passwd = "botpassword1";
+
+struct loginstep {
+	const char *prompt;
+	const char *reply;		// NULL means the bot's name or password
+	bool is_passwd;
+};
+
+const loginstep login_steps[] = {
+	{"What shall we call you?", NULL, false},
+	{"create that username?", "y", false},
+	{"Enter your new password:", NULL, true},
+	{"Re-enter your new password:", NULL, true},
+	{"Enter your password:", NULL, true},
+	{"What is your gender", "m", false},
+	{"What is your race?", "human", false},
+	{"What is your class?", "warrior", false},
+	{"What is your choice?", "1", false},
+	{NULL, NULL, false}
+};
+
+// Settings from the command line
+struct botconfig {
+	std::string address = "127.0.0.1";
+	unsigned short port = 6715;
+	unsigned int bots = 10;
+	unsigned int threads = 4;
+	unsigned int duration = 60;
+	unsigned int ramp = 5;
+	unsigned int think_ms = 1000;
+	unsigned int timeout = 10;
+	std::string prefix = "bot";
+	std::string mixfile = "data/loadgen/basic.mix";
+	pid_t server_pid = 0;
+	std::string outfile;
+};
+
+// One entry in the command mix
+struct mixcmd {
+	std::string command;
+	unsigned int weight;
+};
+
+struct bot {
+	enum bot_state { Connecting, LoggingIn, Playing, Failed, Done };
+
+	std::string name;
+	int fd = -1;
+	bot_state state = Connecting;
+	std::string inbuf;
+
+	bot_clock::time_point start_at;			// when to connect (ramp-up)
+	bot_clock::time_point connected_at;
+	bot_clock::time_point sent_at;
+	bot_clock::time_point next_cmd_at;
+	bool waiting = false;
+	unsigned int last_cmd = 0;
+};
+
+// Tallies kept by each worker thread and merged at the end
+struct botstats {
+	Histogram login_usecs;
+	Histogram command_usecs;
+	std::map<std::string, Histogram> by_command;
+	uint64_t logins_failed = 0;
+	uint64_t connects_failed = 0;
+	uint64_t commands_sent = 0;
+	uint64_t timeouts = 0;
+	uint64_t disconnects = 0;
+	uint64_t bytes_in = 0;
+
+	void merge(const botstats &other) {
+		login_usecs.merge(other.login_usecs);
+		command_usecs.merge(other.command_usecs);
+		for (auto cmd_it = other.by_command.begin(); cmd_it != other.by_command.end(); cmd_it++)
+			by_command[cmd_it->first].merge(cmd_it->second);
+		logins_failed += other.logins_failed;
+		connects_failed += other.connects_failed;
+		commands_sent += other.commands_sent;
+		timeouts += other.timeouts;
+		disconnects += other.disconnects;
+		bytes_in += other.bytes_in;
+	}
+};
+
+/*****************************************************************************************
+ * displayHelp - Shows command line parameters to the user.
+ *****************************************************************************************/
+
+void displayHelp(const char *execname) {
+   std::cout << execname << " [OPTIONS]\n";
+	std::cout << "Drive bots against a running AIME3 server and report command latency.\n\n";
+   std::cout << "  -a, --address   IP address of the server (default: 127.0.0.1)\n";
+   std::cout << "  -p, --port      Port of the server (default: 6715)\n";
+	std::cout << "  -b, --bots      Number of bots to connect (default: 10)\n";
+	std::cout << "  -t, --threads   Worker threads driving the bots (default: 4)\n";
+	std::cout << "  -d, --duration  Seconds to send commands for once logged in (default: 60)\n";
+	std::cout << "  -r, --ramp      Seconds over which to spread the connections (default: 5)\n";
+	std::cout << "  -w, --think     Milliseconds a bot waits between commands, +/- 50% (default: 1000)\n";
+	std::cout << "  -T, --timeout   Seconds to wait for a response before counting a timeout (default: 10)\n";
+	std::cout << "  -n, --prefix    Bot names are this followed by a number (default: bot)\n";
+	std::cout << "  -x, --mix       Command mix file of '<weight> <command>' lines\n";
+	std::cout << "                  (default: data/loadgen/basic.mix)\n";
+	std::cout << "  -P, --pid       Server process ID, to report its CPU use during the run\n";
+	std::cout << "  -o, --output    Write the JSON results here instead of stdout\n";
+	std::cout << "  -h, --help      Display this message\n";
+}
+
+/*****************************************************************************************
+ * loadMix - reads the command mix file
+ *
+ *		Returns: false if the file couldn't be read or had no commands
+ *****************************************************************************************/
+
+bool loadMix(const char *filename, std::vector<mixcmd> &mix) {
+	std::ifstream mixfile(filename);
+	if (!mixfile.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(mixfile, line)) {
+		size_t start = line.find_first_not_of(" \t");
+		if ((start == std::string::npos) || (line[start] == '#'))
+			continue;
+
+		char *cmdstart;
+		unsigned long weight = strtoul(line.c_str() + start, &cmdstart, 10);
+		std::string command(cmdstart);
+		command.erase(0, command.find_first_not_of(" \t"));
+		command.erase(command.find_last_not_of(" \t\r") + 1);
+		if ((weight == 0) || (command.size() == 0))
+			continue;
+
+		mix.push_back(mixcmd{command, (unsigned int) weight});
+	}
+	return (mix.size() > 0);
+}
+
+/*****************************************************************************************
+ * getCPUTicks - user + system clock ticks used so far by a process, from /proc
+ *****************************************************************************************/
+
+uint64_t getCPUTicks(pid_t pid) {
+	std::string path("/proc/");
+	path += std::to_string(pid);
+	path += "/stat";
+
+	std::ifstream statfile(path);
+	std::string stat;
+	if (!std::getline(statfile, stat))
+		return 0;
+
+	// The command name can contain spaces, so count fields from after its closing paren
+	size_t pos = stat.rfind(')');
+	if (pos == std::string::npos)
+		return 0;
+
+	std::istringstream fields(stat.substr(pos + 2));
+	std::string field;
+	uint64_t utime = 0, stime = 0;
+	for (unsigned int i=0; (i < 13) && (fields >> field); i++) {
+		if (i == 11)
+			utime = strtoull(field.c_str(), NULL, 10);
+		else if (i == 12)
+			stime = strtoull(field.c_str(), NULL, 10);
+	}
+	return utime + stime;
+}
+
+/*****************************************************************************************
+ * sendLine - sends a line of input to the server
+ *****************************************************************************************/
+
+bool sendLine(bot &b, const std::string &line) {
+	std::string out(line);
+	out += "\n";
+	return (write(b.fd, out.data(), out.size()) == (ssize_t) out.size());
+}
+
+/*****************************************************************************************
+ * connectBot - opens the bot's connection
+ *****************************************************************************************/
+
+bool connectBot(bot &b, const botconfig &cfg) {
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(cfg.port);
+	if (inet_pton(AF_INET, cfg.address.c_str(), &addr.sin_addr) != 1)
+		return false;
+
+	if ((b.fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+		return false;
+
+	int nodelay = 1;
+	setsockopt(b.fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+	if (connect(b.fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(b.fd);
+		b.fd = -1;
+		return false;
+	}
+
+	fcntl(b.fd, F_SETFL, fcntl(b.fd, F_GETFL) | O_NONBLOCK);
+	b.connected_at = bot_clock::now();
+	b.state = bot::LoggingIn;
+	return true;
+}
+
+/*****************************************************************************************
+ * handleLogin - answers whatever login prompt the server has sent. Output can hold more
+ *					  than one prompt, so the latest one is the one answered.
+ *****************************************************************************************/
+
+void handleLogin(bot &b, botstats &stats) {
+	if (b.inbuf.find("Incorrect password") != std::string::npos) {
+		stats.logins_failed++;
+		b.state = bot::Failed;
+		return;
+	}
+
+	// Made it into the game
+	size_t game_pos = b.inbuf.rfind(game_prompt);
+
+	const loginstep *latest = NULL;
+	size_t latest_pos = 0;
+	for (unsigned int i=0; login_steps[i].prompt != NULL; i++) {
+		size_t pos = b.inbuf.rfind(login_steps[i].prompt);
+		if ((pos != std::string::npos) && ((latest == NULL) || (pos > latest_pos))) {
+			latest = &login_steps[i];
+			latest_pos = pos;
+		}
+	}
+
+	if ((game_pos != std::string::npos) && ((latest == NULL) || (game_pos > latest_pos))) {
+		stats.login_usecs.record((uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+															bot_clock::now() - b.connected_at).count());
+		b.state = bot::Playing;
+		b.inbuf.clear();
+		return;
+	}
+
+	if (latest == NULL)
+		return;
+
+	b.inbuf.clear();
+	std::string reply;
+	if (latest->reply != NULL)
+		reply = latest->reply;
+	else if (latest->is_passwd)
+		reply = bot_passwd;
+	else
+		reply = b.name;
+
+	if (!sendLine(b, reply))
+		b.state = bot::Failed;
+}
+
+/*****************************************************************************************
+ * runBots - worker thread. Polls its share of the bots, logging them in and then sending
+ *				 commands from the mix until the run ends.
+ *****************************************************************************************/
+
+void runBots(std::vector<bot> &bots, const botconfig &cfg, const std::vector<mixcmd> &mix,
+								bot_clock::time_point end_at, botstats &stats, unsigned int seed) {
+	std::mt19937 rng(seed);
+	unsigned int total_weight = 0;
+	for (unsigned int i=0; i<mix.size(); i++)
+		total_weight += mix[i].weight;
+	std::uniform_int_distribution<unsigned int> pick_cmd(0, total_weight - 1);
+	std::uniform_int_distribution<unsigned int> think(cfg.think_ms / 2, cfg.think_ms + cfg.think_ms / 2);
+
+	std::vector<pollfd> fds;
+	std::vector<bot *> polled;
+	char readbuf[4096];
+
+	while (true) {
+		auto now = bot_clock::now();
+		bool stopping = (now >= end_at);
+
+		fds.clear();
+		polled.clear();
+		unsigned int active = 0;
+
+		for (unsigned int i=0; i<bots.size(); i++) {
+			bot &b = bots[i];
+
+			if ((b.state == bot::Connecting) && (now >= b.start_at)) {
+				if (!connectBot(b, cfg)) {
+					stats.connects_failed++;
+					b.state = bot::Failed;
+				}
+			}
+
+			if ((b.state == bot::Failed) || (b.state == bot::Done))
+				continue;
+			active++;
+
+			// Time's up, quit cleanly. Bots still logging in are just dropped.
+			if (stopping) {
+				if (b.state == bot::Playing)
+					sendLine(b, "quit");
+				if (b.fd >= 0)
+					close(b.fd);
+				b.fd = -1;
+				b.state = bot::Done;
+				continue;
+			}
+
+			if (b.state == bot::Playing) {
+				if (b.waiting && (now - b.sent_at > std::chrono::seconds(cfg.timeout))) {
+					stats.timeouts++;
+					b.waiting = false;
+					b.next_cmd_at = now;
+				}
+
+				if (!b.waiting && (now >= b.next_cmd_at)) {
+					unsigned int roll = pick_cmd(rng);
+					unsigned int idx = 0;
+					while (roll >= mix[idx].weight)
+						roll -= mix[idx++].weight;
+
+					b.inbuf.clear();
+					if (!sendLine(b, mix[idx].command)) {
+						stats.disconnects++;
+						b.state = bot::Failed;
+						continue;
+					}
+					b.last_cmd = idx;
+					b.sent_at = now;
+					b.waiting = true;
+					stats.commands_sent++;
+				}
+			}
+
+			if (b.fd >= 0) {
+				fds.push_back(pollfd{b.fd, POLLIN, 0});
+				polled.push_back(&b);
+			}
+		}
+
+		if (active == 0)
+			return;
+
+		if (poll(fds.data(), fds.size(), 10) <= 0)
+			continue;
+
+		for (unsigned int i=0; i<fds.size(); i++) {
+			if (fds[i].revents == 0)
+				continue;
+
+			bot &b = *(polled[i]);
+			ssize_t amt = read(b.fd, readbuf, sizeof(readbuf));
+			if (amt <= 0) {
+				if ((amt < 0) && (errno == EAGAIN))
+					continue;
+
+				// The server closed on us
+				close(b.fd);
+				b.fd = -1;
+				stats.disconnects++;
+				if (b.state == bot::LoggingIn)
+					stats.logins_failed++;
+				b.state = bot::Failed;
+				continue;
+			}
+
+			stats.bytes_in += (uint64_t) amt;
+			b.inbuf.append(readbuf, (size_t) amt);
+
+			if (b.state == bot::LoggingIn)
+				handleLogin(b, stats);
+			else if (b.waiting && (b.inbuf.find(game_prompt) != std::string::npos)) {
+				uint64_t usecs = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+																	bot_clock::now() - b.sent_at).count();
+				stats.command_usecs.record(usecs);
+				stats.by_command[mix[b.last_cmd].command].record(usecs);
+				b.waiting = false;
+				b.inbuf.clear();
+				b.next_cmd_at = bot_clock::now() + std::chrono::milliseconds(think(rng));
+			} else if (!b.waiting)
+				b.inbuf.clear();
+		}
+	}
+}
+
+/*****************************************************************************************
+ * formatLatency - the JSON object for a latency histogram
+ *****************************************************************************************/
+
+std::string formatLatency(const Histogram &hist) {
+	std::stringstream json;
+	json << "{\"count\": " << hist.getCount() << ", \"mean\": " << hist.getMean() <<
+			  ", \"p50\": " << hist.getPercentile(50.0) << ", \"p90\": " << hist.getPercentile(90.0) <<
+			  ", \"p99\": " << hist.getPercentile(99.0) << ", \"max\": " << hist.getMax() << "}";
+	return json.str();
+}
+
+// Escapes the characters JSON can't take raw in a string
+std::string jsonEscape(const std::string &str) {
+	std::string escaped;
+	for (unsigned int i=0; i<str.size(); i++) {
+		if ((str[i] == '"') || (str[i] == '\\'))
+			escaped += '\\';
+		escaped += str[i];
+	}
+	return escaped;
+}
+
+int main(int argc, char *argv[]) {
+
+	botconfig cfg;
+
+	static struct option long_options[] = {
+		{"address", required_argument, 0, 'a'},
+		{"port", required_argument, 0, 'p'},
+		{"bots", required_argument, 0, 'b'},
+		{"threads", required_argument, 0, 't'},
+		{"duration", required_argument, 0, 'd'},
+		{"ramp", required_argument, 0, 'r'},
+		{"think", required_argument, 0, 'w'},
+		{"timeout", required_argument, 0, 'T'},
+		{"prefix", required_argument, 0, 'n'},
+		{"mix", required_argument, 0, 'x'},
+		{"pid", required_argument, 0, 'P'},
+		{"output", required_argument, 0, 'o'},
+		{"help", no_argument, 0, 'h'},
+		{0,0,0,0}
+		};
+
+   int c = 0;
+	int option_index = 0;
+   while ((c = getopt_long(argc, argv, "a:p:b:t:d:r:w:T:n:x:P:o:h", long_options, &option_index)) != -1) {
+      switch (c) {
+		case 'a':
+			cfg.address = optarg;
+			break;
+		case 'p':
+			cfg.port = (unsigned short) strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			cfg.bots = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			cfg.threads = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			cfg.duration = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			cfg.ramp = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			cfg.think_ms = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'T':
+			cfg.timeout = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			cfg.prefix = optarg;
+			break;
+		case 'x':
+			cfg.mixfile = optarg;
+			break;
+		case 'P':
+			cfg.server_pid = (pid_t) strtol(optarg, NULL, 10);
+			break;
+		case 'o':
+			cfg.outfile = optarg;
+			break;
+      case 'h':
+			displayHelp(argv[0]);
+			return EXIT_SUCCESS;
+      default:
+			displayHelp(argv[0]);
+			return EXIT_FAILURE;
+      }
+   }
+
+	if ((cfg.bots == 0) || (cfg.threads == 0)) {
+		std::cerr << "Need at least one bot and one thread.\n";
+		return EXIT_FAILURE;
+	}
+	if (cfg.threads > cfg.bots)
+		cfg.threads = cfg.bots;
+
+	std::vector<mixcmd> mix;
+	if (!loadMix(cfg.mixfile.c_str(), mix)) {
+		std::cerr << "Unable to read any commands from mix file '" << cfg.mixfile << "'\n";
+		return EXIT_FAILURE;
+	}
+
+	// Deal the bots out to the threads, spreading their connects over the ramp
+	auto run_start = bot_clock::now();
+	std::vector<std::vector<bot>> thread_bots(cfg.threads);
+	for (unsigned int i=0; i<cfg.bots; i++) {
+		bot b;
+		b.name = cfg.prefix + std::to_string(i);
+		b.start_at = run_start + std::chrono::milliseconds((uint64_t) cfg.ramp * 1000 * i / cfg.bots);
+		thread_bots[i % cfg.threads].push_back(b);
+	}
+
+	// Commands are sent for the duration once the ramp is over
+	bot_clock::time_point end_at = run_start + std::chrono::seconds(cfg.ramp + cfg.duration);
+
+	uint64_t cpu_start = (cfg.server_pid > 0) ? getCPUTicks(cfg.server_pid) : 0;
+
+	std::vector<botstats> thread_stats(cfg.threads);
+	std::vector<std::thread> workers;
+	for (unsigned int i=0; i<cfg.threads; i++) {
+		workers.push_back(std::thread(runBots, std::ref(thread_bots[i]), std::cref(cfg), std::cref(mix),
+												end_at, std::ref(thread_stats[i]),
+												std::random_device()() + i));
+	}
+
+	for (unsigned int i=0; i<workers.size(); i++)
+		workers[i].join();
+
+	double elapsed = std::chrono::duration<double>(bot_clock::now() - run_start).count();
+	uint64_t cpu_end = (cfg.server_pid > 0) ? getCPUTicks(cfg.server_pid) : 0;
+
+	botstats totals;
+	for (unsigned int i=0; i<thread_stats.size(); i++)
+		totals.merge(thread_stats[i]);
+
+	uint64_t completed = totals.command_usecs.getCount();
+
+	std::stringstream json;
+	json << std::fixed << std::setprecision(2);
+	json << "{\n";
+	json << "  \"bots\": " << cfg.bots << ",\n";
+	json << "  \"threads\": " << cfg.threads << ",\n";
+	json << "  \"duration_secs\": " << cfg.duration << ",\n";
+	json << "  \"elapsed_secs\": " << elapsed << ",\n";
+	json << "  \"think_ms\": " << cfg.think_ms << ",\n";
+	json << "  \"mix\": \"" << jsonEscape(cfg.mixfile) << "\",\n";
+	json << "  \"connects_failed\": " << totals.connects_failed << ",\n";
+	json << "  \"logins_failed\": " << totals.logins_failed << ",\n";
+	json << "  \"disconnects\": " << totals.disconnects << ",\n";
+	json << "  \"login_usecs\": " << formatLatency(totals.login_usecs) << ",\n";
+	json << "  \"commands_sent\": " << totals.commands_sent << ",\n";
+	json << "  \"commands_completed\": " << completed << ",\n";
+	json << "  \"timeouts\": " << totals.timeouts << ",\n";
+	json << "  \"commands_per_sec\": " << ((elapsed > 0) ? (double) completed / elapsed : 0.0) << ",\n";
+	json << "  \"bytes_in\": " << totals.bytes_in << ",\n";
+	json << "  \"command_usecs\": " << formatLatency(totals.command_usecs) << ",\n";
+	json << "  \"by_command\": {";
+	for (auto cmd_it = totals.by_command.begin(); cmd_it != totals.by_command.end(); cmd_it++) {
+		json << ((cmd_it == totals.by_command.begin()) ? "\n" : ",\n");
+		json << "    \"" << jsonEscape(cmd_it->first) << "\": " << formatLatency(cmd_it->second);
+	}
+	json << "\n  }";
+
+	if (cfg.server_pid > 0) {
+		double cpu_secs = (double) (cpu_end - cpu_start) / (double) sysconf(_SC_CLK_TCK);
+		json << ",\n  \"server_cpu_secs\": " << cpu_secs << ",\n";
+		json << "  \"server_cpu_pct\": " << ((elapsed > 0) ? cpu_secs * 100.0 / elapsed : 0.0);
+	}
+	json << "\n}\n";
+
+	if (cfg.outfile.size() > 0) {
+		std::ofstream outfile(cfg.outfile);
+		if (!outfile.is_open()) {
+			std::cerr << "Unable to write results to '" << cfg.outfile << "'\n";
+			std::cout << json.str();
+			return EXIT_FAILURE;
+		}
+		outfile << json.str();
+	} else
+		std::cout << json.str();
+
+	return EXIT_SUCCESS;
+}
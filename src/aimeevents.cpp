@@ -0,0 +1,245 @@
+/****************************************************************************************
+ * aimeevents - Reads the binary event log written by the MUD (misc.eventlog) and lists,
+ *					 counts or aggregates the events without needing the server running
+ *
+ *
+ ****************************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include "EventLog.h"
+#include "Histogram.h"
+#include "exceptions.h"
+
+/*****************************************************************************************
+ * displayHelp - Shows command line parameters to the user.
+ *****************************************************************************************/
+
+void displayHelp(const char *execname) {
+   std::cout << execname << " [OPTIONS] <eventfile>\n";
+	std::cout << "Query the AIME3 binary event log.\n\n";
+	std::cout << "  -m, --mode      What to report (default: list)\n";
+	std::cout << "                     list - print each event\n";
+	std::cout << "                     count - number of events of each type\n";
+	std::cout << "                     rate - events per second, with the average and peak\n";
+	std::cout << "                     latency - command execute time percentiles per action\n";
+	std::cout << "  -t, --type      Only events of this type (connect, disconnect, login, command,\n";
+	std::cout << "                  scripterror, loadfailure)\n";
+	std::cout << "  -s, --subject   Only events whose subject (player, IP, file...) matches exactly\n";
+	std::cout << "  -d, --detail    Only events whose detail (action ID, message...) contains this\n";
+	std::cout << "  -f, --from      Only events at or after this Unix time\n";
+	std::cout << "  -u, --until     Only events before this Unix time\n";
+	std::cout << "  -h, --help      Display this message\n";
+}
+
+// The filters from the command line
+struct eventfilter {
+	EventLog::event_types type = EventLog::NoEvent;
+	std::string subject;
+	std::string detail;
+	uint64_t from = 0;
+	uint64_t until = 0;
+};
+
+/*****************************************************************************************
+ * matchEvent - returns true if the event passes all the filters given
+ *****************************************************************************************/
+
+bool matchEvent(const EventLog::event &ev, const eventfilter &filter) {
+	if ((filter.type != EventLog::NoEvent) && (ev.type != filter.type))
+		return false;
+
+	if ((filter.subject.size() > 0) && (ev.subject != filter.subject))
+		return false;
+
+	if ((filter.detail.size() > 0) && (ev.detail.find(filter.detail) == std::string::npos))
+		return false;
+
+	uint64_t secs = ev.timestamp / 1000000;
+	if ((secs < filter.from) || ((filter.until > 0) && (secs >= filter.until)))
+		return false;
+
+	return true;
+}
+
+/*****************************************************************************************
+ * formatTime - Unix time in usecs to a local time string with milliseconds
+ *****************************************************************************************/
+
+std::string formatTime(uint64_t usecs) {
+	time_t secs = (time_t) (usecs / 1000000);
+	struct tm tmval;
+	char buf[40];
+
+	localtime_r(&secs, &tmval);
+	size_t len = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tmval);
+	snprintf(buf + len, sizeof(buf) - len, ".%03u", (unsigned int) ((usecs / 1000) % 1000));
+	return std::string(buf);
+}
+
+int main(int argc, char *argv[]) {
+
+	std::string mode("list");
+	eventfilter filter;
+
+	static struct option long_options[] = {
+		{"mode", required_argument, 0, 'm'},
+		{"type", required_argument, 0, 't'},
+		{"subject", required_argument, 0, 's'},
+		{"detail", required_argument, 0, 'd'},
+		{"from", required_argument, 0, 'f'},
+		{"until", required_argument, 0, 'u'},
+		{"help", no_argument, 0, 'h'},
+		{0,0,0,0}
+		};
+
+   int c = 0;
+	int option_index = 0;
+   while ((c = getopt_long(argc, argv, "m:t:s:d:f:u:h", long_options, &option_index)) != -1) {
+      switch (c) {
+		case 'm':
+			mode = optarg;
+			break;
+
+		case 't':
+			if ((filter.type = EventLog::getTypeByName(optarg)) == EventLog::NoEvent) {
+				std::cerr << "Unknown event type '" << optarg << "'\n";
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 's':
+			filter.subject = optarg;
+			break;
+
+		case 'd':
+			filter.detail = optarg;
+			break;
+
+		case 'f':
+			filter.from = strtoull(optarg, NULL, 10);
+			break;
+
+		case 'u':
+			filter.until = strtoull(optarg, NULL, 10);
+			break;
+
+      case 'h':
+			displayHelp(argv[0]);
+			return EXIT_SUCCESS;
+
+      default:
+			displayHelp(argv[0]);
+			return EXIT_FAILURE;
+      }
+   }
+
+	if ((mode != "list") && (mode != "count") && (mode != "rate") && (mode != "latency")) {
+		std::cerr << "Unknown mode '" << mode << "'\n";
+		return EXIT_FAILURE;
+	}
+
+	if (optind >= argc) {
+		displayHelp(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *fptr = fopen(argv[optind], "rb");
+	if (fptr == NULL) {
+		std::cerr << "Unable to open event log '" << argv[optind] << "': " << strerror(errno) << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (!EventLog::readHeader(fptr)) {
+		std::cerr << "'" << argv[optind] << "' is not an event log this version can read.\n";
+		fclose(fptr);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t type_counts[EventLog::NumEventTypes] = {0};
+	std::map<uint64_t, uint64_t> per_second;
+	std::map<std::string, Histogram> latencies;
+	Histogram all_commands;
+
+	EventLog::event ev;
+	try {
+		while (EventLog::readEvent(fptr, ev)) {
+			if (!matchEvent(ev, filter))
+				continue;
+
+			if (mode == "list") {
+				std::cout << formatTime(ev.timestamp) << "  " << std::left << std::setw(12) <<
+								EventLog::getTypeName(ev.type) << " " << ev.subject;
+				if (ev.detail.size() > 0)
+					std::cout << "  " << ev.detail;
+				if (ev.type == EventLog::Command)
+					std::cout << "  " << ev.value << "us";
+				std::cout << "\n";
+			} else if (mode == "count") {
+				type_counts[ev.type]++;
+			} else if (mode == "rate") {
+				per_second[ev.timestamp / 1000000]++;
+			} else if (ev.type == EventLog::Command) {
+				latencies[ev.detail].record(ev.value);
+				all_commands.record(ev.value);
+			}
+		}
+	} catch (const logfile_error &e) {
+		// Usually the server was mid-write, report what we read up to that point
+		std::cerr << "Stopped reading: " << e.what() << "\n";
+	}
+	fclose(fptr);
+
+	if (mode == "count") {
+		for (unsigned int i=1; i<EventLog::NumEventTypes; i++) {
+			std::cout << std::left << std::setw(14) << EventLog::getTypeName((EventLog::event_types) i) <<
+																							type_counts[i] << "\n";
+		}
+	} else if (mode == "rate") {
+		uint64_t total = 0, peak = 0, peak_sec = 0;
+		for (auto sec_it = per_second.begin(); sec_it != per_second.end(); sec_it++) {
+			std::cout << formatTime(sec_it->first * 1000000).substr(0, 19) << "  " << sec_it->second << "\n";
+			total += sec_it->second;
+			if (sec_it->second > peak) {
+				peak = sec_it->second;
+				peak_sec = sec_it->first;
+			}
+		}
+
+		if (per_second.size() > 0) {
+			// Seconds with no events count toward the average
+			uint64_t span = per_second.rbegin()->first - per_second.begin()->first + 1;
+			std::cout << "\nAverage: " << std::fixed << std::setprecision(2) << (double) total / (double) span <<
+								"/sec over " << span << " secs, peak: " << peak << " at " <<
+								formatTime(peak_sec * 1000000).substr(0, 19) << "\n";
+		}
+	} else if (mode == "latency") {
+		// Busiest actions first
+		std::vector<std::pair<std::string, Histogram>> sorted(latencies.begin(), latencies.end());
+		std::sort(sorted.begin(), sorted.end(),
+						[](const std::pair<std::string, Histogram> &a, const std::pair<std::string, Histogram> &b) {
+							return a.second.getCount() > b.second.getCount(); });
+		sorted.insert(sorted.begin(), std::pair<std::string, Histogram>("(all)", all_commands));
+
+		std::cout << std::left << std::setw(20) << "action" << std::right << std::setw(10) << "count" <<
+						std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99" <<
+						std::setw(10) << "max" << "   (usecs)\n";
+		for (unsigned int i=0; i<sorted.size(); i++) {
+			const Histogram &hist = sorted[i].second;
+			std::cout << std::left << std::setw(20) << sorted[i].first << std::right << std::setw(10) <<
+							hist.getCount() << std::setw(10) << hist.getMean() << std::setw(10) <<
+							hist.getPercentile(50.0) << std::setw(10) << hist.getPercentile(99.0) <<
+							std::setw(10) << hist.getMax() << "\n";
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
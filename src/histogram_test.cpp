@@ -0,0 +1,70 @@
+/****************************************************************************************
+ * histogram_test - checks that Histogram records values at the edges of its bucket range
+ *						  and reports them sensibly. Built with _GLIBCXX_ASSERTIONS so a value
+ *						  that lands outside the bucket table aborts instead of going unnoticed.
+ *						  Run by "make check".
+ *
+ ****************************************************************************************/
+
+#include <iostream>
+#include <cstdint>
+#include "Histogram.h"
+
+unsigned int failures = 0;
+
+/*****************************************************************************************
+ * check - counts and reports a failed condition
+ *****************************************************************************************/
+
+void check(bool cond, const char *what, uint64_t value) {
+	if (cond)
+		return;
+
+	std::cout << "FAILED: " << what << " (value " << value << ")\n";
+	failures++;
+}
+
+/*****************************************************************************************
+ * checkValue - records one value on its own and checks the results
+ *****************************************************************************************/
+
+void checkValue(uint64_t value) {
+	Histogram hist;
+	hist.record(value);
+
+	check(hist.getCount() == 1, "count after one record", value);
+	check(hist.getMax() == value, "max is exact", value);
+	check(hist.getPercentile(100.0) == value, "p100 is the max", value);
+	check(hist.getPercentile(50.0) <= value, "p50 not above the value", value);
+}
+
+int main() {
+	const uint64_t edges[] = {0, 1, 63, 64, 65, 1000, (1ull << 32), (1ull << 39) - 1, (1ull << 39),
+										(1ull << 40) - 1, (1ull << 40), (1ull << 40) + (1ull << 39),
+										(1ull << 41), (1ull << 63), UINT64_MAX};
+
+	for (unsigned int i=0; i<sizeof(edges) / sizeof(uint64_t); i++)
+		checkValue(edges[i]);
+
+	// All of them in one histogram, merged into another
+	Histogram all, merged;
+	for (unsigned int i=0; i<sizeof(edges) / sizeof(uint64_t); i++)
+		all.record(edges[i]);
+	merged.merge(all);
+	check(merged.getCount() == sizeof(edges) / sizeof(uint64_t), "merged count", 0);
+	check(merged.getMax() == UINT64_MAX, "merged max", UINT64_MAX);
+
+	// Within a power of two below 2^40, percentiles are within one sub-bucket (1/32)
+	Histogram accuracy;
+	for (uint64_t value = 1000; value < 2000; value++)
+		accuracy.record(value);
+	uint64_t p50 = accuracy.getPercentile(50.0);
+	check((p50 >= 1500 - 1500 / 32) && (p50 <= 1500), "p50 of 1000-1999", p50);
+
+	if (failures > 0) {
+		std::cout << failures << " check(s) failed.\n";
+		return 1;
+	}
+	std::cout << "All histogram checks passed.\n";
+	return 0;
+}
@@ -0,0 +1,170 @@
+/****************************************************************************************
+ * logstore_test - checks that LogStore recovers from a crash the way it should: a torn
+ *						 final batch is cut off, damage to an already-committed batch is refused
+ *						 and the file left alone, and the lock is still held after compaction
+ *						 swaps in a new file. Works in a scratch directory under /tmp.
+ *						 Run by "make check".
+ *
+ ****************************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdlib.h>
+#include <unistd.h>
+#include "global.h"
+#include "LogStore.h"
+
+// The engine, needed to link against libaime.a
+MUD engine;
+
+unsigned int failures = 0;
+
+// Each test batch is one Put of "a" with a two-byte record plus its commit
+const uint64_t put_len = 24;
+const uint64_t commit_len = 21;
+const uint64_t batch_len = put_len + commit_len;
+
+/*****************************************************************************************
+ * check - counts and reports a failed condition
+ *****************************************************************************************/
+
+void check(bool cond, const char *what, uint64_t value) {
+	if (cond)
+		return;
+
+	std::cout << "FAILED: " << what << " (value " << value << ")\n";
+	failures++;
+}
+
+/*****************************************************************************************
+ * fileSize - the size of a file on disk, 0 if it can't be read
+ *****************************************************************************************/
+
+uint64_t fileSize(const std::string &path) {
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file)
+		return 0;
+	return (uint64_t) file.tellg();
+}
+
+/*****************************************************************************************
+ * damageAt - overwrites a few bytes of a file, as a torn or bad write would
+ *****************************************************************************************/
+
+void damageAt(const std::string &path, uint64_t offset) {
+	std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+	file.seekp((std::streamoff) offset);
+	file << "XXXX";
+}
+
+/*****************************************************************************************
+ * writeBatches - makes a fresh store holding batches saving "a" as v0, v1, ...
+ *****************************************************************************************/
+
+void writeBatches(const std::string &path, unsigned int count) {
+	unlink(path.c_str());
+
+	LogStore store(path.c_str());
+	check(store.open(), "open new store", count);
+	for (unsigned int i=0; i<count; i++) {
+		std::vector<PlayerStore::store_record> batch{{"a", "v" + std::to_string(i)}};
+		check(store.saveBatch(batch), "save batch", i);
+	}
+}
+
+/*****************************************************************************************
+ * checkRollsBack - opens a store whose last batch was torn and checks that it was cut
+ *						  off, leaving the batch before it
+ *****************************************************************************************/
+
+void checkRollsBack(const std::string &path, uint64_t good_size, const char *what) {
+	LogStore store(path.c_str());
+	std::string record;
+
+	if (!store.open()) {
+		std::cout << "FAILED: " << what << " did not open\n";
+		failures++;
+		return;
+	}
+	check((store.load("a", record) == 1) && (record == "v1"), what, 0);
+	check(fileSize(path) == good_size, what, fileSize(path));
+}
+
+int main() {
+	char dirbuf[] = "/tmp/logstore_testXXXXXX";
+	if (mkdtemp(dirbuf) == NULL) {
+		std::cout << "FAILED: unable to make a scratch directory\n";
+		return 1;
+	}
+	std::string dir(dirbuf);
+	std::string path = dir + "/players.db";
+
+	LogMgr testlog((dir + "/logstore_test.log").c_str(), 1);
+	mudlog = &testlog;
+
+	// Final commit damaged: the last batch is torn and rolled back
+	writeBatches(path, 3);
+	uint64_t size = fileSize(path);
+	damageAt(path, size - 10);
+	checkRollsBack(path, size - batch_len, "damaged final commit");
+
+	// Final commit never written
+	writeBatches(path, 3);
+	size = fileSize(path);
+	check(truncate(path.c_str(), (off_t) (size - commit_len)) == 0, "truncate", size);
+	checkRollsBack(path, size - batch_len, "missing final commit");
+
+	// The last batch's commit reached the disk but an earlier page of it didn't. Nothing
+	// follows that commit, so it's still a torn tail
+	writeBatches(path, 3);
+	size = fileSize(path);
+	damageAt(path, size - batch_len + 6);
+	checkRollsBack(path, size - batch_len, "torn put before a good commit");
+
+	// An entry in the middle is damaged with whole batches after it: refused, file untouched
+	writeBatches(path, 3);
+	size = fileSize(path);
+	damageAt(path, size - 3 * batch_len + 6);
+	{
+		LogStore store(path.c_str());
+		check(!store.open(), "damaged committed batch refused", 0);
+	}
+	check(fileSize(path) == size, "refused store left alone", fileSize(path));
+
+	// Enough superseded saves to compact several times, then a second server tries to open it
+	unlink(path.c_str());
+	{
+		LogStore store(path.c_str());
+		store.setCompaction(512, 50);
+		check(store.open(), "open store to compact", 0);
+		for (unsigned int i=0; i<100; i++) {
+			std::vector<PlayerStore::store_record> batch{{"a", "v" + std::to_string(i)}};
+			store.saveBatch(batch);
+		}
+		check(fileSize(path) < 100 * batch_len, "store was compacted", fileSize(path));
+
+		LogStore second(path.c_str());
+		check(!second.open(), "compacted store still locked", 0);
+	}
+	{
+		LogStore store(path.c_str());
+		std::string record;
+		check(store.open(), "reopen after compaction", 0);
+		check((store.load("a", record) == 1) && (record == "v99"), "newest save kept", 0);
+	}
+
+	mudlog = NULL;
+	unlink(path.c_str());
+	unlink((dir + "/logstore_test.log").c_str());
+	rmdir(dir.c_str());
+
+	if (failures > 0) {
+		std::cout << failures << " check(s) failed.\n";
+		return 1;
+	}
+	std::cout << "All logstore checks passed.\n";
+	return 0;
+}
@@ -166,7 +166,7 @@ unsigned int locateInTable(const char *name, const char **table) {
  *
  *******************************************************************************************/
 
-bool equalAbbrev(std::string &buf, const char *compare_str) {
+bool equalAbbrev(const std::string &buf, const char *compare_str) {
 	for (unsigned int i=0; i<buf.size(); i++) {
 		if (*compare_str == '\0')
 			return false;